@@ -39,6 +39,10 @@
 
 #include <common.h>
 #include <command.h>
+#include <watchdog.h>
+#ifdef CONFIG_NETCONSOLE
+#include <devices.h>
+#endif
 
 #include "firminfo.h"
 
@@ -65,26 +69,6 @@ static inline void outb(volatile unsigned char *addr, int val)
 	asm volatile("stb%U0%X0 %1,%0; sync; isync" : "=m" (*addr) : "r" (val));
 }
 
-unsigned long checksum_check(unsigned char* addr, unsigned long size)
-{
-	long *laddr = (long *)addr;
-	unsigned long sum = 0,remain = 0;
-	int i;
-	while(size>=4) {
-		sum += *laddr;
-		laddr++;
-		size -= 4;
-	}
-	addr = (unsigned char*)laddr;
-	for(i=0;i<4;++i) {
-		remain = remain << 8;
-		if(size>i) remain += *addr;
-		addr++;
-		}
-	sum += remain;
-	return sum;
-}
-
 void do_boot_lskernel (cmd_tbl_t *cmdtp,
 					int flag,
 					int argc,
@@ -109,6 +93,8 @@ void do_boot_lskernel (cmd_tbl_t *cmdtp,
 	unsigned long	iflag;
 	struct firminfo *info = (struct firminfo *)load_addr;
 	struct bi_record *rec;
+	unsigned long	image = load_addr;	/* image used from here on */
+	unsigned long	sum;
 
 	int				i;
 	char			*flashstr="FLASH";
@@ -129,20 +115,55 @@ void do_boot_lskernel (cmd_tbl_t *cmdtp,
 			info->hour,info->min,info->sec);
 	printf("----------------------------------\n");
 	
-	if (verify) {
-		printf("Verifying checksum... ");
-		if (checksum_check((unsigned char*)info, info->size) != 0) {
-			printf("Failed!: checksum %08X, expecting 0\n",
-					checksum_check((unsigned char*)info, info->size));
-			return; /* Returns on error */
-		} else
-			printf("OK\n");
+#ifndef CFG_NO_FLASH
+	/*
+	 * An image in flash is copied to RAM while it is being summed,
+	 * and uncompressed from there. The copy must stay clear of the
+	 * kernel (below 4 MB) and of the command line, board info and
+	 * initrd which go just below the stack.
+	 */
+	if (addr2info(load_addr) != NULL) {
+		unsigned long stage = CFG_LOAD_ADDR;
+
+		if ((s = getenv("bootm_stage")) != NULL)
+			stage = simple_strtoul(s, NULL, 16);
+		stage = _ALIGN(stage, 32);
+		asm( "mr %0,1": "=r"(sp) : );
+		if (stage >= 0x400000 && stage + info->size + info->initrd_size
+				+ CFG_BARGSIZE + sizeof(bd_t) + 0x10000 < sp)
+			image = stage;
+		else
+			printf("Not staging: 0x%08lX overlaps kernel or stack\n",
+					stage);
 	}
+#endif
 
-	zimage_start = (char*)info + info->kernel_offset;
+	if (image != load_addr) {
+		printf("Copying to 0x%08lX%s... ", image,
+				verify ? " and verifying checksum" : "");
+		sum = checksum_copy((u32 *)image,
+				(u32 *)load_addr, info->size);
+	} else if (verify) {
+		printf("Verifying checksum... ");
+		sum = checksum_check((unsigned char*)info, info->size);
+	} else
+		sum = 0;
+	if (verify && sum != 0) {
+		printf("Failed!: checksum %08lX, expecting 0\n", sum);
+		return; /* Returns on error */
+	} else if (verify || image != load_addr)
+		printf("OK\n");
+
+	zimage_start = (char*)image + info->kernel_offset;
 	zimage_size  = (int)info->kernel_size;
-	iflag = disable_interrupts();
 	puts("Uncompressing kernel...");
+#ifdef CONFIG_NETCONSOLE
+	nc_flush();	/* nothing is sent while decompressing */
+#endif
+#ifdef CFG_NS16550_TXBUF
+	serial_flush();
+#endif
+	iflag = disable_interrupts();
 	if (gunzip(0, 0x400000, zimage_start, &zimage_size) != 0) {
 		puts ("Failed! MUST reset board to recover\n");
 		do_reset (cmdtp, flag, argc, argv);
@@ -190,7 +211,8 @@ void do_boot_lskernel (cmd_tbl_t *cmdtp,
 			unsigned long nsp;
 			unsigned long data;
 
-			data = initrd_start;
+			/* move it from the RAM copy when there is one */
+			data = image + info->initrd_offset;
 			/*
 			 * the inital ramdisk does not need to be within
 			 * CFG_BOOTMAPSZ as it is not accessed until after
@@ -289,6 +311,12 @@ void do_boot_lskernel (cmd_tbl_t *cmdtp,
 	outb(0xFF000001, 0xFF);
 
 	puts("Booting the kernel\n");
+#ifdef CONFIG_NETCONSOLE
+	nc_flush();
+#endif
+#ifdef CFG_NS16550_TXBUF
+	serial_flush();
+#endif
 
 	/*
 	 * Linux Kernel Parameters:
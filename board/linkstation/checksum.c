@@ -0,0 +1,91 @@
+/*
+ * checksum.c
+ *
+ * Checksum (and copy) a Linkstation firmimg.bin image
+ *
+ * Split out of bootls.c so that it carries no board specific code and
+ * can be built and tested on the host (see tools/test/test_firminfo.c).
+ *
+ * Copyright (C) 2006 Mihai Georgian <u-boot@linuxnotincluded.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#include <common.h>
+#include <watchdog.h>
+
+#include "firminfo.h"
+
+/*
+ * Sum the image as 32-bit words, the last partial word being taken
+ * big-endian and zero padded. When dst is not NULL the image is copied
+ * there in the same pass, eight words (one cache line) at a time, so
+ * that an image in flash is read only once.
+ */
+u32 checksum_copy(u32 *dst, const u32 *src, u32 size)
+{
+	const unsigned char *addr;
+	u32 sum = 0, remain = 0;
+	int i, burst = 0;
+
+#ifdef CFG_CACHELINE_SIZE
+	burst = dst && dcache_status() &&
+			(((unsigned long)dst & (CFG_CACHELINE_SIZE - 1)) == 0);
+#endif
+	while (size >= 32) {
+		if (dst) {
+#ifdef CFG_CACHELINE_SIZE
+			if (burst)
+				asm volatile("dcbz 0,%0" : : "r" (dst) : "memory");
+#endif
+			dst[0] = src[0]; dst[1] = src[1];
+			dst[2] = src[2]; dst[3] = src[3];
+			dst[4] = src[4]; dst[5] = src[5];
+			dst[6] = src[6]; dst[7] = src[7];
+			sum += dst[0] + dst[1] + dst[2] + dst[3] +
+				   dst[4] + dst[5] + dst[6] + dst[7];
+			dst += 8;
+		} else
+			sum += src[0] + src[1] + src[2] + src[3] +
+				   src[4] + src[5] + src[6] + src[7];
+		src += 8;
+		size -= 32;
+		if ((size & 0xffff) == 0)
+			WATCHDOG_RESET();
+	}
+	while (size >= 4) {
+		if (dst)
+			*dst++ = *src;
+		sum += *src++;
+		size -= 4;
+	}
+	addr = (const unsigned char *)src;
+	if (dst)
+		for (i = 0; i < size; i++)
+			((unsigned char *)dst)[i] = addr[i];
+	for(i=0;i<4;++i) {
+		remain = remain << 8;
+		if(size>i) remain += *addr;
+		addr++;
+		}
+	sum += remain;
+	return sum;
+}
+
+u32 checksum_check(unsigned char* addr, u32 size)
+{
+	return checksum_copy(NULL, (u32 *)addr, size);
+}
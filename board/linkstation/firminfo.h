@@ -24,4 +24,8 @@ struct firminfo {
 		unsigned long initrd_offset;
 		unsigned long initrd_size;
 	} __attribute((aligned(4)));
+
+/* checksum.c */
+u32 checksum_copy(u32 *dst, const u32 *src, u32 size);
+u32 checksum_check(unsigned char *addr, u32 size);
 // ----------------------------------------------------
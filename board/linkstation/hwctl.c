@@ -17,6 +17,9 @@
 #include <config.h>
 #include <common.h>
 #include <command.h>
+#ifdef CONFIG_NETCONSOLE
+#include <devices.h>
+#endif
 
 #define mdelay(n)	udelay((n)*1000)
 
@@ -248,6 +251,12 @@ void miconCntl_DisWDT(void)
 // U-Boot calls this function
 int do_reset (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 {
+#ifdef CONFIG_NETCONSOLE
+	nc_flush();
+#endif
+#ifdef CFG_NS16550_TXBUF
+	serial_flush();
+#endif
 	disable_interrupts();
 	miconCntl_Reboot();
 	while (1)
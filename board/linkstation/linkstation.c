@@ -56,9 +56,26 @@ int checkboard (void)
 
 long int initdram (int board_type)
 {
+#ifdef CFG_MEMSIZE_CACHE_ADDR
+	ulong regs[MPC824X_MEM_CONFIG_REGS];
+	int nregs = mpc824x_mem_config (regs);
+
+	return (get_ram_size_cached(CFG_SDRAM_BASE, CFG_MAX_RAM_SIZE,
+				    regs, nregs));
+#else
 	return (get_ram_size(CFG_SDRAM_BASE, CFG_MAX_RAM_SIZE));
+#endif
 }
 
+#ifdef CONFIG_ADD_RAM_INFO
+void board_add_ram_info (int use_default)
+{
+#ifdef CFG_MEMSIZE_CACHE_ADDR
+	get_ram_size_report ();
+#endif
+}
+#endif
+
 /*
  * Initialize PCI Devices
  */
@@ -0,0 +1,53 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Block cache statistics
+ */
+#include <common.h>
+#include <command.h>
+#include <part.h>
+
+#if defined(CONFIG_BLOCK_CACHE)
+
+int do_blkcache (cmd_tbl_t * cmdtp, int flag, int argc, char *argv[])
+{
+	if (argc == 1 || strcmp (argv[1], "info") == 0) {
+		blkcache_stats ();
+		return 0;
+	}
+	if (strcmp (argv[1], "flush") == 0) {
+		blkcache_flush ();
+		return 0;
+	}
+	printf ("Usage:\n%s\n", cmdtp->usage);
+	return 1;
+}
+
+U_BOOT_CMD(
+	blkcache,	2,	1,	do_blkcache,
+	"blkcache- show or flush the block device cache\n",
+	"[info]\n    - show cache hits, misses and bytes read per device\n"
+	"blkcache flush\n    - throw away all cached blocks\n"
+);
+
+#endif	/* CONFIG_BLOCK_CACHE */
@@ -27,6 +27,7 @@
 #include <common.h>
 #include <command.h>
 #include <net.h>
+#include <devices.h>
 
 
 /* -------------------------------------------------------------------- */
@@ -47,6 +48,12 @@ int do_go (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 	addr = simple_strtoul(argv[1], NULL, 16);
 
 	printf ("## Starting application at 0x%08lX ...\n", addr);
+#ifdef CONFIG_NETCONSOLE
+	nc_flush ();
+#endif
+#ifdef CFG_NS16550_TXBUF
+	serial_flush ();
+#endif
 
 	/*
 	 * pass address parameter as argv[0] (aka command name),
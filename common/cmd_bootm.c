@@ -68,6 +68,10 @@
 #include <dataflash.h>
 #endif
 
+#ifdef CONFIG_NETCONSOLE
+#include <devices.h>
+#endif
+
 /*
  * Some systems (for example LWMON) have very short watchdog periods;
  * we must make sure to split long operations like memmove() or
@@ -79,6 +83,92 @@
 
 int  gunzip (void *, int, unsigned char *, unsigned long *);
 
+/*
+ * Send the queued console output before a phase which does not poll the
+ * console, so that it neither waits in the buffer nor counts in the time
+ * of the phase.
+ */
+static void bootm_flush (void)
+{
+#ifdef CONFIG_NETCONSOLE
+	nc_flush ();
+#endif
+#ifdef CFG_NS16550_TXBUF
+	serial_flush ();
+#endif
+}
+
+#ifdef CONFIG_BOOTM_TIMING
+/*
+ * Interrupts (and with them get_timer()) are off while the image is
+ * uncompressed, so phases are timed with the time base.
+ */
+static ulong bootm_ms (ulong start)
+{
+	ulong tbclk = get_tbclk ();
+
+	return ((ulong)get_ticks () - start) / (tbclk >= 1000 ? tbclk / 1000 : 1);
+}
+# define BOOTM_START(t)		(bootm_flush (), (t) = (ulong)get_ticks ())
+# define BOOTM_OK(t)		printf ("OK (%ld ms)\n", bootm_ms (t))
+#else
+# define BOOTM_START(t)		bootm_flush ()
+# define BOOTM_OK(t)		puts ("OK\n")
+#endif /* CONFIG_BOOTM_TIMING */
+
+#if defined(CONFIG_BOOTM_STAGE) && !defined(CFG_NO_FLASH)
+/*
+ * Staged boot from NOR flash: rather than reading a compressed image
+ * byte by byte out of (uncached) flash twice, once for the CRC and
+ * once for gunzip(), copy it to RAM at "bootm_stage" first. The copy
+ * reads whole words and fills the destination a cache line at a time
+ * (dcbz avoids reading each line from RAM before overwriting it); the
+ * CRC is computed on each chunk right after copying it, while it is
+ * still in the data cache.
+ */
+#define STAGE_CHUNK	(8 * 1024)	/* fits in the L1 data cache */
+
+static void bootm_stage_lines (ulong dst, ulong src, ulong len)
+{
+#if defined(CONFIG_PPC) && defined(CFG_CACHELINE_SIZE)
+	ulong *d = (ulong *)dst;
+	volatile ulong *s = (volatile ulong *)src;
+	int i, burst = dcache_status ();
+
+	if (((dst | src) & (sizeof (ulong) - 1)) == 0) {
+		while (len >= CFG_CACHELINE_SIZE &&
+		       (((ulong)d & (CFG_CACHELINE_SIZE - 1)) == 0)) {
+			if (burst)
+				asm volatile ("dcbz 0,%0" : : "r" (d) : "memory");
+			for (i = 0; i < CFG_CACHELINE_SIZE / sizeof (ulong); i++)
+				*d++ = *s++;
+			len -= CFG_CACHELINE_SIZE;
+		}
+		dst = (ulong)d;
+		src = (ulong)s;
+	}
+#endif
+	memcpy ((void *)dst, (void *)src, len);
+}
+
+static ulong bootm_stage_copy (ulong dst, ulong src, ulong len)
+{
+	ulong crc = 0;
+	ulong chunk;
+
+	while (len > 0) {
+		chunk = (len > STAGE_CHUNK) ? STAGE_CHUNK : len;
+		bootm_stage_lines (dst, src, chunk);
+		crc = crc32 (crc, (uchar *)dst, chunk);
+		WATCHDOG_RESET ();
+		dst += chunk;
+		src += chunk;
+		len -= chunk;
+	}
+	return crc;
+}
+#endif /* CONFIG_BOOTM_STAGE && !CFG_NO_FLASH */
+
 static void *zalloc(void *, unsigned, unsigned);
 static void zfree(void *, void *, unsigned);
 
@@ -155,6 +245,13 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 	char	*name, *s;
 	int	(*appl)(int, char *[]);
 	image_header_t *hdr = &header;
+#ifdef CONFIG_BOOTM_TIMING
+	ulong	start;
+#endif
+#if defined(CONFIG_BOOTM_STAGE) && !defined(CFG_NO_FLASH)
+	int	staged = 0;
+	ulong	stage_crc = 0;
+#endif
 
 	s = getenv ("verify");
 	verify = (s && (*s == 'n')) ? 0 : 1;
@@ -229,14 +326,48 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 	data = addr + sizeof(image_header_t);
 	len  = ntohl(hdr->ih_size);
 
+#if defined(CONFIG_BOOTM_STAGE) && !defined(CFG_NO_FLASH)
+	if ((s = getenv ("bootm_stage")) != NULL &&
+	    hdr->ih_comp != IH_COMP_NONE && addr2info (addr) != NULL) {
+		ulong stage = simple_strtoul (s, NULL, 16);
+		ulong load  = ntohl(hdr->ih_load);
+		ulong end   = stage + sizeof(image_header_t) + len;
+
+		if (end > load && stage < load + unc_len) {
+			printf ("   Not staging: %08lx ... %08lx overlaps "
+				"load area\n", stage, end - 1);
+		} else {
+			printf ("   Staging Image to %08lx ... ", stage);
+			BOOTM_START (start);
+			memcpy ((void *)stage, &header, sizeof(image_header_t));
+			((image_header_t *)stage)->ih_hcrc = htonl(checksum);
+			stage_crc = bootm_stage_copy (stage + sizeof(image_header_t),
+						      data, len);
+			BOOTM_OK (start);
+			addr = stage;
+			data = addr + sizeof(image_header_t);
+			staged = 1;
+		}
+	}
+#endif /* CONFIG_BOOTM_STAGE && !CFG_NO_FLASH */
+
 	if (verify) {
+		ulong crc;
+
 		puts ("   Verifying Checksum ... ");
-		if (crc32 (0, (uchar *)data, len) != ntohl(hdr->ih_dcrc)) {
+		BOOTM_START (start);
+#if defined(CONFIG_BOOTM_STAGE) && !defined(CFG_NO_FLASH)
+		if (staged)
+			crc = stage_crc;
+		else
+#endif
+		crc = crc32 (0, (uchar *)data, len);
+		if (crc != ntohl(hdr->ih_dcrc)) {
 			printf ("Bad Data CRC\n");
 			SHOW_BOOT_PROGRESS (-3);
 			return 1;
 		}
-		puts ("OK\n");
+		BOOTM_OK (start);
 	}
 	SHOW_BOOT_PROGRESS (4);
 
@@ -316,6 +447,7 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 	case IH_COMP_NONE:
 		if(ntohl(hdr->ih_load) == addr) {
 			printf ("   XIP %s ... ", name);
+			BOOTM_START (start);
 		} else {
 #if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
 			size_t l = len;
@@ -323,6 +455,7 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 			void *from = (void *)data;
 
 			printf ("   Loading %s ... ", name);
+			BOOTM_START (start);
 
 			while (l > 0) {
 				size_t tail = (l > CHUNKSZ) ? CHUNKSZ : l;
@@ -333,12 +466,14 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 				l -= tail;
 			}
 #else	/* !(CONFIG_HW_WATCHDOG || CONFIG_WATCHDOG) */
+			BOOTM_START (start);
 			memmove ((void *) ntohl(hdr->ih_load), (uchar *)data, len);
 #endif	/* CONFIG_HW_WATCHDOG || CONFIG_WATCHDOG */
 		}
 		break;
 	case IH_COMP_GZIP:
 		printf ("   Uncompressing %s ... ", name);
+		BOOTM_START (start);
 		if (gunzip ((void *)ntohl(hdr->ih_load), unc_len,
 			    (uchar *)data, &len) != 0) {
 			puts ("GUNZIP ERROR - must RESET board to recover\n");
@@ -349,6 +484,7 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 #ifdef CONFIG_BZIP2
 	case IH_COMP_BZIP2:
 		printf ("   Uncompressing %s ... ", name);
+		BOOTM_START (start);
 		/*
 		 * If we've got less than 4 MB of malloc() space,
 		 * use slower decompression algorithm which requires
@@ -372,7 +508,7 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 		SHOW_BOOT_PROGRESS (-7);
 		return 1;
 	}
-	puts ("OK\n");
+	BOOTM_OK (start);
 	SHOW_BOOT_PROGRESS (7);
 
 	switch (hdr->ih_type) {
@@ -808,6 +944,8 @@ do_bootm_linux (cmd_tbl_t *cmdtp, int flag,
 
 	SHOW_BOOT_PROGRESS (15);
 
+	bootm_flush ();		/* last messages before the kernel takes over */
+
 #ifndef CONFIG_OF_FLAT_TREE
 
 #if defined(CFG_INIT_RAM_LOCK) && !defined(CONFIG_E500)
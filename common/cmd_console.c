@@ -56,6 +56,9 @@ int do_coninfo (cmd_tbl_t * cmd, int flag, int argc, char *argv[])
 		}
 		putc ('\n');
 	}
+#ifdef CFG_NS16550_TXBUF
+	serial_txinfo ();
+#endif
 	return 0;
 }
 
@@ -42,6 +42,9 @@
 #endif
 #include <ide.h>
 #include <ata.h>
+#ifdef CONFIG_DEFERRED_INIT
+#include <deferred.h>
+#endif
 #ifdef CONFIG_STATUS_LED
 # include <status_led.h>
 #endif
@@ -345,6 +348,12 @@ int do_ide (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 #endif
 
 		n = ide_write (curr_device, blk, cnt, (ulong *)addr);
+#ifdef CONFIG_BLOCK_CACHE
+		blkcache_invalidate (&ide_dev_desc[curr_device]);
+#endif
+#ifdef CONFIG_PART_CACHE
+		part_cache_invalidate (&ide_dev_desc[curr_device]);
+#endif
 
 		printf ("%ld blocks written: %s\n",
 			n, (n==cnt) ? "OK" : "ERROR");
@@ -494,20 +503,17 @@ int do_diskboot (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 
 /* ------------------------------------------------------------------------- */
 
-void ide_init (void)
+/*
+ * Everything ide_init() does before waiting for the busses to get ready;
+ * returns -1 if there is nothing to probe.
+ */
+static int ide_init_start (void)
 {
-
 #ifdef CONFIG_IDE_8xx_DIRECT
 	DECLARE_GLOBAL_DATA_PTR;
 	volatile immap_t *immr = (immap_t *)CFG_IMMR;
 	volatile pcmconf8xx_t *pcmp = &(immr->im_pcmcia);
-#endif
-	unsigned char c;
-	int i, bus;
-#ifdef CONFIG_AMIGAONEG3SE
-	unsigned int max_bus_scan;
-	unsigned int ata_reset_time;
-	char *s;
+	int i;
 #endif
 #ifdef CONFIG_IDE_8xx_PCCARD
 	extern int pcmcia_on (void);
@@ -520,21 +526,18 @@ void ide_init (void)
 
 	if (ide_preinit ()) {
 		puts ("ide_preinit failed\n");
-		return;
+		return -1;
 	}
 #endif	/* CONFIG_IDE_PREINIT */
 
 #ifdef CONFIG_IDE_8xx_PCCARD
-	extern int pcmcia_on (void);
-	extern int ide_devices_found; /* Initialized in check_ide_device() */
-
 	WATCHDOG_RESET();
 
 	ide_devices_found = 0;
 	/* initialize the PCMCIA IDE adapter card */
 	pcmcia_on();
 	if (!ide_devices_found)
-		return;
+		return -1;
 	udelay (1000000);	/* 1 s */
 #endif	/* CONFIG_IDE_8xx_PCCARD */
 
@@ -574,6 +577,61 @@ void ide_init (void)
 	set_pcmcia_timing (pio_mode);
 #endif /* CONFIG_IDE_8xx_DIRECT */
 
+	return 0;
+}
+
+/*
+ * Identify the devices on all busses which answered the reset
+ */
+static void ide_ident_all (int verbose)
+{
+	int i;
+
+	curr_device = -1;
+	for (i=0; i<CFG_IDE_MAXDEVICE; ++i) {
+#ifdef CONFIG_IDE_LED
+		int led = (IDE_BUS(i) == 0) ? LED_IDE1 : LED_IDE2;
+#endif
+		ide_dev_desc[i].type=DEV_TYPE_UNKNOWN;
+		ide_dev_desc[i].if_type=IF_TYPE_IDE;
+		ide_dev_desc[i].dev=i;
+		ide_dev_desc[i].part_type=PART_TYPE_UNKNOWN;
+		ide_dev_desc[i].blksz=0;
+		ide_dev_desc[i].lba=0;
+		ide_dev_desc[i].block_read=ide_read;
+		if (!ide_bus_ok[IDE_BUS(i)])
+			continue;
+		ide_led (led, 1);		/* LED on	*/
+		ide_ident(&ide_dev_desc[i]);
+		ide_led (led, 0);		/* LED off	*/
+		if (verbose)
+			dev_print(&ide_dev_desc[i]);
+/*		ide_print (i); */
+		if ((ide_dev_desc[i].lba > 0) && (ide_dev_desc[i].blksz > 0)) {
+			init_part (&ide_dev_desc[i]);			/* initialize partition type */
+			if (curr_device < 0)
+				curr_device = i;
+		}
+	}
+	WATCHDOG_RESET();
+}
+
+void ide_init (void)
+{
+	unsigned char c;
+	int i, bus;
+#ifdef CONFIG_AMIGAONEG3SE
+	unsigned int max_bus_scan;
+	unsigned int ata_reset_time;
+	char *s;
+#endif
+#ifdef CONFIG_IDE_8xx_PCCARD
+	extern int ide_devices_found; /* Initialized in check_ide_device() */
+#endif	/* CONFIG_IDE_8xx_PCCARD */
+
+	if (ide_init_start () < 0)
+		return;
+
 	/*
 	 * Wait for IDE to get ready.
 	 * According to spec, this can take up to 31 seconds!
@@ -662,33 +720,98 @@ void ide_init (void)
 
 	ide_led ((LED_IDE1 | LED_IDE2), 0);	/* LED's off	*/
 
-	curr_device = -1;
-	for (i=0; i<CFG_IDE_MAXDEVICE; ++i) {
-#ifdef CONFIG_IDE_LED
-		int led = (IDE_BUS(i) == 0) ? LED_IDE1 : LED_IDE2;
+	ide_ident_all (1);
+}
+
+#ifdef CONFIG_DEFERRED_INIT
+#if !defined(CONFIG_IDE_8xx_PCCARD) && !defined(CONFIG_AMIGAONEG3SE)
+/*
+ * The bus scan of ide_init() as a deferred state machine: the drives
+ * spin up while the autoboot delay is running.
+ */
+enum {
+	IDE_DI_SELECT = 0,	/* start the scan of bus ide_di_bus */
+	IDE_DI_DEVICE,		/* select the first device of the bus */
+	IDE_DI_BUSY,		/* wait for the device to clear BUSY */
+};
+
+static deferred_init_t ide_deferred;
+static int ide_di_bus;
+static ulong ide_di_start;
+
+static int ide_init_step (deferred_init_t *di)
+{
+	int dev = ide_di_bus * (CFG_IDE_MAXDEVICE / CFG_IDE_MAXBUS);
+	unsigned char c;
+
+	switch (di->state) {
+	case IDE_DI_SELECT:
+		ide_bus_ok[ide_di_bus] = 0;
+		di->state = IDE_DI_DEVICE;
+		deferred_init_sleep (di, 100);
+		return DEFERRED_BUSY;
+
+	case IDE_DI_DEVICE:
+		ide_outb (dev, ATA_DEV_HD, ATA_LBA | ATA_DEVICE(dev));
+		ide_di_start = get_timer (0);
+		di->state = IDE_DI_BUSY;
+		deferred_init_sleep (di, 100);
+		return DEFERRED_BUSY;
+
+	case IDE_DI_BUSY:
+		c = ide_inb (dev, ATA_STATUS);
+		if (c & ATA_STAT_BUSY) {
+			if (get_timer (ide_di_start) > ATA_RESET_TIME * 1000) {
+				/* same as ide_init(): give up on all busses */
+				printf ("IDE bus %d: ** Timeout **\n", ide_di_bus);
+				ide_led ((LED_IDE1 | LED_IDE2), 0);
+				return DEFERRED_DONE;
+			}
+			deferred_init_sleep (di, 10);
+			return DEFERRED_BUSY;
+		}
+
+		debug ("IDE bus %d: Status = 0x%02X\n", ide_di_bus, c);
+		ide_bus_ok[ide_di_bus] = (c & ATA_STAT_FAULT) == 0;
+#ifndef CONFIG_ATAPI /* ATAPI Devices do not set DRDY */
+		if ((c & ATA_STAT_READY) == 0)
+			ide_bus_ok[ide_di_bus] = 0;
 #endif
-		ide_dev_desc[i].type=DEV_TYPE_UNKNOWN;
-		ide_dev_desc[i].if_type=IF_TYPE_IDE;
-		ide_dev_desc[i].dev=i;
-		ide_dev_desc[i].part_type=PART_TYPE_UNKNOWN;
-		ide_dev_desc[i].blksz=0;
-		ide_dev_desc[i].lba=0;
-		ide_dev_desc[i].block_read=ide_read;
-		if (!ide_bus_ok[IDE_BUS(i)])
-			continue;
-		ide_led (led, 1);		/* LED on	*/
-		ide_ident(&ide_dev_desc[i]);
-		ide_led (led, 0);		/* LED off	*/
-		dev_print(&ide_dev_desc[i]);
-/*		ide_print (i); */
-		if ((ide_dev_desc[i].lba > 0) && (ide_dev_desc[i].blksz > 0)) {
-			init_part (&ide_dev_desc[i]);			/* initialize partition type */
-			if (curr_device < 0)
-				curr_device = i;
+		WATCHDOG_RESET();
+
+		if (++ide_di_bus < CFG_IDE_MAXBUS) {
+			di->state = IDE_DI_SELECT;
+			return DEFERRED_BUSY;
 		}
+		break;
 	}
-	WATCHDOG_RESET();
+
+	ide_led ((LED_IDE1 | LED_IDE2), 0);	/* LED's off	*/
+	ide_ident_all (0);
+	return DEFERRED_DONE;
+}
+#endif	/* !CONFIG_IDE_8xx_PCCARD && !CONFIG_AMIGAONEG3SE */
+
+/*
+ * ide_init() for board_init_r(): reset the busses, but leave waiting
+ * for the drives and identifying them to deferred_init_poll().
+ */
+void ide_init_deferred (void)
+{
+#if defined(CONFIG_IDE_8xx_PCCARD) || defined(CONFIG_AMIGAONEG3SE)
+	ide_init ();	/* board specific bus scan, not deferred */
+#else
+	if (ide_init_start () < 0)
+		return;
+
+	puts ("deferred\n");
+	ide_di_bus = 0;
+	ide_deferred.name = "ide";
+	ide_deferred.step = ide_init_step;
+	deferred_init_register (&ide_deferred);
+#endif
 }
+#endif	/* CONFIG_DEFERRED_INIT */
 
 /* ------------------------------------------------------------------------- */
 
@@ -424,6 +424,7 @@ extern int os_data_header[8];
 static void set_kerm_bin_mode(unsigned long *);
 static int k_recv(void);
 static ulong load_serial_bin (ulong offset);
+static ulong load_serial_ymodem (ulong offset, int streaming);
 
 
 char his_eol;        /* character he needs at end of packet */
@@ -431,6 +432,11 @@ int  his_pad_count;  /* number of pad chars he needs */
 char his_pad_char;   /* pad chars he needs */
 char his_quote;      /* quote chars he'll use */
 
+#ifndef CFG_KERMIT_WINDOW
+#define CFG_KERMIT_WINDOW	16	/* max. sliding window size (1..31) */
+#endif
+static int k_window;		/* negotiated window size, 1 = stop-and-wait */
+
 int do_load_serial_bin (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 {
 	DECLARE_GLOBAL_DATA_PTR;
@@ -439,8 +445,20 @@ int do_load_serial_bin (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 	ulong addr;
 	int load_baudrate, current_baudrate;
 	int rcode = 0;
+	int ymodem = 0, streaming = 0;
+	char *proto;
 	char *s;
 
+	if (strcmp (argv[0], "loady") == 0) {
+		ymodem = 1;
+		if (argc >= 2 && strcmp (argv[1], "-g") == 0) {
+			streaming = 1;	/* YMODEM-g */
+			--argc;
+			++argv;
+		}
+	}
+	proto = ymodem ? (streaming ? "ymodem-g" : "ymodem") : "kermit";
+
 	/* pre-set offset from CFG_LOAD_ADDR */
 	offset = CFG_LOAD_ADDR;
 
@@ -475,15 +493,19 @@ int do_load_serial_bin (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 		}
 	}
 
-	printf ("## Ready for binary (kermit) download "
+	printf ("## Ready for binary (%s) download "
 		"to 0x%08lX at %d bps...\n",
+		proto,
 		offset,
 		load_baudrate);
-	addr = load_serial_bin (offset);
+	if (ymodem)
+		addr = load_serial_ymodem (offset, streaming);
+	else
+		addr = load_serial_bin (offset);
 
 	if (addr == ~0) {
 		load_addr = 0;
-		printf ("## Binary (kermit) download aborted\n");
+		printf ("## Binary (%s) download aborted\n", proto);
 		rcode = 1;
 	} else {
 		printf ("## Start Addr      = 0x%08lX\n", addr);
@@ -702,7 +724,8 @@ char *send_ptr;
 void handle_send_packet (int n)
 {
 	int length = 3;
-	int bytes;
+	int bytes, total, i;
+	int windo;
 
 	/* initialize some protocol parameters */
 	his_eol = END_CHAR;		/* default end of line character */
@@ -714,6 +737,8 @@ void handle_send_packet (int n)
 	if (send_ptr == &send_parms[SEND_DATA_SIZE - 1])
 		--send_ptr;
 	bytes = send_ptr - send_parms;	/* how many bytes we'll process */
+	total = bytes;
+	k_window = 1;
 	do {
 		if (bytes-- <= 0)
 			break;
@@ -767,9 +792,22 @@ void handle_send_packet (int n)
 		if (bytes-- <= 0)
 			break;
 		/* handle CAPAS - the capabilities mask */
-		/* ignore what he says - I only do long packets - I don't do windows */
-		a_b[++length] = tochar (2);	/* only long packets */
-		a_b[++length] = tochar (0);	/* no windows */
+		/* I do long packets - and sliding windows if he offers them */
+		for (i = 9; i < total - 1 && (untochar (send_parms[i]) & 1); ++i)
+			;	/* skip continued capability bytes */
+		windo = 0;
+		if ((untochar (send_parms[9]) & 4) && i + 1 < total) {
+			/* handle WINDO - the window size he proposes */
+			windo = untochar (send_parms[i + 1]);
+			if (windo > CFG_KERMIT_WINDOW)
+				windo = CFG_KERMIT_WINDOW;
+			if (windo > 1)
+				k_window = windo;
+			else
+				windo = 0;
+		}
+		a_b[++length] = tochar (windo ? 2 | 4 : 2);
+		a_b[++length] = tochar (windo);
 		a_b[++length] = tochar (94);	/* large packet msb */
 		a_b[++length] = tochar (94);	/* large packet lsb */
 	} while (0);
@@ -793,7 +831,8 @@ static int k_recv (void)
 	int sum;
 	int done;
 	int length;
-	int n, last_n;
+	int n, expect;
+	int accept;
 	int z = 0;
 	int len_lo, len_hi;
 
@@ -810,7 +849,9 @@ static int k_recv (void)
 	k_state_saved = k_state;
 	k_data_save ();
 	n = 0;				/* just to get rid of a warning */
-	last_n = -1;
+	expect = -1;			/* any sequence number, until 'S' */
+	accept = 0;
+	k_window = 1;
 
 	/* expect this "type" sequence (but don't check):
 	   S: send initiate
@@ -866,24 +907,12 @@ START:
 		n = untochar (new_char);
 		--length;
 
-		/* NEW CODE - check sequence numbers for retried packets */
-		/* Note - this new code assumes that the sequence number is correctly
-		 * received.  Handling an invalid sequence number adds another layer
-		 * of complexity that may not be needed - yet!  At this time, I'm hoping
-		 * that I don't need to buffer the incoming data packets and can write
-		 * the data into memory in real time.
+		/* Data is written to memory in real time, so only the packet
+		 * we expect next is used. Retries of packets already taken
+		 * and (with sliding windows) packets following a lost one
+		 * are read but dropped; see the end of the loop.
 		 */
-		if (n == last_n) {
-			/* same sequence number, restore the previous state */
-			k_state = k_state_saved;
-			k_data_restore ();
-		} else {
-			/* new sequence number, checkpoint the download */
-			last_n = n;
-			k_state_saved = k_state;
-			k_data_save ();
-		}
-		/* END NEW CODE */
+		accept = (expect < 0 || n == expect);
 
 		/* get packet type */
 		new_char = getc ();
@@ -925,7 +954,8 @@ START:
 			--length;
 			if (k_state == DATA_TYPE) {
 				/* pass on the data if this is a data packet */
-				k_data_char (new_char);
+				if (accept)
+					k_data_char (new_char);
 			} else if (k_state == SEND_TYPE) {
 				/* save send pack in buffer as is */
 				*send_ptr++ = new_char;
@@ -948,13 +978,31 @@ START:
 			k_state = k_state_saved;
 			k_data_restore ();
 			/* send a negative acknowledge packet in */
-			send_nack (n);
+			send_nack (expect < 0 ? n : expect);
+		} else if (!accept) {
+			if (((expect - n) & 63) > k_window) {
+				/* ahead of a lost packet - ask for that one */
+				send_nack (expect);
+			} else if (k_state == SEND_TYPE) {
+				/* our ack got lost, repeat it */
+				handle_send_packet (n);
+			} else {
+				send_ack (n);
+			}
 		} else if (k_state == SEND_TYPE) {
 			/* crack the protocol parms, build an appropriate ack packet */
 			handle_send_packet (n);
+			expect = (n + 1) & 63;
+			/* checkpoint the download */
+			k_state_saved = k_state;
+			k_data_save ();
 		} else {
 			/* send simple acknowledge packet in */
 			send_ack (n);
+			expect = (n + 1) & 63;
+			/* checkpoint the download */
+			k_state_saved = k_state;
+			k_data_save ();
 			/* quit if end of transmission */
 			if (k_state == BREAK_TYPE)
 				done = 1;
@@ -963,6 +1011,215 @@ START:
 	}
 	return ((ulong) os_data_addr - (ulong) bin_start_address);
 }
+
+/*
+ * YMODEM-1K receiver (and YMODEM-g, its streaming variant without
+ * per-block acknowledges), working on the plain console getc/tstc.
+ * The data blocks are received straight into memory at the load
+ * address; the file size from the header block trims the padding.
+ */
+#define Y_SOH		0x01	/* 128 byte block */
+#define Y_STX		0x02	/* 1024 byte block */
+#define Y_EOT		0x04
+#define Y_ACK		0x06
+#define Y_NAK		0x15
+#define Y_CAN		0x18
+#define Y_CHAR_TIMEOUT	1000	/* ms, within a block */
+#define Y_BLOCK_TIMEOUT	10000	/* ms, between blocks */
+#define Y_START_RETRIES	60	/* 'C'/'G' requests, one per second */
+#define Y_MAX_ERRORS	10
+
+static int y_getc (int ms)
+{
+	ulong start = get_timer (0);
+
+	while (!tstc ()) {
+		if (get_timer (start) >= (ulong)ms * CFG_HZ / 1000)
+			return -1;
+	}
+	return getc () & 0xff;
+}
+
+static void y_purge (void)
+{
+	while (y_getc (Y_CHAR_TIMEOUT) >= 0)
+		;
+}
+
+static void y_cancel (void)
+{
+	int i;
+
+	for (i = 0; i < 5; ++i)
+		putc (Y_CAN);
+}
+
+static ushort y_crc16 (ushort crc, uchar c)
+{
+	int i;
+
+	crc ^= (ushort)c << 8;
+	for (i = 0; i < 8; ++i)
+		crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	return crc;
+}
+
+/*
+ * Receive a block after its SOH/STX. The CRC is updated as the
+ * characters come in, so nothing is left to do after the last one.
+ * Returns the block number or -1.
+ */
+static int y_recv_block (uchar *buf, int size)
+{
+	int blk, nblk, c, i;
+	ushort crc = 0;
+
+	if ((blk = y_getc (Y_CHAR_TIMEOUT)) < 0 ||
+	    (nblk = y_getc (Y_CHAR_TIMEOUT)) < 0)
+		return -1;
+	for (i = 0; i < size; ++i) {
+		if ((c = y_getc (Y_CHAR_TIMEOUT)) < 0)
+			return -1;
+		buf[i] = c;
+		crc = y_crc16 (crc, c);
+	}
+	for (i = 0; i < 2; ++i) {
+		if ((c = y_getc (Y_CHAR_TIMEOUT)) < 0)
+			return -1;
+		crc = y_crc16 (crc, c);
+	}
+	if ((blk ^ nblk) != 0xff || crc != 0)
+		return -1;
+	return blk;
+}
+
+/*
+ * Wait for the header block (block 0) of the next file.
+ * Returns 1 if a file follows, 0 at the end of the batch, -1 on error.
+ */
+static int y_recv_header (uchar *hdr, char start, int retries)
+{
+	int c;
+
+	while (retries-- > 0) {
+		putc (start);
+		switch (c = y_getc (1000)) {
+		case Y_SOH:
+		case Y_STX:
+			if (y_recv_block (hdr, c == Y_SOH ? 128 : 1024) == 0)
+				return hdr[0] ? 1 : 0;
+			y_purge ();
+			break;
+		case Y_CAN:
+			if (y_getc (Y_CHAR_TIMEOUT) == Y_CAN)
+				return -1;
+			break;
+		case 0x03:			/* ^C */
+			return -1;
+		default:
+			break;
+		}
+	}
+	return -1;
+}
+
+static ulong load_serial_ymodem (ulong offset, int streaming)
+{
+	uchar hdr[1024];
+	uchar *dest = (uchar *)offset;
+	char start = streaming ? 'G' : 'C';
+	ulong filesize, size, start_time, ms;
+	int expect, errors, c, blk, len, rc;
+	char buf[32];
+
+	rc = y_recv_header (hdr, start, Y_START_RETRIES);
+	if (rc <= 0) {
+		y_cancel ();
+		return ~0;
+	}
+	start_time = get_timer (0);
+
+	/* "name\0size [mtime mode ...]" */
+	filesize = simple_strtoul ((char *)hdr + strlen ((char *)hdr) + 1,
+				   NULL, 10);
+	if (!streaming)
+		putc (Y_ACK);
+	putc (start);
+
+	size = 0;
+	expect = 1;
+	errors = 0;
+	for (;;) {
+		c = y_getc (Y_BLOCK_TIMEOUT);
+		if (c == Y_EOT) {
+			putc (Y_ACK);
+			break;
+		}
+		if (c == Y_CAN) {
+			if (y_getc (Y_CHAR_TIMEOUT) == Y_CAN)
+				return ~0;
+			continue;
+		}
+		if (c == Y_SOH || c == Y_STX) {
+			len = (c == Y_SOH) ? 128 : 1024;
+			blk = y_recv_block (dest + size, len);
+			if (blk == (expect & 0xff)) {
+				size += len;
+				++expect;
+				errors = 0;
+				if (!streaming)
+					putc (Y_ACK);
+				continue;
+			}
+			if (blk >= 0 && blk == ((expect - 1) & 0xff)) {
+				/* repeated after a lost ACK; the copy went
+				 * where the next block will be stored */
+				putc (Y_ACK);
+				continue;
+			}
+			if (blk >= 0) {
+				/* out of sync, no way to recover */
+				y_cancel ();
+				return ~0;
+			}
+		}
+		/* bad block, garbage or timeout */
+		if (streaming || ++errors > Y_MAX_ERRORS) {
+			y_cancel ();
+			return ~0;
+		}
+		y_purge ();
+		putc (Y_NAK);
+	}
+
+	/* only one file is loaded; refuse the rest of a batch */
+	rc = y_recv_header (hdr, start, Y_MAX_ERRORS);
+	if (rc == 0)
+		putc (Y_ACK);
+	else if (rc > 0)
+		y_cancel ();
+
+	ms = get_timer (start_time) * 1000 / CFG_HZ;
+
+	if (filesize && filesize < size)
+		size = filesize;
+
+	/* Gather trailing characters, as for kermit */
+	y_purge ();
+
+	flush_cache (offset, size);
+
+	if (rc > 0)
+		printf ("## Only the first file of the batch was loaded\n");
+	printf ("## Total Size      = 0x%08lx = %ld Bytes\n", size, size);
+	if (ms)
+		printf ("## Throughput      = %ld Bytes/s\n",
+			size / ms * 1000 + (size % ms) * 1000 / ms);
+	sprintf (buf, "%lX", size);
+	setenv ("filesize", buf);
+
+	return offset;
+}
 #endif	/* CFG_CMD_LOADB */
 
 /* -------------------------------------------------------------------- */
@@ -1022,6 +1279,15 @@ U_BOOT_CMD(
 	" with offset 'off' and baudrate 'baud'\n"
 );
 
+U_BOOT_CMD(
+	loady, 4, 0,	do_load_serial_bin,
+	"loady   - load binary file over serial line (ymodem mode)\n",
+	"[ -g ] [ off ] [ baud ]\n"
+	"    - load binary file over serial line"
+	" with offset 'off' and baudrate 'baud'\n"
+	"      using YMODEM-1K, or YMODEM-g (no acknowledges) with '-g'\n"
+);
+
 #endif	/* CFG_CMD_LOADB */
 
 /* -------------------------------------------------------------------- */
@@ -29,6 +29,9 @@
 
 #include <common.h>
 #include <command.h>
+#include <memtest.h>
+#include <malloc.h>
+#include <region.h>
 #if (CONFIG_COMMANDS & CFG_CMD_MMC)
 #include <mmc.h>
 #endif
@@ -685,10 +688,47 @@ int do_mem_loopw (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 }
 #endif /* CONFIG_LOOPW */
 
+/*
+ * "mtest -f": a single run of the fused, cache line based test from
+ * common/memtest.c, with the throughput of every pass.
+ */
+static int mem_mtest_fast (int argc, char *argv[])
+{
+	memtest_result_t res;
+	ulong start, end;
+	int pass, rcode;
+
+	start = (argc > 1) ? simple_strtoul (argv[1], NULL, 16)
+			   : CFG_MEMTEST_START;
+	end   = (argc > 2) ? simple_strtoul (argv[2], NULL, 16)
+			   : CFG_MEMTEST_END;
+
+	printf ("Testing %08lx ... %08lx:\n", start, end);
+
+	rcode = memtest_fast (start, end, &res);
+
+	for (pass = 0; pass < res.pass; pass++) {
+		printf ("  %-20s %6ld ms %6ld MB/s\n",
+			memtest_pass_name[pass], res.ms[pass],
+			memtest_rate (res.bytes, res.ms[pass]));
+	}
+	if (rcode != 0) {
+		printf ("  %-20s FAILED @ 0x%08lx: "
+			"expected %08lx, actual %08lx\n",
+			memtest_pass_name[res.pass],
+			res.addr, res.expected, res.actual);
+		return 1;
+	}
+	printf ("%ld bytes OK using %s\n", res.bytes,
+		res.burst ? "cache line bursts" : "word accesses");
+	return 0;
+}
+
 /*
  * Perform a memory test. A more complete alternative test can be
  * configured using CFG_ALT_MEMTEST. The complete test loops until
  * interrupted by ctrl-c or by a failure of one of the sub-tests.
+ * "mtest -f" runs the fast test above once instead.
  */
 int do_mem_mtest (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 {
@@ -728,6 +768,9 @@ int do_mem_mtest (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 	int     rcode = 0;
 #endif
 
+	if (argc > 1 && strcmp (argv[1], "-f") == 0)
+		return mem_mtest_fast (argc - 1, argv + 1);
+
 	if (argc > 1) {
 		start = (ulong *)simple_strtoul(argv[1], NULL, 16);
 	} else {
@@ -1185,6 +1228,29 @@ int do_mem_crc (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 }
 #endif	/* CONFIG_CRC32_VERIFY */
 
+#if (CONFIG_COMMANDS & CFG_CMD_MEMORY)
+/*
+ * Allocation statistics: the malloc() arena, then the regions and
+ * pools built on it. "Outside top" is free memory which sits in holes
+ * between allocated chunks rather than in the top chunk, a measure of
+ * how fragmented the arena is.
+ */
+int do_mem_mstat (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	struct mallinfo mi = mallinfo ();
+
+	printf ("malloc %7d bytes from arena, %7d in use, %7d free "
+		"in %d chunks\n", mi.arena, mi.uordblks, mi.fordblks,
+		mi.ordblks);
+	if (mi.fordblks > 0)
+		printf ("       %7d bytes (%d%%) free outside top chunk\n",
+			mi.fordblks - mi.keepcost,
+			(mi.fordblks - mi.keepcost) * 100 / mi.fordblks);
+	region_info ();
+	return 0;
+}
+#endif
+
 /**************************************************/
 #if (CONFIG_COMMANDS & CFG_CMD_MEMORY)
 U_BOOT_CMD(
@@ -1272,6 +1338,15 @@ U_BOOT_CMD(
 	"mtest   - simple RAM test\n",
 	"[start [end [pattern]]]\n"
 	"    - simple RAM read/write test\n"
+	"mtest -f [start [end]]\n"
+	"    - single fast pass using cache line bursts, with MB/s report\n"
+);
+
+U_BOOT_CMD(
+	mstat,    1,    1,     do_mem_mstat,
+	"mstat   - show memory allocation statistics\n",
+	"\n    - print malloc() arena usage and fragmentation, and\n"
+	"      the use of each region and object pool\n"
 );
 
 #ifdef CONFIG_MX_CYCLIC
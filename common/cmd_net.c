@@ -249,6 +249,27 @@ U_BOOT_CMD(
 );
 #endif	/* CFG_CMD_PING */
 
+int do_arp (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	if (argc == 1) {
+		ArpCachePrint();
+		return 0;
+	}
+	if (strcmp(argv[1], "flush") == 0) {
+		ArpCacheFlush();
+		return 0;
+	}
+	printf ("Usage:\n%s\n", cmdtp->usage);
+	return 1;
+}
+
+U_BOOT_CMD(
+	arp,	2,	1,	do_arp,
+	"arp\t- show or flush the ARP cache\n",
+	"\n    - list IP and ethernet addresses learned from the network\n"
+	"arp flush\n    - forget all entries\n"
+);
+
 #if (CONFIG_COMMANDS & CFG_CMD_CDP)
 
 static void cdp_update_env(void)
@@ -49,6 +49,9 @@
 #if (CONFIG_COMMANDS & CFG_CMD_NET)
 #include <net.h>
 #endif
+#ifdef CFG_HUSH_PARSER
+#include <hush.h>
+#endif
 
 #if !defined(CFG_ENV_IS_IN_NVRAM)	&& \
     !defined(CFG_ENV_IS_IN_EEPROM)	&& \
@@ -167,6 +170,11 @@ int _do_setenv (int flag, int argc, char *argv[])
 
 	name = argv[1];
 
+#if defined(CFG_HUSH_PARSER) && defined(CFG_HUSH_RUN_CACHE)
+	/* "run" must not use a tree parsed from the old value */
+	hush_run_cache_forget (name);
+#endif
+
 	/*
 	 * search if variable with this name already exists
 	 */
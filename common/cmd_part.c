@@ -0,0 +1,48 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Partition table cache
+ */
+#include <common.h>
+#include <command.h>
+#include <part.h>
+
+#if defined(CONFIG_PART_CACHE)
+
+int do_part (cmd_tbl_t * cmdtp, int flag, int argc, char *argv[])
+{
+	if (argc == 2 && strcmp (argv[1], "list") == 0) {
+		part_cache_list ();
+		return 0;
+	}
+	printf ("Usage:\n%s\n", cmdtp->usage);
+	return 1;
+}
+
+U_BOOT_CMD(
+	part,	2,	1,	do_part,
+	"part    - show cached partition tables\n",
+	"list\n    - list the partitions of all cached devices\n"
+);
+
+#endif	/* CONFIG_PART_CACHE */
@@ -0,0 +1,127 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+
+/*
+ * Deferred device initialization
+ *
+ * Disks spinning up and PHYs negotiating a link take seconds, during
+ * which the boot code used to sit in udelay() loops - only to wait
+ * another few seconds in abortboot() afterwards. Drivers which support
+ * it register a small state machine here instead of waiting; the steps
+ * are advanced from the autoboot countdown and from the idle loop of
+ * the command line, so the settling times overlap each other and the
+ * boot delay. Before any command is executed all pending steps are
+ * run to completion, so commands always see fully initialized devices.
+ *
+ * A step must not block for more than a few milliseconds. It returns
+ * DEFERRED_BUSY to be called again (at the earliest after the time set
+ * with deferred_init_sleep()) or DEFERRED_DONE when it has finished.
+ */
+
+#include <common.h>
+#include <deferred.h>
+#include <watchdog.h>
+
+#if defined(CONFIG_DEFERRED_INIT)
+
+static deferred_init_t *deferred_list;
+static int deferred_running;	/* don't re-enter from within a step */
+
+void deferred_init_register (deferred_init_t *di)
+{
+	deferred_init_t **p;
+
+	di->state = 0;
+	di->start = di->wake = get_timer (0);
+
+	/* keep registration order, and don't link an entry twice */
+	for (p = &deferred_list; *p != NULL; p = &(*p)->next) {
+		if (*p == di)
+			return;
+	}
+	di->next = NULL;
+	*p = di;
+}
+
+void deferred_init_sleep (deferred_init_t *di, ulong ms)
+{
+	di->wake = get_timer (0) + ms;
+}
+
+/*
+ * Run every step which is due once; returns the number of entries
+ * which are still pending.
+ */
+int deferred_init_poll (void)
+{
+	deferred_init_t **p, *di;
+	int pending = 0;
+
+	if (deferred_running)
+		return 0;
+	deferred_running = 1;
+
+	p = &deferred_list;
+	while ((di = *p) != NULL) {
+		if ((long)(get_timer (0) - di->wake) >= 0 &&
+		    (*di->step) (di) == DEFERRED_DONE) {
+			debug ("%s: done after %lu ms\n",
+				di->name, get_timer (di->start));
+			*p = di->next;
+			di->next = NULL;
+			continue;
+		}
+		pending++;
+		p = &di->next;
+	}
+
+	deferred_running = 0;
+	return pending;
+}
+
+static int deferred_init_pending (deferred_init_t *di)
+{
+	deferred_init_t *p;
+
+	for (p = deferred_list; p != NULL; p = p->next) {
+		if (p == di)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Wait until 'di' has finished, or until all entries have finished
+ * if 'di' is NULL.
+ */
+void deferred_init_wait (deferred_init_t *di)
+{
+	while (deferred_init_poll () > 0) {
+		if (di != NULL && !deferred_init_pending (di))
+			break;
+		WATCHDOG_RESET ();
+		udelay (1000);
+	}
+}
+
+#endif	/* CONFIG_DEFERRED_INIT */
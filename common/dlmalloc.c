@@ -949,6 +949,15 @@ void malloc_stats();
 #endif	/* 0 */			/* Moved to malloc.h */
 #include <common.h>
 
+#ifdef CFG_MALLOC_NO_CLEAR
+/*
+ * The malloc() area is not zeroed at boot, so memory fresh from sbrk()
+ * holds whatever was there before: calloc() must clear all of it.
+ */
+#undef MORECORE_CLEARS
+#define MORECORE_CLEARS 0
+#endif
+
 /*
   Emulation of sbrk for WIN32
   All code within the ifdef WIN32 is untested by me.
@@ -3066,8 +3075,7 @@ size_t malloc_usable_size(mem) Void_t* mem;
 
 /* Utility to update current_mallinfo for malloc_stats and mallinfo() */
 
-#if 0
-static void malloc_update_mallinfo()
+static void malloc_update_mallinfo(void)
 {
   int i;
   mbinptr b;
@@ -3099,12 +3107,13 @@ static void malloc_update_mallinfo()
   current_mallinfo.ordblks = navail;
   current_mallinfo.uordblks = sbrked_mem - avail;
   current_mallinfo.fordblks = avail;
+#if HAVE_MMAP
   current_mallinfo.hblks = n_mmaps;
+#endif
   current_mallinfo.hblkhd = mmapped_mem;
   current_mallinfo.keepcost = chunksize(top);
 
 }
-#endif	/* 0 */
 
 
 
@@ -3144,13 +3153,11 @@ void malloc_stats()
   mallinfo returns a copy of updated current mallinfo.
 */
 
-#if 0
 struct mallinfo mALLINFo()
 {
   malloc_update_mallinfo();
   return current_mallinfo;
 }
-#endif	/* 0 */
 
 
 
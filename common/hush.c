@@ -94,6 +94,9 @@
 #include <common.h>        /* readline */
 #include <hush.h>
 #include <command.h>        /* find_cmd */
+#ifdef CONFIG_DEFERRED_INIT
+#include <deferred.h>
+#endif
 /*cmd_boot.c*/
 extern int do_bootd (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[]);      /* do_bootd */
 #endif
@@ -314,6 +317,9 @@ struct variables *top_vars = &shell_ver;
 #else
 static int flag_repeat = 0;
 static int do_repeat = 0;
+/* run_list_real() returned in the middle of a "for", leaving the
+ * loop variable in the tree: the tree must not be run again */
+static int run_list_broken = 0;
 static struct variables *top_vars = NULL ;
 #endif /*__U_BOOT__ */
 
@@ -1548,6 +1554,7 @@ static int run_pipe_real(struct pipe *pi)
 	struct child_prog *child;
 	struct built_in_command *x;
 	char *p;
+	int sp;
 # if __GNUC__
 	/* Avoid longjmp clobbering */
 	(void) &i;
@@ -1561,6 +1568,7 @@ static int run_pipe_real(struct pipe *pi)
 	struct child_prog *child;
 	cmd_tbl_t *cmdtp;
 	char *p;
+	int sp;
 # if __GNUC__
 	/* Avoid longjmp clobbering */
 	(void) &i;
@@ -1627,6 +1635,7 @@ static int run_pipe_real(struct pipe *pi)
 			}
 			return EXIT_SUCCESS;   /* don't worry about errors in set_local_var() yet */
 		}
+		sp = child->sp;	/* the tree may be run again: leave it alone */
 		for (i = 0; is_assignment(child->argv[i]); i++) {
 			p = insert_var_value(child->argv[i]);
 #ifndef __U_BOOT__
@@ -1635,11 +1644,11 @@ static int run_pipe_real(struct pipe *pi)
 			set_local_var(p, 0);
 #endif
 			if (p != child->argv[i]) {
-				child->sp--;
+				sp--;
 				free(p);
 			}
 		}
-		if (child->sp) {
+		if (sp) {
 			char * str = NULL;
 
 			str = make_string((child->argv + i));
@@ -1703,6 +1712,10 @@ static int run_pipe_real(struct pipe *pi)
 #ifndef __U_BOOT__
 				rcode = x->function(child);
 #else
+#ifdef CONFIG_DEFERRED_INIT
+				/* commands expect the devices to be ready */
+				deferred_init_wait (NULL);
+#endif
 				/* OK - call function to do the command */
 
 				rcode = (cmdtp->cmd)
@@ -1846,6 +1859,8 @@ static int run_list_real(struct pipe *pi)
 				/* check Ctrl-C */
 				ctrlc();
 				if ((had_ctrlc())) {
+					if (list)
+						run_list_broken = 1;
 					return 1;
 				}
 #endif
@@ -1946,6 +1961,8 @@ static int run_list_real(struct pipe *pi)
 #else
 		if (rcode < -1) {
 			last_return_code = -rcode - 2;
+			if (list)
+				run_list_broken = 1;
 			return -2;	/* exit */
 		}
 		last_return_code=(rcode == 0) ? 0 : 1;
@@ -3252,6 +3269,143 @@ int parse_string_outer(char *s, int flag)
 #endif
 }
 
+#if defined(__U_BOOT__) && defined(CFG_HUSH_RUN_CACHE)
+/*
+ * "run" keeps the parse trees of the last CFG_HUSH_RUN_CACHE variables
+ * it ran, so that scripts which "run" the same variables over and over
+ * do not parse their text every time. The tree holds the text split
+ * into pipes and words; variables are still expanded as each command
+ * runs. An entry is only used while the variable holds the very text
+ * it was parsed from, and setenv drops it.
+ */
+struct run_cache {
+	char *name;		/* variable, NULL if the entry is free */
+	char *text;		/* its value when it was parsed */
+	ulong hash;		/* crc32 of text */
+	struct pipe *list;	/* the parse tree */
+	int busy;		/* being run */
+	int stale;		/* drop once it is no longer busy */
+	ulong used;		/* for LRU replacement */
+};
+
+static struct run_cache run_cache[CFG_HUSH_RUN_CACHE];
+static ulong run_cache_clock;
+
+static void run_cache_drop(struct run_cache *rc)
+{
+	free_pipe_list(rc->list, 0);
+	free(rc->name);
+	free(rc->text);
+	memset(rc, 0, sizeof(*rc));
+}
+
+/* called by setenv; IFS changes how any text is split into words */
+void hush_run_cache_forget(char *name)
+{
+	struct run_cache *rc;
+	int all = (strcmp(name, "IFS") == 0);
+
+	for (rc = run_cache; rc < &run_cache[CFG_HUSH_RUN_CACHE]; rc++) {
+		if (rc->name == NULL || (!all && strcmp(rc->name, name) != 0))
+			continue;
+		if (rc->busy)
+			rc->stale = 1;
+		else
+			run_cache_drop(rc);
+	}
+}
+
+/* The first half of parse_stream_outer(): parse one line, don't run it */
+static struct pipe *parse_string_tree(char *s, int flag)
+{
+	struct in_str input;
+	struct p_context ctx;
+	o_string temp=NULL_O_STRING;
+	char *p;
+	int rcode;
+
+	p = xmalloc(strlen(s) + 2);
+	strcpy(p, s);
+	strcat(p, "\n");
+	setup_string_in_str(&input, p);
+	ctx.type = flag;
+	initialize_context(&ctx);
+	update_ifs_map();
+	if (!(flag & FLAG_PARSE_SEMICOLON) || (flag & FLAG_REPARSING)) mapset((uchar *)";$&|", 0);
+	input.promptmode=1;
+	rcode = parse_stream(&temp, &ctx, &input, '\n');
+	if (rcode != 1 && ctx.old_flag == 0) {
+		done_word(&temp, &ctx);
+		done_pipe(&ctx,PIPE_SEQ);
+	} else {
+		if (ctx.old_flag != 0)
+			free(ctx.stack);
+		free_pipe_list(ctx.list_head,0);
+		ctx.list_head = NULL;
+	}
+	b_free(&temp);
+	free(p);
+	return ctx.list_head;
+}
+
+/* parse_string_outer() for the value TEXT of variable NAME */
+int parse_run_cached(char *name, char *text, int flag)
+{
+	struct run_cache *rc, *victim = NULL;
+	struct pipe *list;
+	ulong hash;
+	int code;
+
+	if (!text || !*text)
+		return 1;
+	hash = crc32(0, (uchar *)text, strlen(text));
+	for (rc = run_cache; rc < &run_cache[CFG_HUSH_RUN_CACHE]; rc++) {
+		if (rc->busy)
+			continue;	/* "run" of itself, or of a running entry */
+		if (rc->name == NULL) {
+			if (victim == NULL || victim->name != NULL)
+				victim = rc;
+			continue;
+		}
+		if (!rc->stale && rc->hash == hash &&
+		    strcmp(rc->name, name) == 0 && strcmp(rc->text, text) == 0)
+			break;
+		if (victim == NULL ||
+		    (victim->name != NULL && rc->used < victim->used))
+			victim = rc;
+	}
+	if (rc == &run_cache[CFG_HUSH_RUN_CACHE]) {
+		/* not cached; errors are reported by the normal path */
+		if (victim == NULL ||
+		    (list = parse_string_tree(text, flag)) == NULL)
+			return parse_string_outer(text, flag);
+		if (victim->name != NULL)
+			run_cache_drop(victim);
+		rc = victim;
+		rc->name = xstrdup(name);
+		rc->text = xstrdup(text);
+		rc->hash = hash;
+		rc->list = list;
+	}
+	rc->used = ++run_cache_clock;
+
+	rc->busy = 1;
+	run_list_broken = 0;
+	code = run_list_real(rc->list);
+	rc->busy = 0;
+	if (rc->stale || run_list_broken)
+		run_cache_drop(rc);
+	run_list_broken = 0;
+
+	/* as parse_stream_outer() does after run_list() */
+	if (code == -2)
+		code = 0;	/* exit */
+	else if (code == -1)
+		flag_repeat = 0;
+	return (code != 0) ? 1 : 0;
+}
+#endif	/* __U_BOOT__ && CFG_HUSH_RUN_CACHE */
+
 #ifndef __U_BOOT__
 static int parse_file_outer(FILE *f)
 #else
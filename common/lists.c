@@ -24,8 +24,6 @@
 
 #define LIST_SIGNATURE		CAT4CHARS('L', 'I', 'S', 'T');
 
-#define calloc(size,num)	malloc(size*num)
-
 /********************************************************************/
 
 Handle NewHandle (unsigned int numBytes)
@@ -36,6 +36,10 @@
 
 #include <post.h>
 
+#ifdef CONFIG_DEFERRED_INIT
+#include <deferred.h>
+#endif
+
 #if defined(CONFIG_BOOT_RETRY_TIME) && defined(CONFIG_RESET_TO_RETRY)
 extern int do_reset (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[]);		/* for do_reset() prototype */
 #endif
@@ -202,6 +206,9 @@ static __inline__ int abortboot(int bootdelay)
 			onesec = endtick(1);
 			bootremain = bootdelay;
 		}
+#endif
+#ifdef CONFIG_DEFERRED_INIT
+		deferred_init_poll ();
 #endif
 		if (tstc()) {
 			if (presskey_len < presskey_max) {
@@ -297,6 +304,9 @@ static __inline__ int abortboot(int bootdelay)
 # endif
 				break;
 			}
+#ifdef CONFIG_DEFERRED_INIT
+			deferred_init_poll ();
+#endif
 			udelay (10000);
 		}
 
@@ -601,6 +611,10 @@ int readline (const char *const prompt)
 #endif
 		WATCHDOG_RESET();		/* Trigger watchdog, if needed */
 
+#ifdef CONFIG_DEFERRED_INIT
+		while (!tstc() && deferred_init_poll() > 0)
+			;
+#endif
 #ifdef CONFIG_SHOW_ACTIVITY
 		while (!tstc()) {
 			extern void show_activity(int arg);
@@ -999,6 +1013,11 @@ int run_command (const char *cmd, int flag)
 		}
 #endif	/* CFG_CMD_BOOTD */
 
+#ifdef CONFIG_DEFERRED_INIT
+		/* commands expect the devices to be ready */
+		deferred_init_wait (NULL);
+#endif
+
 		/* OK - call function to do the command */
 		if ((cmdtp->cmd) (cmdtp, flag, argc, argv) != 0) {
 			rc = -1;
@@ -1036,10 +1055,16 @@ int do_run (cmd_tbl_t * cmdtp, int flag, int argc, char *argv[])
 #ifndef CFG_HUSH_PARSER
 		if (run_command (arg, flag) == -1)
 			return 1;
+#else
+#ifdef CFG_HUSH_RUN_CACHE
+		if (parse_run_cached(argv[i], arg,
+		    FLAG_PARSE_SEMICOLON | FLAG_EXIT_FROM_LOOP) != 0)
+			return 1;
 #else
 		if (parse_string_outer(arg,
 		    FLAG_PARSE_SEMICOLON | FLAG_EXIT_FROM_LOOP) != 0)
 			return 1;
+#endif
 #endif
 	}
 	return 0;
@@ -21,6 +21,7 @@
  * MA 02111-1307 USA
  */
 
+#include <common.h>
 
 /*
  * Check memory range for valid RAM. A simple memory test determines
@@ -75,3 +76,107 @@ long get_ram_size(volatile long *base, long maxsize)
 
 	return (maxsize);
 }
+
+#ifdef CFG_MEMSIZE_CACHE_ADDR
+/*
+ * Cached RAM sizing. The result of get_ram_size() is kept together
+ * with the memory controller setup in a record at CFG_MEMSIZE_CACHE_ADDR,
+ * protected by a CRC32. SDRAM keeps its contents over a warm reset, so
+ * if the record is still intact and was made with the same controller
+ * setup, the size is taken from it and the probe is skipped. After a
+ * power cycle the CRC does not match and the RAM is probed again.
+ *
+ * This runs before relocation, so all state, including the timing
+ * statistics, lives in the record itself.
+ */
+#define MEMSIZE_CACHE_MAGIC	0x4d53697a	/* "MSiz" */
+#define MEMSIZE_CACHE_REGS	16
+
+typedef struct memsize_cache {
+	ulong	magic;
+	ulong	base;
+	ulong	maxsize;
+	ulong	size;
+	ulong	nregs;
+	ulong	regs[MEMSIZE_CACHE_REGS];	/* memory controller setup */
+	ulong	crc;			/* CRC32 of the fields above */
+	/* boot statistics, not covered by the CRC */
+	ulong	hit;			/* size was taken from the record */
+	ulong	probe_ticks;		/* duration of the last full probe */
+	ulong	check_ticks;		/* duration of the last record check */
+} memsize_cache_t;
+
+#define MEMSIZE_CACHE_CRCLEN	((ulong)&((memsize_cache_t *)0)->crc)
+
+long get_ram_size_cached (volatile long *base, long maxsize,
+			  ulong *regs, int nregs)
+{
+	memsize_cache_t *mc = (memsize_cache_t *)CFG_MEMSIZE_CACHE_ADDR;
+	ulong start = (ulong)get_ticks ();
+	long size;
+	int i;
+
+	if (nregs > MEMSIZE_CACHE_REGS)
+		nregs = MEMSIZE_CACHE_REGS;
+
+	if (mc->magic   == MEMSIZE_CACHE_MAGIC &&
+	    mc->base    == (ulong)base &&
+	    mc->maxsize == maxsize &&
+	    mc->nregs   == nregs &&
+	    memcmp (mc->regs, regs, nregs * sizeof (ulong)) == 0 &&
+	    mc->crc == crc32 (0, (uchar *)mc, MEMSIZE_CACHE_CRCLEN)) {
+		mc->hit = 1;
+		mc->check_ticks = (ulong)get_ticks () - start;
+		return mc->size;
+	}
+
+	size = get_ram_size (base, maxsize);
+
+	/* don't scribble over memory which isn't there */
+	if (CFG_MEMSIZE_CACHE_ADDR + sizeof (*mc) > (ulong)base + size)
+		return size;
+
+	memset (mc, 0, sizeof (*mc));
+	mc->magic   = MEMSIZE_CACHE_MAGIC;
+	mc->base    = (ulong)base;
+	mc->maxsize = maxsize;
+	mc->size    = size;
+	mc->nregs   = nregs;
+	for (i = 0; i < nregs; i++)
+		mc->regs[i] = regs[i];
+	mc->crc = crc32 (0, (uchar *)mc, MEMSIZE_CACHE_CRCLEN);
+	mc->hit = 0;
+	mc->probe_ticks = (ulong)get_ticks () - start;
+
+	return size;
+}
+
+static ulong memsize_ticks2usec (ulong ticks)
+{
+	ulong tbclk = get_tbclk ();
+
+	/* ticks2usec() only has millisecond resolution */
+	if (ticks < 0x400000 && tbclk >= 1000)
+		return ticks * 1000 / (tbclk / 1000);
+	return ticks2usec (ticks);
+}
+
+/*
+ * Append the boot timing of the RAM sizing to the "DRAM:" line.
+ */
+void get_ram_size_report (void)
+{
+	memsize_cache_t *mc = (memsize_cache_t *)CFG_MEMSIZE_CACHE_ADDR;
+	ulong probe = memsize_ticks2usec (mc->probe_ticks);
+	ulong check = memsize_ticks2usec (mc->check_ticks);
+
+	if (mc->magic != MEMSIZE_CACHE_MAGIC)
+		return;
+	if (mc->hit) {
+		printf (" (cached: %ld us, %ld us saved)", check,
+			probe > check ? probe - check : 0);
+	} else {
+		printf (" (probed: %ld us)", probe);
+	}
+}
+#endif /* CFG_MEMSIZE_CACHE_ADDR */
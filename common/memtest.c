@@ -0,0 +1,187 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Fast RAM test shared by "mtest -f" and the memory POST.
+ *
+ * The classic tests make one pass over the whole range per pattern,
+ * writing it in one loop and reading it back in another. Here the
+ * patterns are chained instead: each pass verifies what the previous
+ * pass left in a cache line and immediately overwrites it with the
+ * next pattern, so five passes cover four patterns:
+ *
+ *	1. write address
+ *	2. check address,		write ~address
+ *	3. check ~address,		write checkerboard
+ *	4. check checkerboard,		write inverse checkerboard
+ *	5. check inverse checkerboard
+ *
+ * The checkerboard alternates 0x55555555 and 0xaaaaaaaa on 8 byte
+ * boundaries, so both halves of a 64 bit data bus see opposite values.
+ *
+ * With the data cache enabled every line is handled as a unit: the
+ * first pass allocates it with dcbz (no pointless read from RAM),
+ * and every pass ends with dcbf, which pushes the line to SDRAM as a
+ * single burst and invalidates it so the next pass really reads the
+ * memory again. Without a data cache, plain word accesses are used.
+ */
+
+#include <common.h>
+#include <watchdog.h>
+#include <memtest.h>
+
+#if (CONFIG_COMMANDS & CFG_CMD_MEMORY) || \
+    (defined(CONFIG_POST) && (CONFIG_POST & CFG_POST_MEMORY))
+
+#if defined(CONFIG_PPC) && defined(CFG_CACHELINE_SIZE)
+#define MT_LINE		CFG_CACHELINE_SIZE
+#define mt_dcbz(p)	asm volatile ("dcbz 0,%0" : : "r" (p) : "memory")
+#define mt_dcbf(p)	asm volatile ("dcbf 0,%0" : : "r" (p) : "memory")
+#define mt_sync()	asm volatile ("sync" : : : "memory")
+#else
+#define MT_LINE		32
+#define mt_dcbz(p)
+#define mt_dcbf(p)
+#define mt_sync()
+#endif
+
+#define MT_WORDS	(MT_LINE / sizeof (ulong))
+
+/* patterns, in the order they are written */
+#define MT_NONE		-1
+#define MT_ADDR		0
+#define MT_NADDR	1
+#define MT_CHECK	2
+#define MT_NCHECK	3
+
+const char *memtest_pass_name[MEMTEST_PASSES] = {
+	"write address",
+	"address/~address",
+	"~address/checker",
+	"checker/~checker",
+	"check ~checker",
+};
+
+/* pattern checked and pattern written by each pass */
+static const signed char mt_passes[MEMTEST_PASSES][2] = {
+	{ MT_NONE,	MT_ADDR   },
+	{ MT_ADDR,	MT_NADDR  },
+	{ MT_NADDR,	MT_CHECK  },
+	{ MT_CHECK,	MT_NCHECK },
+	{ MT_NCHECK,	MT_NONE   },
+};
+
+static inline ulong mt_pattern (int kind, ulong addr)
+{
+	ulong val;
+
+	switch (kind) {
+	case MT_ADDR:
+		return addr;
+	case MT_NADDR:
+		return ~addr;
+	}
+	val = 0x55555555 ^ (0 - ((addr >> 2) & 1));
+	return (kind == MT_CHECK) ? val : ~val;
+}
+
+static int mt_run (vu_long *start, vu_long *end, int check, int write,
+		   int burst, memtest_result_t *res)
+{
+	vu_long *line, *p;
+	ulong val;
+	int i;
+
+	for (line = start; line < end; line += MT_WORDS) {
+		if (check != MT_NONE) {
+			for (i = 0, p = line; i < MT_WORDS; i++, p++) {
+				/* read each location exactly once */
+				val = *p;
+				if (val != mt_pattern (check, (ulong)p)) {
+					res->addr     = (ulong)p;
+					res->expected = mt_pattern (check,
+								    (ulong)p);
+					res->actual   = val;
+					return -1;
+				}
+			}
+		} else if (burst) {
+			mt_dcbz (line);
+		}
+		if (write != MT_NONE) {
+			for (i = 0, p = line; i < MT_WORDS; i++, p++)
+				*p = mt_pattern (write, (ulong)p);
+		}
+		if (burst)
+			mt_dcbf (line);
+		if (((ulong)line & 0xffff) == 0)
+			WATCHDOG_RESET ();
+	}
+	if (burst)
+		mt_sync ();
+
+	return 0;
+}
+
+/*
+ * Test [start, end); both ends are rounded inwards to a cache line.
+ * Returns 0 on success, -1 on the first mismatch, which is described
+ * in *res together with the time taken by every completed pass.
+ */
+int memtest_fast (ulong start, ulong end, memtest_result_t *res)
+{
+	ulong t;
+	int pass;
+
+	start = (start + MT_LINE - 1) & ~(MT_LINE - 1);
+	end &= ~(MT_LINE - 1);
+
+	memset (res, 0, sizeof (*res));
+	res->bytes = (end > start) ? end - start : 0;
+#if defined(CONFIG_PPC) && defined(CFG_CACHELINE_SIZE)
+	res->burst = dcache_status ();
+#endif
+
+	for (pass = 0; pass < MEMTEST_PASSES; pass++) {
+		t = get_timer (0);
+		if (mt_run ((vu_long *)start, (vu_long *)end,
+			    mt_passes[pass][0], mt_passes[pass][1],
+			    res->burst, res) != 0) {
+			res->pass = pass;
+			return -1;
+		}
+		res->ms[pass] = get_timer (t);
+	}
+	res->pass = MEMTEST_PASSES;
+
+	return 0;
+}
+
+/* bytes in ms milliseconds, as MB/s */
+ulong memtest_rate (ulong bytes, ulong ms)
+{
+	if (ms == 0)
+		ms = 1;
+	return ((bytes >> 10) * 1000 / ms) >> 10;
+}
+
+#endif /* CFG_CMD_MEMORY || CFG_POST_MEMORY */
@@ -0,0 +1,200 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Region and pool allocators on top of malloc().
+ *
+ * File systems and the shell allocate lots of small, short lived
+ * objects; each malloc()/free() pair walks the dlmalloc bins and
+ * leaves holes in the arena. A region takes one block from malloc()
+ * and bumps a pointer through it: a command takes a mark, allocates
+ * what it needs and releases the mark when done. A pool keeps objects
+ * of one size on a free list, so allocating one is a pointer pop and
+ * only every "perblock"-th call goes to malloc().
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <region.h>
+
+#ifndef CFG_SCRATCH_LEN
+#define CFG_SCRATCH_LEN	(16 << 10)
+#endif
+
+#define REGION_ALIGN	8
+#define POOL_ALIGN	sizeof(ulong)
+
+region_t scratch_region = REGION_INIT ("scratch", CFG_SCRATCH_LEN);
+
+static region_t *regions;
+static pool_t *pools;
+
+static void region_link (region_t *r)
+{
+	region_t *p;
+
+	for (p = regions; p != NULL; p = p->next)
+		if (p == r)
+			return;
+	r->next = regions;
+	regions = r;
+}
+
+void region_init (region_t *r, const char *name, ulong size)
+{
+	memset (r, 0, sizeof (*r));
+	r->name = name;
+	r->size = size;
+}
+
+void *region_alloc (region_t *r, ulong size)
+{
+	ulong used = (r->used + REGION_ALIGN - 1) & ~(REGION_ALIGN - 1);
+
+	if (r->base == NULL) {
+		r->base = malloc (r->size);
+		if (r->base == NULL) {
+			r->fails++;
+			return NULL;
+		}
+		region_link (r);
+	}
+	if (size > r->size || used > r->size - size) {
+		r->fails++;
+		return NULL;
+	}
+	r->used = used + size;
+	if (r->used > r->peak)
+		r->peak = r->used;
+	r->allocs++;
+	return r->base + used;
+}
+
+void region_destroy (region_t *r)
+{
+	region_t **pp;
+
+	for (pp = &regions; *pp != NULL; pp = &(*pp)->next) {
+		if (*pp == r) {
+			*pp = r->next;
+			break;
+		}
+	}
+	free (r->base);
+	r->base = NULL;
+	r->used = 0;
+}
+
+void pool_init (pool_t *p, const char *name, ulong objsize, ulong perblock)
+{
+	pool_t *q;
+
+	memset (p, 0, sizeof (*p));
+	p->name = name;
+	if (objsize < sizeof (void *))
+		objsize = sizeof (void *);
+	p->objsize = (objsize + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+	p->perblock = perblock ? perblock : 1;
+
+	for (q = pools; q != NULL; q = q->next)
+		if (q == p)
+			return;
+	p->next = pools;
+	pools = p;
+}
+
+void *pool_alloc (pool_t *p)
+{
+	void **obj;
+
+	if (p->free == NULL) {
+		char *block;
+		ulong i;
+
+		block = malloc (POOL_ALIGN + p->objsize * p->perblock);
+		if (block == NULL)
+			return NULL;
+		*(void **)block = p->blocks;
+		p->blocks = block;
+		p->nblocks++;
+		/* thread the new objects onto the free list */
+		for (i = p->perblock; i-- > 0; ) {
+			obj = (void **)(block + POOL_ALIGN + i * p->objsize);
+			*obj = p->free;
+			p->free = obj;
+		}
+	}
+	obj = p->free;
+	p->free = *obj;
+	if (++p->inuse > p->peak)
+		p->peak = p->inuse;
+	p->allocs++;
+	return obj;
+}
+
+void pool_free (pool_t *p, void *obj)
+{
+	if (obj == NULL)
+		return;
+	*(void **)obj = p->free;
+	p->free = obj;
+	p->inuse--;
+}
+
+/* Give all blocks back to malloc(); objects still in use are lost */
+void pool_destroy (pool_t *p)
+{
+	pool_t **pp;
+	void *block;
+
+	while ((block = p->blocks) != NULL) {
+		p->blocks = *(void **)block;
+		free (block);
+	}
+	p->free = NULL;
+	p->nblocks = 0;
+	p->inuse = 0;
+
+	for (pp = &pools; *pp != NULL; pp = &(*pp)->next) {
+		if (*pp == p) {
+			*pp = p->next;
+			break;
+		}
+	}
+}
+
+void region_info (void)
+{
+	region_t *r;
+	pool_t *p;
+
+	for (r = regions; r != NULL; r = r->next)
+		printf ("region %-12s %7ld bytes, %7ld used, %7ld peak, "
+			"%6ld allocs, %ld failed\n",
+			r->name, r->size, r->used, r->peak,
+			r->allocs, r->fails);
+	for (p = pools; p != NULL; p = p->next)
+		printf ("pool   %-12s %7ld bytes x %ld in %ld blocks, "
+			"%ld in use, %ld peak, %ld allocs\n",
+			p->name, p->objsize, p->perblock, p->nblocks,
+			p->inuse, p->peak, p->allocs);
+}
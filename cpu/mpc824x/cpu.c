@@ -97,6 +97,9 @@ int do_reset (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 {
 	ulong msr, addr;
 
+#ifdef CFG_NS16550_TXBUF
+	serial_flush ();
+#endif
 	/* Interrupts and MMU off */
 	__asm__ ("mtspr    81, 0");
 
@@ -324,6 +324,32 @@ cpu_init_f (void)
 #endif /* !CONFIG_MOUSSE && !CONFIG_BMW */
 }
 
+/*
+ * Read back the memory controller setup done above, so that it can be
+ * compared with the setup stored along with a cached RAM size.
+ */
+static const unsigned int mem_config_regs[MPC824X_MEM_CONFIG_REGS] = {
+	MCCR1, MCCR2, MCCR3, MCCR4,
+	MSAR1, EMSAR1, MSAR2, EMSAR2,
+	MEAR1, EMEAR1, MEAR2, EMEAR2,
+	MBER,
+};
+
+int mpc824x_mem_config (unsigned long *regs)
+{
+	ulong val;
+	int i;
+
+	for (i = 0; i < MPC824X_MEM_CONFIG_REGS; i++) {
+		CONFIG_READ_WORD(mem_config_regs[i], val);
+		regs[i] = val;
+	}
+	/* MBER is a byte register, ignore its neighbours */
+	regs[MPC824X_MEM_CONFIG_REGS - 1] &= 0xff;
+
+	return MPC824X_MEM_CONFIG_REGS;
+}
+
 
 #ifdef CONFIG_MOUSSE
 #ifdef INCLUDE_MPC107_REPORT
@@ -445,6 +445,9 @@ mmc_init(int verbose)
 		sprintf(mmc_dev.revision,"%x %x",cid->hwrev, cid->fwrev);
 		mmc_dev.removable = 0;
 		mmc_dev.block_read = mmc_bread;
+#ifdef CONFIG_BLOCK_CACHE
+		blkcache_register (&mmc_dev);
+#endif
 
 		/* MMC exists, get CSD too */
 		resp = mmc_cmd(MMC_CMD_SET_RCA, MMC_DEFAULT_RCA, 0, MMC_CMDAT_R1);
@@ -0,0 +1,430 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Block cache with sequential read-ahead
+ *
+ * The file systems (ext2, fat, reiserfs) and the partition parsers read
+ * the same small blocks over and over again: super blocks, FAT sectors,
+ * group descriptors, directory blocks. The cache is inserted below the
+ * block_read() callback of a block_dev_desc_t, so none of them has to be
+ * changed: blkcache_register() saves the driver's read function and
+ * replaces it with a trampoline which looks up the requested blocks in a
+ * small LRU cache first.
+ *
+ * Small reads which miss are extended by CFG_BLOCK_CACHE_READAHEAD blocks
+ * when they continue the previous read, large reads (file data) go
+ * straight to the device and are not cached.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <part.h>
+
+#if defined(CONFIG_BLOCK_CACHE)
+
+#undef	BLKCACHE_DEBUG
+
+#ifdef	BLKCACHE_DEBUG
+#define	PRINTF(fmt,args...)	printf (fmt ,##args)
+#else
+#define PRINTF(fmt,args...)
+#endif
+
+#ifndef CFG_BLOCK_CACHE_BLOCKS
+#define CFG_BLOCK_CACHE_BLOCKS		64	/* number of cached blocks	*/
+#endif
+#ifndef CFG_BLOCK_CACHE_BLKSZ
+#define CFG_BLOCK_CACHE_BLKSZ		512	/* largest cacheable block size	*/
+#endif
+#ifndef CFG_BLOCK_CACHE_READAHEAD
+#define CFG_BLOCK_CACHE_READAHEAD	8	/* blocks read ahead		*/
+#endif
+#ifndef CFG_BLOCK_CACHE_MAXREQ
+#define CFG_BLOCK_CACHE_MAXREQ		8	/* larger reads bypass cache	*/
+#endif
+
+#define BLKCACHE_DEVS			4	/* see blkcache_trampoline[]	*/
+
+#if CFG_BLOCK_CACHE_MAXREQ + CFG_BLOCK_CACHE_READAHEAD > CFG_BLOCK_CACHE_BLOCKS
+#error CFG_BLOCK_CACHE_BLOCKS too small for MAXREQ + READAHEAD
+#endif
+
+typedef ulong (*blkread_t)(int dev, ulong start, lbaint_t blkcnt, ulong *buffer);
+
+typedef struct blkcache_dev {
+	block_dev_desc_t *desc;		/* NULL if slot is unused	*/
+	blkread_t	read;		/* driver read function		*/
+	lbaint_t	next;		/* block following last read	*/
+	ulong		hits;		/* blocks found in the cache	*/
+	ulong		misses;		/* blocks not found		*/
+	ulong		reads;		/* calls into the driver	*/
+	ulong		bytes;		/* bytes read from the device	*/
+	ulong		ahead;		/* blocks read ahead		*/
+	ulong		used;		/* LRU stamp of the last read	*/
+} blkcache_dev_t;
+
+typedef struct blkcache_blk {
+	int		slot;		/* owning device, -1 if free	*/
+	lbaint_t	blknr;
+	ulong		used;		/* LRU stamp			*/
+	uchar		*data;
+} blkcache_blk_t;
+
+static blkcache_dev_t blkcache_devs[BLKCACHE_DEVS];
+static blkcache_blk_t blkcache_blks[CFG_BLOCK_CACHE_BLOCKS];
+static uchar *blkcache_data;	/* CFG_BLOCK_CACHE_BLOCKS blocks	*/
+static uchar *blkcache_bounce;	/* MAXREQ + READAHEAD blocks		*/
+static ulong blkcache_clock;
+
+static ulong blkcache_read (int slot, ulong start, lbaint_t blkcnt, ulong *buffer);
+static const char *blkcache_ifname (int if_type);
+
+/*
+ * block_read() only passes the device number, which is not unique across
+ * interface types, so every cache slot gets its own entry point.
+ */
+#define BLKCACHE_TRAMPOLINE(n)						\
+static ulong blkcache_read_##n (int dev, ulong start, lbaint_t blkcnt,	\
+				ulong *buffer)				\
+{									\
+	return blkcache_read (n, start, blkcnt, buffer);		\
+}
+
+BLKCACHE_TRAMPOLINE(0)
+BLKCACHE_TRAMPOLINE(1)
+BLKCACHE_TRAMPOLINE(2)
+BLKCACHE_TRAMPOLINE(3)
+
+static blkread_t blkcache_trampoline[BLKCACHE_DEVS] = {
+	blkcache_read_0, blkcache_read_1, blkcache_read_2, blkcache_read_3,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static int blkcache_alloc (void)
+{
+	int i;
+
+	if (blkcache_data)
+		return 0;
+
+	blkcache_data = malloc (CFG_BLOCK_CACHE_BLOCKS * CFG_BLOCK_CACHE_BLKSZ);
+	blkcache_bounce = malloc ((CFG_BLOCK_CACHE_MAXREQ + CFG_BLOCK_CACHE_READAHEAD)
+				  * CFG_BLOCK_CACHE_BLKSZ);
+	if (!blkcache_data || !blkcache_bounce) {
+		puts ("blkcache: out of memory, cache disabled\n");
+		if (blkcache_data)
+			free (blkcache_data);
+		if (blkcache_bounce)
+			free (blkcache_bounce);
+		blkcache_data = NULL;
+		blkcache_bounce = NULL;
+		return -1;
+	}
+
+	for (i = 0; i < CFG_BLOCK_CACHE_BLOCKS; ++i) {
+		blkcache_blks[i].slot = -1;
+		blkcache_blks[i].data = blkcache_data + i * CFG_BLOCK_CACHE_BLKSZ;
+	}
+	return 0;
+}
+
+static blkcache_blk_t *blkcache_lookup (int slot, lbaint_t blknr)
+{
+	blkcache_blk_t *b;
+
+	for (b = blkcache_blks; b < &blkcache_blks[CFG_BLOCK_CACHE_BLOCKS]; ++b) {
+		if (b->slot == slot && b->blknr == blknr) {
+			b->used = ++blkcache_clock;
+			return b;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Returns the entry already holding blknr, a free one, or the least
+ * recently used one.
+ */
+static blkcache_blk_t *blkcache_victim (int slot, lbaint_t blknr)
+{
+	blkcache_blk_t *b, *lru = NULL;
+
+	for (b = blkcache_blks; b < &blkcache_blks[CFG_BLOCK_CACHE_BLOCKS]; ++b) {
+		if (b->slot == slot && b->blknr == blknr)
+			return b;
+		if (b->slot < 0)
+			lru = b;
+		else if (lru == NULL || (lru->slot >= 0 && b->used < lru->used))
+			lru = b;
+	}
+	return lru;
+}
+
+static void blkcache_insert (int slot, lbaint_t blknr, uchar *data, ulong blksz)
+{
+	blkcache_blk_t *b = blkcache_victim (slot, blknr);
+
+	b->slot  = slot;
+	b->blknr = blknr;
+	b->used  = ++blkcache_clock;
+	memcpy (b->data, data, blksz);
+}
+
+static ulong blkcache_read (int slot, ulong start, lbaint_t blkcnt, ulong *buffer)
+{
+	blkcache_dev_t *cd = &blkcache_devs[slot];
+	block_dev_desc_t *desc = cd->desc;
+	ulong blksz = desc->blksz;
+	uchar *dst = (uchar *)buffer;
+	lbaint_t blk = start;
+	lbaint_t left = blkcnt;
+	lbaint_t cnt, n, i;
+	blkcache_blk_t *b;
+
+	cd->used = ++blkcache_clock;
+
+	if (blkcnt > CFG_BLOCK_CACHE_MAXREQ || blksz > CFG_BLOCK_CACHE_BLKSZ) {
+		n = cd->read (desc->dev, start, blkcnt, buffer);
+		cd->reads++;
+		cd->misses += blkcnt;
+		cd->bytes  += n * blksz;
+		cd->next    = start + n;
+		return n;
+	}
+
+	while (left > 0) {
+		if ((b = blkcache_lookup (slot, blk)) != NULL) {
+			memcpy (dst, b->data, blksz);
+			cd->hits++;
+			dst += blksz;
+			blk++;
+			left--;
+			continue;
+		}
+
+		/* read the rest of the request, plus read-ahead if sequential */
+		cnt = left;
+		if (blk == cd->next)
+			cnt += CFG_BLOCK_CACHE_READAHEAD;
+		if (desc->lba && blk + cnt > desc->lba)
+			cnt = (blk < desc->lba) ? desc->lba - blk : 0;
+		if (cnt < left)
+			cnt = left;
+
+		PRINTF ("blkcache: dev %d miss %ld, reading %ld\n",
+			desc->dev, (ulong)blk, (ulong)cnt);
+
+		n = cd->read (desc->dev, blk, cnt, (ulong *)blkcache_bounce);
+		cd->reads++;
+		cd->bytes += n * blksz;
+		if (n > left)
+			cd->ahead += n - left;
+		if (n < left) {
+			/* short read: hand back what we got, cache nothing */
+			memcpy (dst, blkcache_bounce, n * blksz);
+			cd->misses += n;
+			cd->next = blk + n;
+			return blkcnt - left + n;
+		}
+
+		for (i = 0; i < n; ++i)
+			blkcache_insert (slot, blk + i,
+					 blkcache_bounce + i * blksz, blksz);
+
+		memcpy (dst, blkcache_bounce, left * blksz);
+		cd->misses += left;
+		blk  += left;
+		left  = 0;
+	}
+	cd->next = start + blkcnt;
+	return blkcnt;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int blkcache_slot (block_dev_desc_t *dev_desc)
+{
+	int i;
+
+	for (i = 0; i < BLKCACHE_DEVS; ++i) {
+		if (blkcache_devs[i].desc == dev_desc)
+			return i;
+	}
+	return -1;
+}
+
+static void blkcache_drop (int slot)
+{
+	int i;
+
+	if (blkcache_data == NULL)
+		return;
+	for (i = 0; i < CFG_BLOCK_CACHE_BLOCKS; ++i) {
+		if (blkcache_blks[i].slot == slot)
+			blkcache_blks[i].slot = -1;
+	}
+}
+
+/*
+ * A slot can be reused when it is free or its device has gone away: it
+ * was re-initialised without init_part() (so the driver's block_read is
+ * back in place) or is no longer present.
+ */
+static int blkcache_slot_free (int slot)
+{
+	block_dev_desc_t *desc = blkcache_devs[slot].desc;
+
+	return desc == NULL ||
+	       desc->block_read != blkcache_trampoline[slot] ||
+	       desc->type == DEV_TYPE_UNKNOWN;
+}
+
+/*
+ * Give the device of a slot back the driver's block_read(), unless it
+ * was reset already, and free the slot.
+ */
+static void blkcache_release (int slot)
+{
+	blkcache_dev_t *cd = &blkcache_devs[slot];
+
+	if (cd->desc != NULL && cd->desc->block_read == blkcache_trampoline[slot])
+		cd->desc->block_read = cd->read;
+	cd->desc = NULL;
+}
+
+/*
+ * Find a slot for a new device: a free one, else take the one read least
+ * recently away from its device, which then reads uncached.
+ */
+static int blkcache_new_slot (block_dev_desc_t *dev_desc)
+{
+	blkcache_dev_t *cd;
+	int slot, lru = 0;
+
+	for (slot = 0; slot < BLKCACHE_DEVS; ++slot) {
+		if (blkcache_slot_free (slot)) {
+			blkcache_release (slot);
+			return slot;
+		}
+		if (blkcache_devs[slot].used < blkcache_devs[lru].used)
+			lru = slot;
+	}
+
+	cd = &blkcache_devs[lru];
+	printf ("blkcache: all %d slots in use, %s %d is no longer cached\n",
+		BLKCACHE_DEVS, blkcache_ifname (cd->desc->if_type),
+		cd->desc->dev);
+	blkcache_release (lru);
+	return lru;
+}
+
+/*
+ * Put the cache in front of dev_desc->block_read(). Called whenever a
+ * device is (re-)initialised, so any cached data of the device is thrown
+ * away here as well.
+ */
+void blkcache_register (block_dev_desc_t *dev_desc)
+{
+	blkcache_dev_t *cd;
+	int slot;
+
+	if (dev_desc->block_read == NULL || blkcache_alloc () != 0)
+		return;
+
+	if ((slot = blkcache_slot (dev_desc)) < 0)
+		slot = blkcache_new_slot (dev_desc);
+
+	blkcache_drop (slot);
+
+	cd = &blkcache_devs[slot];
+	/* the driver may or may not have reset block_read on re-init */
+	if (dev_desc->block_read != blkcache_trampoline[slot])
+		cd->read = dev_desc->block_read;
+	cd->desc = dev_desc;
+	cd->next = 0;
+	cd->hits = cd->misses = cd->reads = cd->bytes = cd->ahead = 0;
+	cd->used = ++blkcache_clock;
+
+	dev_desc->block_read = blkcache_trampoline[slot];
+}
+
+/*
+ * Throw away the cached blocks of one device, e.g. after writing to it.
+ */
+void blkcache_invalidate (block_dev_desc_t *dev_desc)
+{
+	int slot = blkcache_slot (dev_desc);
+
+	if (slot >= 0)
+		blkcache_drop (slot);
+}
+
+void blkcache_flush (void)
+{
+	int i;
+
+	for (i = 0; i < BLKCACHE_DEVS; ++i)
+		blkcache_drop (i);
+}
+
+static const char *blkcache_ifname (int if_type)
+{
+	switch (if_type) {
+	case IF_TYPE_IDE:	return "IDE";
+	case IF_TYPE_SCSI:	return "SCSI";
+	case IF_TYPE_ATAPI:	return "ATAPI";
+	case IF_TYPE_USB:	return "USB";
+	case IF_TYPE_DOC:	return "DOC";
+	case IF_TYPE_MMC:	return "MMC";
+	default:		return "UNKNOWN";
+	}
+}
+
+void blkcache_stats (void)
+{
+	blkcache_dev_t *cd;
+	int i, used = 0;
+
+	if (blkcache_data) {
+		for (i = 0; i < CFG_BLOCK_CACHE_BLOCKS; ++i)
+			if (blkcache_blks[i].slot >= 0)
+				used++;
+	}
+	printf ("Block cache: %d/%d blocks of %d bytes used, read-ahead %d\n",
+		used, CFG_BLOCK_CACHE_BLOCKS, CFG_BLOCK_CACHE_BLKSZ,
+		CFG_BLOCK_CACHE_READAHEAD);
+
+	for (i = 0; i < BLKCACHE_DEVS; ++i) {
+		cd = &blkcache_devs[i];
+		if (cd->desc == NULL)
+			continue;
+		printf ("  %-5s %d: hits %ld, misses %ld, "
+			"reads %ld (%ld bytes), read-ahead %ld\n",
+			blkcache_ifname (cd->desc->if_type), cd->desc->dev,
+			cd->hits, cd->misses, cd->reads, cd->bytes, cd->ahead);
+	}
+}
+
+#endif	/* CONFIG_BLOCK_CACHE */
@@ -24,6 +24,9 @@
 #include <common.h>
 #include <command.h>
 #include <ide.h>
+#ifdef CONFIG_PART_CACHE
+#include <malloc.h>
+#endif
 
 #undef	PART_DEBUG
 
@@ -133,8 +136,163 @@ void dev_print (block_dev_desc_t *dev_desc)
     defined(CONFIG_ISO_PARTITION) || \
     defined(CONFIG_AMIGA_PARTITION)
 
+#ifdef CONFIG_PART_CACHE
+/*
+ * Partition table cache
+ *
+ * Every ext2load, fatload or diskboot looks up its partition through
+ * get_partition_info(), which used to read and parse the MBR again,
+ * and for a logical partition the whole chain of extended boot records
+ * in front of it. DOS partition tables are now walked once per device
+ * and kept here until the device is initialised again (init_part(), as
+ * called by "ide reset", "usb reset" and "scsi scan") or written to.
+ * Other partition table types are not cached.
+ */
+#ifndef CFG_PART_CACHE_DEVS
+#define CFG_PART_CACHE_DEVS	4	/* number of cached devices	*/
+#endif
+
+#define PART_CACHE_GROW		8	/* entries added at a time	*/
+
+typedef struct {
+	int		 num;		/* partition number		*/
+	disk_partition_t info;
+} part_cache_ent_t;
+
+typedef struct {
+	block_dev_desc_t *dev_desc;	/* NULL: slot unused		*/
+	unsigned char	 part_type;	/* part_type when scanned	*/
+	int		 count;		/* partitions found		*/
+	int		 alloc;		/* entries allocated		*/
+	part_cache_ent_t *ent;
+	ulong		 used;		/* for LRU replacement		*/
+} part_cache_t;
+
+static part_cache_t part_cache[CFG_PART_CACHE_DEVS];
+static ulong part_cache_clock;
+static ulong part_cache_lookups, part_cache_scans;
+
+static void part_cache_drop (part_cache_t *pc)
+{
+	free (pc->ent);
+	memset (pc, 0, sizeof (*pc));
+}
+
+void part_cache_invalidate (block_dev_desc_t *dev_desc)
+{
+	int i;
+
+	for (i = 0; i < CFG_PART_CACHE_DEVS; i++)
+		if (part_cache[i].dev_desc == dev_desc)
+			part_cache_drop (&part_cache[i]);
+}
+
+static int part_cache_add (void *arg, int part, disk_partition_t *info)
+{
+	part_cache_t *pc = arg;
+
+	if (pc->count == pc->alloc) {
+		part_cache_ent_t *ent;
+
+		ent = realloc (pc->ent, (pc->alloc + PART_CACHE_GROW) *
+				sizeof (part_cache_ent_t));
+		if (ent == NULL)
+			return -1;
+		pc->ent = ent;
+		pc->alloc += PART_CACHE_GROW;
+	}
+	pc->ent[pc->count].num = part;
+	memcpy (&pc->ent[pc->count].info, info, sizeof (*info));
+	pc->count++;
+	return 0;
+}
+
+/*
+ * Return the cached table of a device, walking it first if needed;
+ * NULL if the table cannot be cached and has to be read every time.
+ */
+static part_cache_t *part_cache_get (block_dev_desc_t *dev_desc)
+{
+	part_cache_t *pc, *victim = &part_cache[0];
+	int i;
+
+	if (dev_desc->part_type != PART_TYPE_DOS)
+		return NULL;
+
+	for (i = 0; i < CFG_PART_CACHE_DEVS; i++) {
+		pc = &part_cache[i];
+		if (pc->dev_desc == dev_desc) {
+			if (pc->part_type == dev_desc->part_type) {
+				pc->used = ++part_cache_clock;
+				return pc;
+			}
+			victim = pc;		/* stale */
+			break;
+		}
+		if (pc->used < victim->used)
+			victim = pc;
+	}
+
+	/* not cached: walk the table into the least recently used slot */
+	pc = victim;
+	part_cache_drop (pc);
+	part_cache_scans++;
+	if (walk_part_dos (dev_desc, part_cache_add, pc) != 0) {
+		part_cache_drop (pc);
+		return NULL;
+	}
+	pc->dev_desc = dev_desc;
+	pc->part_type = dev_desc->part_type;
+	pc->used = ++part_cache_clock;
+	return pc;
+}
+
+static const char *part_if_name (int if_type)
+{
+	switch (if_type) {
+	case IF_TYPE_IDE:	return "IDE";
+	case IF_TYPE_SCSI:	return "SCSI";
+	case IF_TYPE_ATAPI:	return "ATAPI";
+	case IF_TYPE_USB:	return "USB";
+	case IF_TYPE_DOC:	return "DOC";
+	case IF_TYPE_MMC:	return "MMC";
+	default:		return "UNKNOWN";
+	}
+}
+
+void part_cache_list (void)
+{
+	part_cache_t *pc;
+	int i, j;
+
+	for (i = 0; i < CFG_PART_CACHE_DEVS; i++) {
+		pc = &part_cache[i];
+		if (pc->dev_desc == NULL)
+			continue;
+		printf ("\n%s device %d: %d DOS partitions\n",
+			part_if_name (pc->dev_desc->if_type),
+			pc->dev_desc->dev, pc->count);
+		if (pc->count == 0)
+			continue;
+		puts ("Partition     Start Sector     Num Sectors\n");
+		for (j = 0; j < pc->count; j++)
+			printf ("%5d\t\t%10ld\t%10ld\n", pc->ent[j].num,
+				pc->ent[j].info.start, pc->ent[j].info.size);
+	}
+	printf ("\n%ld lookups, %ld partition table walks\n",
+		part_cache_lookups, part_cache_scans);
+}
+#endif	/* CONFIG_PART_CACHE */
+
 void init_part (block_dev_desc_t * dev_desc)
 {
+#ifdef CONFIG_BLOCK_CACHE
+	blkcache_register (dev_desc);
+#endif
+#ifdef CONFIG_PART_CACHE
+	part_cache_invalidate (dev_desc);
+#endif
+
 #ifdef CONFIG_ISO_PARTITION
 	if (test_part_iso(dev_desc) == 0) {
 		dev_desc->part_type = PART_TYPE_ISO;
@@ -165,7 +323,8 @@ void init_part (block_dev_desc_t * dev_desc)
 }
 
 
-int get_partition_info (block_dev_desc_t *dev_desc, int part, disk_partition_t *info)
+static int get_partition_info_raw (block_dev_desc_t *dev_desc, int part,
+				   disk_partition_t *info)
 {
 		switch (dev_desc->part_type) {
 #ifdef CONFIG_MAC_PARTITION
@@ -210,6 +369,27 @@ int get_partition_info (block_dev_desc_t *dev_desc, int part, disk_partition_t *
 	return (-1);
 }
 
+int get_partition_info (block_dev_desc_t *dev_desc, int part, disk_partition_t *info)
+{
+#ifdef CONFIG_PART_CACHE
+	part_cache_t *pc;
+	int i;
+
+	part_cache_lookups++;
+	if ((pc = part_cache_get (dev_desc)) != NULL) {
+		for (i = 0; i < pc->count; i++) {
+			if (pc->ent[i].num == part) {
+				memcpy (info, &pc->ent[i].info, sizeof (*info));
+				PRINTF ("## Cached partition found ##\n");
+				return (0);
+			}
+		}
+		return (-1);
+	}
+#endif
+	return get_partition_info_raw (dev_desc, part, info);
+}
+
 static void print_part_header (const char *type, block_dev_desc_t * dev_desc)
 {
 	puts ("\nPartition Map for ");
@@ -156,86 +156,121 @@ static void print_partition_extended (block_dev_desc_t *dev_desc, int ext_part_s
 }
 
 
-/*  Print a partition that is relative to its Extended partition table
+static void fill_one_part (block_dev_desc_t *dev_desc, dos_partition_t *pt,
+			   int ext_part_sector, int part_num,
+			   disk_partition_t *info)
+{
+	info->blksz = 512;
+	info->start = ext_part_sector + le32_to_int (pt->start4);
+	info->size  = le32_to_int (pt->size4);
+	switch(dev_desc->if_type) {
+		case IF_TYPE_IDE:
+		case IF_TYPE_ATAPI:
+			sprintf ((char *)info->name, "hd%c%d\n", 'a' + dev_desc->dev, part_num);
+			break;
+		case IF_TYPE_SCSI:
+			sprintf ((char *)info->name, "sd%c%d\n", 'a' + dev_desc->dev, part_num);
+			break;
+		case IF_TYPE_USB:
+			sprintf ((char *)info->name, "usbd%c%d\n", 'a' + dev_desc->dev, part_num);
+			break;
+		case IF_TYPE_DOC:
+			sprintf ((char *)info->name, "docd%c%d\n", 'a' + dev_desc->dev, part_num);
+			break;
+		default:
+			sprintf ((char *)info->name, "xx%c%d\n", 'a' + dev_desc->dev, part_num);
+			break;
+	}
+	/* sprintf(info->type, "%d, pt->sys_ind); */
+	sprintf ((char *)info->type, "U-Boot");
+}
+
+/*
+ * Walk the MBR and the chain of extended boot records behind it once,
+ * calling found() for every primary and logical partition in fdisk
+ * order; the walk ends early when found() returns non-zero.
+ * Returns -1 if a partition table could not be read.
  */
-static int get_partition_info_extended (block_dev_desc_t *dev_desc, int ext_part_sector,
-				 int relative, int part_num,
-				 int which_part, disk_partition_t *info)
+int walk_part_dos (block_dev_desc_t *dev_desc, part_found_t *found, void *arg)
 {
 	unsigned char buffer[DEFAULT_SECTOR_SIZE];
+	disk_partition_t info;
 	dos_partition_t *pt;
-	int i;
+	int ext_part_sector = 0, relative = 0, part_num = 1;
+	int i, next, depth;
 
-	if (dev_desc->block_read (dev_desc->dev, ext_part_sector, 1, (ulong *) buffer) != 1) {
-		printf ("** Can't read partition table on %d:%d **\n",
-			dev_desc->dev, ext_part_sector);
-		return -1;
-	}
-	if (buffer[DOS_PART_MAGIC_OFFSET] != 0x55 ||
-		buffer[DOS_PART_MAGIC_OFFSET + 1] != 0xaa) {
-		printf ("bad MBR sector signature 0x%02x%02x\n",
-			buffer[DOS_PART_MAGIC_OFFSET],
-			buffer[DOS_PART_MAGIC_OFFSET + 1]);
-		return -1;
-	}
+	for (depth = 0; depth < DOS_PART_MAX_EBR; depth++) {
+		if (dev_desc->block_read (dev_desc->dev, ext_part_sector, 1, (ulong *) buffer) != 1) {
+			printf ("** Can't read partition table on %d:%d **\n",
+				dev_desc->dev, ext_part_sector);
+			return -1;
+		}
+		if (buffer[DOS_PART_MAGIC_OFFSET] != 0x55 ||
+			buffer[DOS_PART_MAGIC_OFFSET + 1] != 0xaa) {
+			printf ("bad MBR sector signature 0x%02x%02x\n",
+				buffer[DOS_PART_MAGIC_OFFSET],
+				buffer[DOS_PART_MAGIC_OFFSET + 1]);
+			return -1;
+		}
 
-	/* Print all primary/logical partitions */
-	pt = (dos_partition_t *) (buffer + DOS_PART_TBL_OFFSET);
-	for (i = 0; i < 4; i++, pt++) {
-		/*
-		 * fdisk does not show the extended partitions that
-		 * are not in the MBR
-		 */
-		if ((pt->sys_ind != 0) &&
-		    (part_num == which_part) &&
-		    (is_extended(pt->sys_ind) == 0)) {
-			info->blksz = 512;
-			info->start = ext_part_sector + le32_to_int (pt->start4);
-			info->size  = le32_to_int (pt->size4);
-			switch(dev_desc->if_type) {
-				case IF_TYPE_IDE:
-				case IF_TYPE_ATAPI:
-					sprintf ((char *)info->name, "hd%c%d\n", 'a' + dev_desc->dev, part_num);
-					break;
-				case IF_TYPE_SCSI:
-					sprintf ((char *)info->name, "sd%c%d\n", 'a' + dev_desc->dev, part_num);
-					break;
-				case IF_TYPE_USB:
-					sprintf ((char *)info->name, "usbd%c%d\n", 'a' + dev_desc->dev, part_num);
-					break;
-				case IF_TYPE_DOC:
-					sprintf ((char *)info->name, "docd%c%d\n", 'a' + dev_desc->dev, part_num);
-					break;
-				default:
-					sprintf ((char *)info->name, "xx%c%d\n", 'a' + dev_desc->dev, part_num);
-					break;
+		/* All primary/logical partitions */
+		pt = (dos_partition_t *) (buffer + DOS_PART_TBL_OFFSET);
+		for (i = 0; i < 4; i++, pt++) {
+			/*
+			 * fdisk does not show the extended partitions that
+			 * are not in the MBR
+			 */
+			if ((pt->sys_ind != 0) &&
+			    (is_extended(pt->sys_ind) == 0)) {
+				fill_one_part (dev_desc, pt, ext_part_sector,
+					       part_num, &info);
+				if (found (arg, part_num, &info))
+					return 0;
 			}
-			/* sprintf(info->type, "%d, pt->sys_ind); */
-			sprintf ((char *)info->type, "U-Boot");
-			return 0;
-		}
 
-		/* Reverse engr the fdisk part# assignment rule! */
-		if ((ext_part_sector == 0) ||
-		    (pt->sys_ind != 0 && !is_extended (pt->sys_ind)) ) {
-			part_num++;
+			/* Reverse engr the fdisk part# assignment rule! */
+			if ((ext_part_sector == 0) ||
+			    (pt->sys_ind != 0 && !is_extended (pt->sys_ind)) ) {
+				part_num++;
+			}
 		}
-	}
 
-	/* Follows the extended partitions */
-	pt = (dos_partition_t *) (buffer + DOS_PART_TBL_OFFSET);
-	for (i = 0; i < 4; i++, pt++) {
-		if (is_extended (pt->sys_ind)) {
-			int lba_start = le32_to_int (pt->start4) + relative;
-
-			return get_partition_info_extended (dev_desc, lba_start,
-				 ext_part_sector == 0 ? lba_start : relative,
-				 part_num, which_part, info);
+		/* Follow the first extended partition */
+		next = -1;
+		pt = (dos_partition_t *) (buffer + DOS_PART_TBL_OFFSET);
+		for (i = 0; i < 4; i++, pt++) {
+			if (is_extended (pt->sys_ind)) {
+				next = le32_to_int (pt->start4) + relative;
+				break;
+			}
 		}
+		if (next < 0)
+			return 0;
+		if (ext_part_sector == 0)
+			relative = next;
+		ext_part_sector = next;
 	}
+	printf ("** More than %d extended partition tables on %d **\n",
+		DOS_PART_MAX_EBR, dev_desc->dev);
 	return -1;
 }
 
+struct find_part {
+	int			which_part;
+	disk_partition_t	*info;
+};
+
+static int find_one_part (void *arg, int part_num, disk_partition_t *info)
+{
+	struct find_part *fp = arg;
+
+	if (part_num != fp->which_part)
+		return 0;
+	memcpy (fp->info, info, sizeof (*info));
+	fp->which_part = -1;		/* found */
+	return 1;
+}
+
 void print_part_dos (block_dev_desc_t *dev_desc)
 {
 	printf ("Partition     Start Sector     Num Sectors     Type\n");
@@ -244,7 +279,16 @@ void print_part_dos (block_dev_desc_t *dev_desc)
 
 int get_partition_info_dos (block_dev_desc_t *dev_desc, int part, disk_partition_t * info)
 {
-	return get_partition_info_extended (dev_desc, 0, 0, 1, part, info);
+	struct find_part fp;
+
+	if (part < 1)
+		return -1;
+	fp.which_part = part;
+	fp.info = info;
+	if (walk_part_dos (dev_desc, find_one_part, &fp) != 0 ||
+	    fp.which_part != -1)
+		return -1;
+	return 0;
 }
 
 
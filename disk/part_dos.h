@@ -38,6 +38,7 @@
 #define DOS_PBR_MEDIA_TYPE_OFFSET	0x15
 #define DOS_MBR	0
 #define DOS_PBR	1
+#define DOS_PART_MAX_EBR	256	/* longest EBR chain walked, catches loops */
 
 typedef struct dos_partition {
 	unsigned char boot_ind;		/* 0x80 - active			*/
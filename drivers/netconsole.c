@@ -30,6 +30,13 @@
 #include <console.h>
 #include <net.h>
 
+#ifndef CFG_NC_BUFSIZE		/* output coalescing buffer, one datagram */
+#define CFG_NC_BUFSIZE		1024
+#endif
+#ifndef CFG_NC_FLUSH_MS		/* max. age of buffered complete lines	*/
+#define CFG_NC_FLUSH_MS		20
+#endif
+
 static char input_buffer[512];
 static int input_size = 0;		/* char count in input buffer */
 static int input_offset = 0;		/* offset to valid chars in input buffer */
@@ -41,6 +48,12 @@ static IPaddr_t nc_ip;			/* server ip */
 static short nc_port;			/* source/target port */
 static const char *output_packet;	/* used by first send udp */
 static int output_packet_len = 0;
+static char output_buffer[CFG_NC_BUFSIZE];
+static int output_size = 0;		/* char count in output buffer */
+static int output_lines = 0;		/* output buffer holds a newline */
+static ulong output_start;		/* time the buffer was started */
+static ulong nc_packets = 0;		/* statistics */
+static ulong nc_bytes = 0;
 
 static void nc_wait_arp_handler (uchar * pkt, unsigned dest, unsigned src,
 				 unsigned len)
@@ -72,7 +85,11 @@ void NcStart (void)
 		NetSetHandler (nc_wait_arp_handler);
 		pkt = (uchar *) NetTxPacket + NetEthHdrSize () + IP_HDR_SIZE;
 		memcpy (pkt, output_packet, output_packet_len);
-		NetSendUDPPacket (nc_ether, nc_ip, nc_port, nc_port, output_packet_len);
+		if (NetSendUDPPacket (nc_ether, nc_ip, nc_port, nc_port,
+				      output_packet_len) == 0)
+			NetState = NETLOOP_SUCCESS;	/* address was cached */
+		nc_packets++;
+		nc_bytes += output_packet_len;
 	}
 }
 
@@ -158,6 +175,8 @@ static void nc_send_packet (const char *buf, int len)
 	ether = nc_ether;
 	ip = nc_ip;
 	NetSendUDPPacket (ether, ip, nc_port, nc_port, len);
+	nc_packets++;
+	nc_bytes += len;
 
 	if (inited)
 		eth_halt ();
@@ -193,29 +212,83 @@ int nc_start (void)
 	return 0;
 }
 
+/*
+ * Send out whatever is in the output buffer. Must be called with
+ * output_recursion set.
+ */
+static void nc_send_output (void)
+{
+	if (output_size)
+		nc_send_packet (output_buffer, output_size);
+	output_size = 0;
+	output_lines = 0;
+}
+
+/*
+ * Collect output in the buffer instead of sending a packet per call.
+ * The buffer goes out when it is full, when it holds complete lines
+ * which have waited for CFG_NC_FLUSH_MS, and before waiting for input.
+ * The age is only checked here, i.e. when more output arrives; callers
+ * starting a long step which does not poll must call nc_flush() first.
+ */
+static void nc_buffer_output (const char *s, int len)
+{
+	while (len > 0) {
+		int chunk = sizeof output_buffer - output_size;
+
+		if (chunk > len)
+			chunk = len;
+		if (output_size == 0)
+			output_start = get_timer (0);
+
+		memcpy (output_buffer + output_size, s, chunk);
+		if (memchr (s, '\n', chunk))
+			output_lines = 1;
+		output_size += chunk;
+		s += chunk;
+		len -= chunk;
+
+		if (output_size == sizeof output_buffer)
+			nc_send_output ();
+	}
+
+	if (output_lines &&
+	    get_timer (output_start) >= CFG_NC_FLUSH_MS * CFG_HZ / 1000)
+		nc_send_output ();
+}
+
+/*
+ * Push out buffered output, e.g. before passing control to an OS
+ */
+void nc_flush (void)
+{
+	if (output_recursion || !output_size)
+		return;
+	output_recursion = 1;
+
+	nc_send_output ();
+
+	output_recursion = 0;
+}
+
 void nc_putc (char c)
 {
 	if (output_recursion)
 		return;
 	output_recursion = 1;
 
-	nc_send_packet (&c, 1);
+	nc_buffer_output (&c, 1);
 
 	output_recursion = 0;
 }
 
 void nc_puts (const char *s)
 {
-	int len;
-
 	if (output_recursion)
 		return;
 	output_recursion = 1;
 
-	if ((len = strlen (s)) > 512)
-		len = 512;
-
-	nc_send_packet (s, len);
+	nc_buffer_output (s, strlen (s));
 
 	output_recursion = 0;
 }
@@ -224,6 +297,8 @@ int nc_getc (void)
 {
 	uchar c;
 
+	nc_flush ();
+
 	input_recursion = 1;
 
 	net_timeout = 0;	/* no timeout */
@@ -248,6 +323,8 @@ int nc_tstc (void)
 	if (input_recursion)
 		return 0;
 
+	nc_flush ();
+
 	if (input_size)
 		return 1;
 
@@ -286,4 +363,20 @@ int drv_nc_init (void)
 	return (rc == 0) ? 1 : rc;
 }
 
+int do_ncinfo (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	printf ("netconsole: %lu bytes in %lu packets", nc_bytes, nc_packets);
+	if (nc_packets)
+		printf (", %lu bytes/packet", nc_bytes / nc_packets);
+	printf ("\n            %d bytes buffered, flush after %d ms\n",
+		output_size, CFG_NC_FLUSH_MS);
+	return 0;
+}
+
+U_BOOT_CMD(
+	ncinfo,	1,	1,	do_ncinfo,
+	"ncinfo  - print netconsole statistics\n",
+	NULL
+);
+
 #endif	/* CONFIG_NETCONSOLE */
@@ -14,6 +14,10 @@
 #define MCRVAL (MCR_DTR | MCR_RTS)			/* RTS/DTR */
 #define FCRVAL (FCR_FIFO_EN | FCR_RXSR | FCR_TXSR)	/* Clear & enable FIFOs */
 
+#ifndef CFG_NS16550_FIFO_SIZE
+#define CFG_NS16550_FIFO_SIZE	16		/* Transmit FIFO depth */
+#endif
+
 void NS16550_init (NS16550_t com_port, int baud_divisor)
 {
 	com_port->ier = 0x00;
@@ -52,6 +56,30 @@ void NS16550_putc (NS16550_t com_port, char c)
 	com_port->thr = c;
 }
 
+/*
+ * With the FIFOs enabled THRE means the whole transmit FIFO is empty:
+ * fill it with up to CFG_NS16550_FIFO_SIZE characters in one go.
+ * Returns the number of characters taken, 0 while the FIFO is busy.
+ */
+int NS16550_putfifo (NS16550_t com_port, const char *s, int len)
+{
+	int i;
+
+	if ((com_port->lsr & LSR_THRE) == 0)
+		return 0;
+	if (len > CFG_NS16550_FIFO_SIZE)
+		len = CFG_NS16550_FIFO_SIZE;
+	for (i = 0; i < len; i++)
+		com_port->thr = s[i];
+	return len;
+}
+
+/* Wait until the last character has left the shift register */
+void NS16550_drain (NS16550_t com_port)
+{
+	while ((com_port->lsr & LSR_TEMT) == 0);
+}
+
 char NS16550_getc (NS16550_t com_port)
 {
 	while ((com_port->lsr & LSR_DR) == 0) {
@@ -57,6 +57,9 @@
 #include <net.h>
 #include <asm/io.h>
 #include <pci.h>
+#ifdef CONFIG_DEFERRED_INIT
+#include <deferred.h>
+#endif
 
 #if (CONFIG_COMMANDS & CFG_CMD_NET) && defined(CONFIG_NET_MULTI) && \
 	defined(CONFIG_RTL8169)
@@ -720,6 +723,89 @@ static void rtl_halt(struct eth_device *dev)
 	}
 }
 
+#ifdef CONFIG_LINKSTATION
+void miconCntl_FanLow(void);
+void miconCntl_FanHigh(void);
+void miconCntl_Eth1000M(int up);
+void miconCntl_Eth100M(int up);
+void miconCntl_Eth10M(int up);
+void miconCntl_5f(void);
+#endif
+
+/*
+ * Report the result of the auto-negotiation
+ */
+static void rtl8169_link_up(struct eth_device *dev)
+{
+	int option;
+
+	udelay(100);
+	option = RTL_R8(PHYstatus);
+#if defined(CONFIG_LINKSTATION) && defined(CONFIG_HTGL)
+	if (option & _1000bpsF) {
+#ifdef DEBUG_RTL8169
+		printf("%s: 1000Mbps Full-duplex operation.\n",
+		     dev->name);
+#endif
+		miconCntl_Eth1000M(1);
+	} else if (option & _100bps) {
+#ifdef DEBUG_RTL8169
+		printf("%s: 100Mbps %s-duplexoperation.\n",
+			dev->name,
+			(option & FullDup) ? "Full" : "Half");
+#endif
+		miconCntl_Eth100M(1);
+	} else if (option & _10bps) {
+#ifdef DEBUG_RTL8169
+		printf
+		    ("%s: 10Mbps %s-duplex operation.\n",
+		     dev->name,
+		     (option & FullDup) ? "Full" : "Half");
+#endif
+		miconCntl_Eth100M(1);
+	}
+	miconCntl_5f();
+#else /* !defined(CONFIG_LINKSTATION) || !defined(CONFIG_HTGL) */
+	if (option & _1000bpsF) {
+#ifdef DEBUG_RTL8169
+		printf("%s: 1000Mbps Full-duplex operation.\n",
+			dev->name);
+#endif
+		miconCntl_FanHigh();
+	} else {
+#ifdef DEBUG_RTL8169
+		printk("%s: %sMbps %s-duplex operation.\n",
+			dev->name,
+			(option & _100bps) ? "100" : "10",
+			(option & FullDup) ? "Full" : "Half");
+#endif
+	}
+#endif
+}
+
+#ifdef CONFIG_DEFERRED_INIT
+#define RTL_AUTONEG_TIMEOUT	10000	/* ms, about what the polling loop took */
+
+static deferred_init_t rtl_autoneg[MAX_UNITS];
+
+static int rtl8169_autoneg_step(deferred_init_t *di)
+{
+	struct eth_device *dev = di->priv;
+	u32 saved = ioaddr;
+	int rc = DEFERRED_DONE;
+
+	ioaddr = dev->iobase;
+	if (mdio_read(PHY_STAT_REG) & PHY_Auto_Neco_Comp)
+		rtl8169_link_up(dev);
+	else if (get_timer(di->start) < RTL_AUTONEG_TIMEOUT) {
+		deferred_init_sleep(di, 10);
+		rc = DEFERRED_BUSY;
+	}
+	ioaddr = saved;
+	return rc;
+}
+#endif
+
 /**************************************************************************
 INIT - Look for an adapter, this routine's visible to the outside
 ***************************************************************************/
@@ -825,62 +911,23 @@ static int rtl_init(struct eth_device *dev, bd_t *bis)
 		udelay(100);
 
 #ifdef CONFIG_LINKSTATION
-void miconCntl_FanLow(void);
-void miconCntl_FanHigh(void);
-void miconCntl_Eth1000M(int up);
-void miconCntl_Eth100M(int up);
-void miconCntl_Eth10M(int up);
-void miconCntl_5f(void);
-
 		miconCntl_FanLow();
 #endif
 
 		/* wait for auto-negotiation process */
+#ifdef CONFIG_DEFERRED_INIT
+		if (board_idx < MAX_UNITS) {
+			rtl_autoneg[board_idx].name = dev->name;
+			rtl_autoneg[board_idx].priv = dev;
+			rtl_autoneg[board_idx].step = rtl8169_autoneg_step;
+			deferred_init_register(&rtl_autoneg[board_idx]);
+			return 1;
+		}
+#endif
 		for (i = 10000; i > 0; i--) {
 			/* check if auto-negotiation complete */
 			if (mdio_read(PHY_STAT_REG) & PHY_Auto_Neco_Comp) {
-				udelay(100);
-				option = RTL_R8(PHYstatus);
-#if defined(CONFIG_LINKSTATION) && defined(CONFIG_HTGL)
-				if (option & _1000bpsF) {
-#ifdef DEBUG_RTL8169
-					printf("%s: 1000Mbps Full-duplex operation.\n",
-					     dev->name);
-#endif
-					miconCntl_Eth1000M(1);
-				} else if (option & _100bps) {
-#ifdef DEBUG_RTL8169
-					printf("%s: 100Mbps %s-duplexoperation.\n",
-						dev->name,
-						(option & FullDup) ? "Full" : "Half");
-#endif
-					miconCntl_Eth100M(1);
-				} else if (option & _10bps) {
-#ifdef DEBUG_RTL8169
-					printf
-					    ("%s: 10Mbps %s-duplex operation.\n",
-					     dev->name,
-					     (option & FullDup) ? "Full" : "Half");
-#endif
-					miconCntl_Eth100M(1);
-				}
-				miconCntl_5f();
-#else /* !defined(CONFIG_LINKSTATION) || !defined(CONFIG_HTGL) */
-				if (option & _1000bpsF) {
-#ifdef DEBUG_RTL8169
-					printf("%s: 1000Mbps Full-duplex operation.\n",
-						dev->name);
-#endif
-					miconCntl_FanHigh();
-				} else {
-#ifdef DEBUG_RTL8169
-					printk("%s: %sMbps %s-duplex operation.\n",
-						dev->name,
-						(option & _100bps) ? "100" : "10",
-						(option & FullDup) ? "Full" : "Half");
-#endif
-				}
-#endif
+				rtl8169_link_up(dev);
 				break;
 			} else {
 				udelay(100);
@@ -919,6 +966,7 @@ int rtl8169_initialize(bd_t *bis)
 		debug ("rtl8169: REALTEK RTL8169 @0x%x\n", iobase);
 
 		dev = (struct eth_device *)malloc(sizeof *dev);
+		memset(dev, 0, sizeof *dev);
 
 		sprintf (dev->name, "RTL8169#%d", card_number);
 
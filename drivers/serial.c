@@ -175,39 +175,194 @@ _serial_setbrg (const int port)
 	NS16550_reinit(PORT, clock_divisor);
 }
 
+#ifdef CFG_NS16550_TXBUF
+/*
+ * Console output buffer. Once U-Boot runs from RAM, characters for
+ * the console go into a ring which is moved to the UART a whole FIFO
+ * at a time whenever the transmitter has run empty, instead of
+ * spinning on THRE for every single character; the CPU only waits
+ * when the ring is full. serial_tstc() moves out what it can,
+ * serial_getc() and serial_flush() wait until the ring is empty.
+ * With CFG_NS16550_TXBUF set to 0 output is not buffered, but the
+ * statistics printed by "coninfo" are still kept for comparison.
+ */
+#define TXBUF_SIZE	CFG_NS16550_TXBUF
+
+#if TXBUF_SIZE & (TXBUF_SIZE - 1)
+#error "CFG_NS16550_TXBUF must be a power of 2"
+#endif
+
+static struct {
+	ulong	chars;		/* characters passed to serial_putc() */
+	ulong	loads;		/* writes to the UART: FIFO loads or single chars */
+	ulong	wait_ms;	/* time spent waiting for the UART */
+	ulong	wait_ticks;	/* remainder of the above, in timebase ticks */
+} txstat;
+
+/* .bss cannot be used before relocation */
+static inline int txbuf_active (void)
+{
+	DECLARE_GLOBAL_DATA_PTR;
+
+	return (gd->flags & GD_FLG_RELOC) != 0;
+}
+
+static void txstat_wait (unsigned long long start)
+{
+	ulong per_ms = get_tbclk () / 1000;
+
+	txstat.wait_ticks += (ulong)(get_ticks () - start);
+	if (txstat.wait_ticks >= per_ms) {
+		txstat.wait_ms += txstat.wait_ticks / per_ms;
+		txstat.wait_ticks %= per_ms;
+	}
+}
+
+#if TXBUF_SIZE > 0
+static char txbuf[TXBUF_SIZE];
+static ulong tx_head, tx_tail;	/* free running; head - tail chars queued */
+
+/* Load the oldest queued characters into the FIFO if it is empty */
+static int txbuf_push (void)
+{
+	ulong tail = tx_tail & (TXBUF_SIZE - 1);
+	int len = tx_head - tx_tail;
+
+	if (len == 0)
+		return 0;
+	if (len > TXBUF_SIZE - tail)
+		len = TXBUF_SIZE - tail;
+	len = NS16550_putfifo (CONSOLE, txbuf + tail, len);
+	if (len) {
+		tx_tail += len;
+		txstat.loads++;
+	}
+	return len;
+}
+
+static void txbuf_putc (const char c)
+{
+	if (tx_head - tx_tail == TXBUF_SIZE) {
+		unsigned long long start = get_ticks ();
+
+		while (txbuf_push () == 0)
+			;
+		txstat_wait (start);
+	}
+	txbuf[tx_head++ & (TXBUF_SIZE - 1)] = c;
+}
+#endif
+
+static void txbuf_empty (void)
+{
+#if TXBUF_SIZE > 0
+	unsigned long long start;
+
+	if (!txbuf_active () || tx_head == tx_tail)
+		return;
+	start = get_ticks ();
+	while (tx_head != tx_tail)
+		txbuf_push ();
+	txstat_wait (start);
+#endif
+}
+
+static void txbuf_console_putc (const char c)
+{
+#if TXBUF_SIZE > 0
+	if (c == '\n')
+		txbuf_putc ('\r');
+	txbuf_putc (c);
+	txbuf_push ();
+#else
+	unsigned long long start = get_ticks ();
+
+	_serial_putc (c, CONFIG_CONS_INDEX);
+	txstat_wait (start);
+	txstat.loads += (c == '\n') ? 2 : 1;
+#endif
+	txstat.chars++;
+}
+
+/*
+ * Make sure everything written so far has left the UART,
+ * e.g. before a reset or before passing control to an OS
+ */
+void serial_flush (void)
+{
+	if (!txbuf_active ())
+		return;
+	txbuf_empty ();
+	NS16550_drain (CONSOLE);
+}
+
+void serial_txinfo (void)
+{
+	printf ("serial: %lu chars in %lu UART writes, %lu ms waiting "
+		"(%d byte buffer)\n",
+		txstat.chars, txstat.loads, txstat.wait_ms, TXBUF_SIZE);
+}
+#endif /* CFG_NS16550_TXBUF */
+
 void
 serial_putc(const char c)
 {
+#ifdef CFG_NS16550_TXBUF
+	if (txbuf_active ()) {
+		txbuf_console_putc (c);
+		return;
+	}
+#endif
 	_serial_putc(c,CONFIG_CONS_INDEX);
 }
 
 void
 serial_putc_raw(const char c)
 {
+#ifdef CFG_NS16550_TXBUF
+	txbuf_empty ();
+#endif
 	_serial_putc_raw(c,CONFIG_CONS_INDEX);
 }
 
 void
 serial_puts(const char *s)
 {
+#ifdef CFG_NS16550_TXBUF
+	if (txbuf_active ()) {
+		while (*s)
+			txbuf_console_putc (*s++);
+		return;
+	}
+#endif
 	_serial_puts(s,CONFIG_CONS_INDEX);
 }
 
 int
 serial_getc(void)
 {
+#ifdef CFG_NS16550_TXBUF
+	txbuf_empty ();
+#endif
 	return _serial_getc(CONFIG_CONS_INDEX);
 }
 
 int
 serial_tstc(void)
 {
+#if defined(CFG_NS16550_TXBUF) && (CFG_NS16550_TXBUF > 0)
+	if (txbuf_active ())
+		txbuf_push ();
+#endif
 	return _serial_tstc(CONFIG_CONS_INDEX);
 }
 
 void
 serial_setbrg(void)
 {
+#ifdef CFG_NS16550_TXBUF
+	serial_flush ();
+#endif
 	_serial_setbrg(CONFIG_CONS_INDEX);
 }
 
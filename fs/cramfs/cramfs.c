@@ -92,74 +92,198 @@ static int cramfs_read_super (struct part_info *info)
 	return 0;
 }
 
-static unsigned long cramfs_resolve (unsigned long begin, unsigned long offset,
-				     unsigned long size, int raw,
-				     char *filename)
+/*
+ * Return the name of a directory entry and its length without the
+ * zero padding, or 0 for a malformed entry.
+ */
+static int cramfs_entry_name (struct cramfs_inode *inode, char **name)
 {
-	unsigned long inodeoffset = 0, nextoffset;
+	/*
+	 * Namelengths on disk are shifted by two
+	 * and the name padded out to 4-byte boundaries
+	 * with zeroes.
+	 */
+	int namelen = CRAMFS_GET_NAMELEN (inode) << 2;
 
-	while (inodeoffset < size) {
-		struct cramfs_inode *inode;
-		char *name;
-		int namelen;
+	*name = (char *) inode + sizeof (struct cramfs_inode);
 
-		inode = (struct cramfs_inode *) (begin + offset +
-						 inodeoffset);
+	while (namelen && (*name)[namelen - 1] == '\0')
+		namelen--;
+	return namelen;
+}
 
-		/*
-		 * Namelengths on disk are shifted by two
-		 * and the name padded out to 4-byte boundaries
-		 * with zeroes.
-		 */
-		namelen = CRAMFS_GET_NAMELEN (inode) << 2;
-		name = (char *) inode + sizeof (struct cramfs_inode);
+/* Compare a path component with an entry name, like strcmp() would */
+static int cramfs_namecmp (const char *filename, const char *name, int namelen)
+{
+	int i;
 
-		nextoffset =
-			inodeoffset + sizeof (struct cramfs_inode) + namelen;
+	for (i = 0; i < namelen; i++) {
+		if (filename[i] != name[i])
+			return (unsigned char) filename[i] -
+			       (unsigned char) name[i];
+	}
+	return (unsigned char) filename[namelen];
+}
 
-		for (;;) {
-			if (!namelen)
-				return -1;
-			if (name[namelen - 1])
-				break;
-			namelen--;
-		}
+/*
+ * Entry offsets of recently searched sorted directories, so that a
+ * lookup is a binary search. An index is tied to the image by its
+ * fsid CRC, which covers the whole image, and the image address.
+ */
+#define CRAMFS_DIR_INDEXES	4
+
+static struct cramfs_dir_index {
+	unsigned long begin;		/* image address */
+	unsigned long offset;		/* directory offset in the image */
+	u32 crc;			/* fsid CRC of the image */
+	int count;			/* number of entries */
+	unsigned long *entry;		/* their inode offsets */
+} dir_index[CRAMFS_DIR_INDEXES];
+static int dir_index_next;
+
+static struct cramfs_dir_index *cramfs_dir_index (unsigned long begin,
+						  unsigned long offset,
+						  unsigned long size)
+{
+	struct cramfs_dir_index *di;
+	struct cramfs_inode *inode;
+	unsigned long inodeoffset;
+	int i;
 
-		if (!strncmp (filename, name, namelen)) {
-			char *p = strtok (NULL, "/");
+	for (i = 0; i < CRAMFS_DIR_INDEXES; i++) {
+		di = &dir_index[i];
+		if (di->entry && di->begin == begin && di->offset == offset &&
+		    di->crc == super.fsid.crc)
+			return di;
+	}
 
-			if (raw && (p == NULL || *p == '\0'))
-				return offset + inodeoffset;
+	di = &dir_index[dir_index_next];
+	dir_index_next = (dir_index_next + 1) % CRAMFS_DIR_INDEXES;
+	if (di->entry)
+		free (di->entry);
+	di->entry = malloc ((size / (sizeof (struct cramfs_inode) + 4) + 1) *
+			    sizeof (unsigned long));
+	if (di->entry == NULL)
+		return NULL;
+
+	di->count = 0;
+	inodeoffset = 0;
+	while (inodeoffset < size) {
+		inode = (struct cramfs_inode *) (begin + offset + inodeoffset);
+		if (!CRAMFS_GET_NAMELEN (inode)) {
+			free (di->entry);
+			di->entry = NULL;
+			return NULL;
+		}
+		di->entry[di->count++] = offset + inodeoffset;
+		inodeoffset += sizeof (struct cramfs_inode) +
+			       (CRAMFS_GET_NAMELEN (inode) << 2);
+	}
+	di->begin = begin;
+	di->offset = offset;
+	di->crc = super.fsid.crc;
 
-			if (S_ISDIR (CRAMFS_16 (inode->mode))) {
-				return cramfs_resolve (begin,
-						       CRAMFS_GET_OFFSET
-						       (inode) << 2,
-						       CRAMFS_24 (inode->
-								  size), raw,
-						       p);
-			} else if (S_ISREG (CRAMFS_16 (inode->mode))) {
+	return di;
+}
+
+/*
+ * Find FILENAME in the directory at OFFSET. Returns the offset of its
+ * inode, 0 if it isn't there or -1 for a malformed directory.
+ *
+ * mkcramfs sorts the entries of each directory by name and says so
+ * with CRAMFS_FLAG_SORTED_DIRS; such directories are binary searched,
+ * others (or if no index can be built) are scanned linearly.
+ */
+static unsigned long cramfs_lookup (unsigned long begin, unsigned long offset,
+				    unsigned long size, char *filename)
+{
+	struct cramfs_dir_index *di = NULL;
+	struct cramfs_inode *inode;
+	unsigned long inodeoffset;
+	char *name;
+	int namelen, lo, hi, mid, cmp;
+
+	if (super.flags & CRAMFS_FLAG_SORTED_DIRS)
+		di = cramfs_dir_index (begin, offset, size);
+
+	if (di == NULL) {
+		inodeoffset = 0;
+		while (inodeoffset < size) {
+			inode = (struct cramfs_inode *) (begin + offset +
+							 inodeoffset);
+			namelen = cramfs_entry_name (inode, &name);
+			if (!namelen)
+				return -1;
+			if (cramfs_namecmp (filename, name, namelen) == 0)
 				return offset + inodeoffset;
-			} else {
-				printf ("%*.*s: unsupported file type (%x)\n",
-					namelen, namelen, name,
-					CRAMFS_16 (inode->mode));
-				return 0;
-			}
+			inodeoffset += sizeof (struct cramfs_inode) +
+				       (CRAMFS_GET_NAMELEN (inode) << 2);
 		}
-
-		inodeoffset = nextoffset;
+		return 0;
 	}
 
-	printf ("can't find corresponding entry\n");
+	lo = 0;
+	hi = di->count - 1;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		inode = (struct cramfs_inode *) (begin + di->entry[mid]);
+		namelen = cramfs_entry_name (inode, &name);
+		if (!namelen)
+			return -1;
+		cmp = cramfs_namecmp (filename, name, namelen);
+		if (cmp == 0)
+			return di->entry[mid];
+		if (cmp < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
 	return 0;
 }
 
+static unsigned long cramfs_resolve (unsigned long begin, unsigned long offset,
+				     unsigned long size, int raw,
+				     char *filename)
+{
+	struct cramfs_inode *inode;
+	unsigned long inodeoffset;
+	char *name, *p;
+	int namelen;
+
+	inodeoffset = filename ? cramfs_lookup (begin, offset, size, filename)
+			       : 0;
+	if (inodeoffset == -1)
+		return -1;
+	if (inodeoffset == 0) {
+		printf ("can't find corresponding entry\n");
+		return 0;
+	}
+
+	inode = (struct cramfs_inode *) (begin + inodeoffset);
+	p = strtok (NULL, "/");
+
+	if (raw && (p == NULL || *p == '\0'))
+		return inodeoffset;
+
+	if (S_ISDIR (CRAMFS_16 (inode->mode))) {
+		return cramfs_resolve (begin,
+				       CRAMFS_GET_OFFSET (inode) << 2,
+				       CRAMFS_24 (inode->size), raw, p);
+	} else if (S_ISREG (CRAMFS_16 (inode->mode))) {
+		return inodeoffset;
+	} else {
+		namelen = cramfs_entry_name (inode, &name);
+		printf ("%*.*s: unsupported file type (%x)\n",
+			namelen, namelen, name, CRAMFS_16 (inode->mode));
+		return 0;
+	}
+}
+
 static int cramfs_uncompress (unsigned long begin, unsigned long offset,
 			      unsigned long loadoffset)
 {
 	struct cramfs_inode *inode = (struct cramfs_inode *) (begin + offset);
-	unsigned long *block_ptrs = (unsigned long *)
+	u32 *block_ptrs = (u32 *)
 		(begin + (CRAMFS_GET_OFFSET (inode) << 2));
 	unsigned long curr_block = (CRAMFS_GET_OFFSET (inode) +
 				    (((CRAMFS_24 (inode->size)) +
@@ -167,7 +291,8 @@ static int cramfs_uncompress (unsigned long begin, unsigned long offset,
 	int size, total_size = 0;
 	int i;
 
-	cramfs_uncompress_init ();
+	if (cramfs_uncompress_init ())
+		return -1;
 
 	for (i = 0; i < ((CRAMFS_24 (inode->size) + 4095) >> 12); i++) {
 		size = cramfs_uncompress_block ((void *) loadoffset,
@@ -181,7 +306,6 @@ static int cramfs_uncompress (unsigned long begin, unsigned long offset,
 		curr_block = CRAMFS_32 (block_ptrs[i]);
 	}
 
-	cramfs_uncompress_exit ();
 	return total_size;
 }
 
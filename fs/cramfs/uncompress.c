@@ -27,7 +27,13 @@
 
 #if (CONFIG_COMMANDS & CFG_CMD_JFFS2)
 
+/*
+ * The inflate context is set up by the first cramfs_uncompress_init()
+ * and then kept; each block only needs an inflateReset(), so loading
+ * a file doesn't allocate and free the window every time.
+ */
 static z_stream stream;
+static int stream_ready;
 
 #define ZALLOC_ALIGNMENT	16
 
@@ -77,6 +83,9 @@ int cramfs_uncompress_init (void)
 {
 	int err;
 
+	if (stream_ready)
+		return 0;
+
 	stream.zalloc = zalloc;
 	stream.zfree = zfree;
 	stream.next_in = 0;
@@ -93,13 +102,16 @@ int cramfs_uncompress_init (void)
 		printf ("Error: inflateInit2() returned %d\n", err);
 		return -1;
 	}
+	stream_ready = 1;
 
 	return 0;
 }
 
 int cramfs_uncompress_exit (void)
 {
-	inflateEnd (&stream);
+	if (stream_ready)
+		inflateEnd (&stream);
+	stream_ready = 0;
 	return 0;
 }
 
@@ -28,6 +28,7 @@
 #if (CONFIG_COMMANDS & CFG_CMD_EXT2)
 #include <ext2fs.h>
 #include <malloc.h>
+#include <region.h>
 #include <asm/byteorder.h>
 
 extern int ext2fs_devread (int sector, int byte_offset, int byte_len,
@@ -56,6 +57,22 @@ extern int ext2fs_devread (int sector, int byte_offset, int byte_len,
 #define FILETYPE_INO_DIRECTORY	0040000
 #define FILETYPE_INO_SYMLINK	0120000
 
+/* Directory index (HTree) support.  */
+#define EXT2_FEATURE_COMPAT_DIR_INDEX	0x0020
+#define EXT2_INDEX_FL			0x00001000
+#define EXT2_FLAGS_SIGNED_HASH		0x0001
+#define EXT2_FLAGS_UNSIGNED_HASH	0x0002
+
+#define DX_HASH_LEGACY			0
+#define DX_HASH_HALF_MD4		1
+#define DX_HASH_TEA			2
+#define DX_HASH_LEGACY_UNSIGNED		3
+#define DX_HASH_HALF_MD4_UNSIGNED	4
+#define DX_HASH_TEA_UNSIGNED		5
+
+/* Deepest index supported: root plus two levels of index nodes.  */
+#define DX_MAX_LEVELS			2
+
 /* Bits used as offset in sector */
 #define DISK_SECTOR_BITS        9
 
@@ -105,6 +122,27 @@ struct ext2_sblock {
 	char volume_name[16];
 	char last_mounted_on[64];
 	uint32_t compression_info;
+	uint8_t prealloc_blocks;
+	uint8_t prealloc_dir_blocks;
+	uint16_t reserved_gdt_blocks;
+	uint8_t journal_uuid[16];
+	uint32_t journal_inode;
+	uint32_t journal_dev;
+	uint32_t last_orphan;
+	uint32_t hash_seed[4];
+	uint8_t default_hash_version;
+	uint8_t journal_backup_type;
+	uint16_t descriptor_size;
+	uint32_t default_mount_options;
+	uint32_t first_meta_block_group;
+	uint32_t mkfs_time;
+	uint32_t journal_blocks[17];
+	uint32_t total_blocks_high;
+	uint32_t reserved_blocks_high;
+	uint32_t free_blocks_high;
+	uint16_t min_extra_inode_size;
+	uint16_t want_extra_inode_size;
+	uint32_t flags;
 };
 
 /* The ext2 blockgroup.  */
@@ -156,6 +194,28 @@ struct ext2_dirent {
 	uint8_t filetype;
 };
 
+/* Header of the root block of an indexed directory, after the "."
+   and ".." entries.  */
+struct dx_root_info {
+	uint32_t reserved_zero;
+	uint8_t hash_version;
+	uint8_t info_length;
+	uint8_t indirect_levels;
+	uint8_t unused_flags;
+};
+
+/* An index entry; in the first entry of a block, the hash is replaced
+   by the limit and count of entries in that block.  */
+struct dx_entry {
+	uint32_t hash;
+	uint32_t block;
+};
+
+struct dx_countlimit {
+	uint16_t limit;
+	uint16_t count;
+};
+
 struct ext2fs_node {
 	struct ext2_data *data;
 	struct ext2_inode inode;
@@ -175,6 +235,8 @@ typedef struct ext2fs_node *ext2fs_node_t;
 
 struct ext2_data *ext2fs_root = NULL;
 ext2fs_node_t ext2fs_file = NULL;
+/* Directory entry nodes; one is allocated per entry while iterating */
+static pool_t ext2fs_node_pool;
 int symlinknest = 0;
 uint32_t *indir1_block = NULL;
 int indir1_size = 0;
@@ -241,7 +303,7 @@ static int ext2fs_read_inode
 
 void ext2fs_free_node (ext2fs_node_t node, ext2fs_node_t currroot) {
 	if ((node != &ext2fs_root->diropen) && (node != currroot)) {
-		free (node);
+		pool_free (&ext2fs_node_pool, node);
 	}
 }
 
@@ -446,6 +508,293 @@ int ext2fs_read_file
 }
 
 
+/* Directory hashes, as in the Linux ext3 dir_index code.  */
+#define DX_ROUND(f, a, b, c, d, x, s) \
+	(a += f (b, c, d) + x, a = (a << s) | (a >> (32 - s)))
+#define DX_F(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define DX_G(x, y, z)	(((x) & (y)) + (((x) ^ (y)) & (z)))
+#define DX_H(x, y, z)	((x) ^ (y) ^ (z))
+#define DX_K2		013240474631UL
+#define DX_K3		015666365641UL
+
+static void ext2fs_half_md4 (uint32_t buf[4], const uint32_t in[8])
+{
+	uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	/* Round 1 */
+	DX_ROUND (DX_F, a, b, c, d, in[0], 3);
+	DX_ROUND (DX_F, d, a, b, c, in[1], 7);
+	DX_ROUND (DX_F, c, d, a, b, in[2], 11);
+	DX_ROUND (DX_F, b, c, d, a, in[3], 19);
+	DX_ROUND (DX_F, a, b, c, d, in[4], 3);
+	DX_ROUND (DX_F, d, a, b, c, in[5], 7);
+	DX_ROUND (DX_F, c, d, a, b, in[6], 11);
+	DX_ROUND (DX_F, b, c, d, a, in[7], 19);
+
+	/* Round 2 */
+	DX_ROUND (DX_G, a, b, c, d, in[1] + DX_K2, 3);
+	DX_ROUND (DX_G, d, a, b, c, in[3] + DX_K2, 5);
+	DX_ROUND (DX_G, c, d, a, b, in[5] + DX_K2, 9);
+	DX_ROUND (DX_G, b, c, d, a, in[7] + DX_K2, 13);
+	DX_ROUND (DX_G, a, b, c, d, in[0] + DX_K2, 3);
+	DX_ROUND (DX_G, d, a, b, c, in[2] + DX_K2, 5);
+	DX_ROUND (DX_G, c, d, a, b, in[4] + DX_K2, 9);
+	DX_ROUND (DX_G, b, c, d, a, in[6] + DX_K2, 13);
+
+	/* Round 3 */
+	DX_ROUND (DX_H, a, b, c, d, in[3] + DX_K3, 3);
+	DX_ROUND (DX_H, d, a, b, c, in[7] + DX_K3, 9);
+	DX_ROUND (DX_H, c, d, a, b, in[2] + DX_K3, 11);
+	DX_ROUND (DX_H, b, c, d, a, in[6] + DX_K3, 15);
+	DX_ROUND (DX_H, a, b, c, d, in[1] + DX_K3, 3);
+	DX_ROUND (DX_H, d, a, b, c, in[5] + DX_K3, 9);
+	DX_ROUND (DX_H, c, d, a, b, in[0] + DX_K3, 11);
+	DX_ROUND (DX_H, b, c, d, a, in[4] + DX_K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+static void ext2fs_tea (uint32_t buf[4], const uint32_t in[4])
+{
+	uint32_t sum = 0;
+	uint32_t b0 = buf[0], b1 = buf[1];
+	uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+	int n = 16;
+
+	do {
+		sum += 0x9e3779b9;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	} while (--n);
+
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+/* Character N of NAME, sign extended for the "signed" hash variants.  */
+#define DX_CHAR(name, n, uns) \
+	((uns) ? (uint32_t) (unsigned char) (name)[n] \
+	       : (uint32_t) (int) (signed char) (name)[n])
+
+static void ext2fs_str2hashbuf (const char *msg, int len, uint32_t *buf,
+				int num, int uns)
+{
+	uint32_t pad, val;
+	int i;
+
+	pad = (uint32_t) len | ((uint32_t) len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		val = DX_CHAR (msg, i, uns) + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+static uint32_t ext2fs_dirhash (const char *name, int len, int version,
+				const uint32_t *seed)
+{
+	uint32_t hash, hash0, hash1;
+	uint32_t buf[4], in[8];
+	int i, uns = 0;
+
+	buf[0] = 0x67452301;
+	buf[1] = 0xefcdab89;
+	buf[2] = 0x98badcfe;
+	buf[3] = 0x10325476;
+	for (i = 0; i < 4; i++) {
+		if (seed[i]) {
+			for (i = 0; i < 4; i++)
+				buf[i] = __le32_to_cpu (seed[i]);
+			break;
+		}
+	}
+
+	switch (version) {
+	case DX_HASH_LEGACY_UNSIGNED:
+		uns = 1;
+	case DX_HASH_LEGACY:
+		hash0 = 0x12a3fe2d;
+		hash1 = 0x37abe8f9;
+		for (i = 0; i < len; i++) {
+			hash = hash1 + (hash0 ^ (DX_CHAR (name, i, uns) *
+						 7152373));
+			if (hash & 0x80000000)
+				hash -= 0x7fffffff;
+			hash1 = hash0;
+			hash0 = hash;
+		}
+		hash = hash0 << 1;
+		break;
+	case DX_HASH_HALF_MD4_UNSIGNED:
+		uns = 1;
+	case DX_HASH_HALF_MD4:
+		for (; len > 0; len -= 32, name += 32) {
+			ext2fs_str2hashbuf (name, len, in, 8, uns);
+			ext2fs_half_md4 (buf, in);
+		}
+		hash = buf[1];
+		break;
+	case DX_HASH_TEA_UNSIGNED:
+		uns = 1;
+	case DX_HASH_TEA:
+		for (; len > 0; len -= 16, name += 16) {
+			ext2fs_str2hashbuf (name, len, in, 4, uns);
+			ext2fs_tea (buf, in);
+		}
+		hash = buf[0];
+		break;
+	default:
+		return (0);
+	}
+
+	hash &= ~1;
+	if (hash == (0x7fffffff << 1))
+		hash = (0x7fffffff - 1) << 1;
+	return (hash);
+}
+
+/* Find the last index entry whose hash is not above HASH.  */
+static uint32_t ext2fs_dx_search (struct dx_entry *entries, uint32_t hash)
+{
+	struct dx_countlimit *cl = (struct dx_countlimit *) entries;
+	int count = __le16_to_cpu (cl->count);
+	int lo = 1, hi = count - 1, mid;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (__le32_to_cpu (entries[mid].hash) > hash)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+	return (__le32_to_cpu (entries[lo - 1].block) & 0x00ffffff);
+}
+
+/* Check the count/limit header of an index block.  */
+static int ext2fs_dx_valid (struct dx_entry *entries, char *block, int blksz)
+{
+	struct dx_countlimit *cl = (struct dx_countlimit *) entries;
+	int limit = __le16_to_cpu (cl->limit);
+	int count = __le16_to_cpu (cl->count);
+
+	return (count > 0 && count <= limit &&
+		(char *) (entries + limit) <= block + blksz);
+}
+
+/*
+ * Look NAME up in the hash index of an indexed (dir_index) directory
+ * and return the position of its entry, reading only the index blocks
+ * on the path and the one leaf block.  Returns -1 if the directory has
+ * no index, the index looks damaged or the name isn't in the leaf (it
+ * may continue in the next leaf after a hash collision); the caller
+ * then scans the directory linearly.
+ */
+static int ext2fs_htree_find (struct ext2fs_node *diro, const char *name)
+{
+	struct ext2_data *data = diro->data;
+	struct ext2_sblock *sblock = &data->sblock;
+	int blksz = EXT2_BLOCK_SIZE (data);
+	int namelen = strlen (name);
+	struct dx_root_info *info;
+	struct dx_entry *entries;
+	struct ext2_dirent *dirent;
+	uint32_t hash, block;
+	int version, levels, off;
+	int fpos = -1;
+	ulong mark;
+	char *buf;
+
+	if (!(__le32_to_cpu (sblock->feature_compatibility) &
+	      EXT2_FEATURE_COMPAT_DIR_INDEX) ||
+	    !(__le32_to_cpu (diro->inode.flags) & EXT2_INDEX_FL) ||
+	    __le32_to_cpu (diro->inode.size) < blksz) {
+		return (-1);
+	}
+
+	mark = scratch_mark ();
+	buf = scratch_alloc (blksz);
+	if (!buf) {
+		return (-1);
+	}
+	if (ext2fs_read_file (diro, 0, blksz, buf) != blksz) {
+		goto out;
+	}
+
+	/* The root info follows the "." and ".." entries.  */
+	info = (struct dx_root_info *) (buf + 24);
+	levels = info->indirect_levels;
+	if (info->reserved_zero != 0 || info->info_length < 8 ||
+	    levels > DX_MAX_LEVELS) {
+		goto out;
+	}
+	entries = (struct dx_entry *) ((char *) info + info->info_length);
+
+	version = info->hash_version;
+	if (version <= DX_HASH_TEA) {
+		if (__le32_to_cpu (sblock->flags) & EXT2_FLAGS_UNSIGNED_HASH) {
+			version += 3;
+		} else if (!(__le32_to_cpu (sblock->flags) &
+			     EXT2_FLAGS_SIGNED_HASH) && (char) -1 > 0) {
+			version += 3;	/* created with the native char */
+		}
+	}
+	hash = ext2fs_dirhash (name, namelen, version, sblock->hash_seed);
+
+	for (;;) {
+		if (!ext2fs_dx_valid (entries, buf, blksz)) {
+			goto out;
+		}
+		block = ext2fs_dx_search (entries, hash);
+		if ((block + 1) * blksz > __le32_to_cpu (diro->inode.size) ||
+		    ext2fs_read_file (diro, block * blksz, blksz, buf) != blksz) {
+			goto out;
+		}
+		if (levels-- == 0) {
+			break;
+		}
+		/* Index node: an empty entry covering the block, then
+		   the index entries.  */
+		entries = (struct dx_entry *) (buf + 8);
+	}
+
+	/* BUF now holds the leaf block.  */
+	for (off = 0; off + sizeof (struct ext2_dirent) <= blksz;
+	     off += __le16_to_cpu (dirent->direntlen)) {
+		dirent = (struct ext2_dirent *) (buf + off);
+		if (__le16_to_cpu (dirent->direntlen) <
+		    sizeof (struct ext2_dirent)) {
+			break;
+		}
+		if (dirent->inode != 0 && dirent->namelen == namelen &&
+		    off + sizeof (struct ext2_dirent) + namelen <= blksz &&
+		    strncmp (buf + off + sizeof (struct ext2_dirent), name,
+			     namelen) == 0) {
+			fpos = block * blksz + off;
+			break;
+		}
+	}
+
+out:
+	scratch_release (mark);
+	return (fpos);
+}
+
+
 static int ext2fs_iterate_dir (ext2fs_node_t dir, char *name, ext2fs_node_t * fnode, int *ftype)
 {
 	unsigned int fpos = 0;
@@ -463,6 +812,13 @@ static int ext2fs_iterate_dir (ext2fs_node_t dir, char *name, ext2fs_node_t * fn
 			return (0);
 		}
 	}
+	/* Let the hash index of an indexed directory point at the entry.  */
+	if ((name != NULL) && (fnode != NULL) && (ftype != NULL)) {
+		status = ext2fs_htree_find (diro, name);
+		if (status >= 0) {
+			fpos = status;
+		}
+	}
 	/* Search the file.  */
 	while (fpos < __le32_to_cpu (diro->inode.size)) {
 		struct ext2_dirent dirent;
@@ -484,7 +840,7 @@ static int ext2fs_iterate_dir (ext2fs_node_t dir, char *name, ext2fs_node_t * fn
 			if (status < 1) {
 				return (0);
 			}
-			fdiro = malloc (sizeof (struct ext2fs_node));
+			fdiro = pool_alloc (&ext2fs_node_pool);
 			if (!fdiro) {
 				return (0);
 			}
@@ -512,7 +868,7 @@ static int ext2fs_iterate_dir (ext2fs_node_t dir, char *name, ext2fs_node_t * fn
 							    __le32_to_cpu(dirent.inode),
 							    &fdiro->inode);
 				if (status == 0) {
-					free (fdiro);
+					pool_free (&ext2fs_node_pool, fdiro);
 					return (0);
 				}
 				fdiro->inode_read = 1;
@@ -547,7 +903,7 @@ static int ext2fs_iterate_dir (ext2fs_node_t dir, char *name, ext2fs_node_t * fn
 							    __le32_to_cpu (dirent.inode),
 							    &fdiro->inode);
 					if (status == 0) {
-						free (fdiro);
+						pool_free (&ext2fs_node_pool, fdiro);
 						return (0);
 					}
 					fdiro->inode_read = 1;
@@ -570,7 +926,7 @@ static int ext2fs_iterate_dir (ext2fs_node_t dir, char *name, ext2fs_node_t * fn
 					__le32_to_cpu (fdiro->inode.size),
 					filename);
 			}
-			free (fdiro);
+			pool_free (&ext2fs_node_pool, fdiro);
 		}
 		fpos += __le16_to_cpu (dirent.direntlen);
 	}
@@ -842,6 +1198,10 @@ int ext2fs_mount (unsigned part_length) {
 	struct ext2_data *data;
 	int status;
 
+	if (ext2fs_node_pool.objsize == 0) {
+		pool_init (&ext2fs_node_pool, "ext2 node",
+			   sizeof (struct ext2fs_node), 16);
+	}
 	data = malloc (sizeof (struct ext2_data));
 	if (!data) {
 		return (0);
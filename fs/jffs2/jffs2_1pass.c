@@ -123,6 +123,7 @@
 #include <jffs2/jffs2_1pass.h>
 
 #include "jffs2_private.h"
+#include "summary.h"
 
 
 #define	NODE_CHUNK  	1024	/* size of memory allocation chunk in b_nodes */
@@ -154,6 +155,8 @@ static struct part_info *current_part;
  *
  */
 
+#include <linux/mtd/nand.h>
+
 /* this one defined in cmd_nand.c */
 int read_jffs2_nand(size_t start, size_t len,
 		    size_t * retlen, u_char * buf, int nanddev);
@@ -162,48 +165,158 @@ int read_jffs2_nand(size_t start, size_t len,
 #define NAND_PAGE_SHIFT 9
 #define NAND_PAGE_MASK (~(NAND_PAGE_SIZE-1))
 
+/*
+ * The NAND cache holds NAND_CACHE_PAGES pages in lines of
+ * NAND_CACHE_LINE_PAGES pages, replaced in LRU order. While the partition
+ * is scanned, a miss also reads up to NAND_CACHE_PREFETCH following lines
+ * of the same erase block.
+ */
 #ifndef NAND_CACHE_PAGES
-#define NAND_CACHE_PAGES 16
+#define NAND_CACHE_PAGES 64
+#endif
+#ifndef NAND_CACHE_LINE_PAGES
+#define NAND_CACHE_LINE_PAGES 4
 #endif
 #define NAND_CACHE_SIZE (NAND_CACHE_PAGES*NAND_PAGE_SIZE)
+#define NAND_CACHE_LINE_SIZE (NAND_CACHE_LINE_PAGES*NAND_PAGE_SIZE)
+#define NAND_CACHE_LINE_MASK (~(NAND_CACHE_LINE_SIZE-1))
+#define NAND_CACHE_LINES (NAND_CACHE_PAGES/NAND_CACHE_LINE_PAGES)
+#ifndef NAND_CACHE_PREFETCH
+#define NAND_CACHE_PREFETCH (NAND_CACHE_LINES/4)
+#endif
+
+#if NAND_CACHE_LINES < NAND_CACHE_PREFETCH + 2
+#error NAND_CACHE_PAGES too small for NAND_CACHE_PREFETCH
+#endif
+
+struct nand_cache_line {
+	u32 off;		/* NAND offset, (u32)-1 if unused */
+	int dev;		/* NAND device number */
+	u32 used;		/* LRU stamp */
+	u8 *data;
+};
 
 static u8* nand_cache = NULL;
-static u32 nand_cache_off = (u32)-1;
+static struct nand_cache_line nand_cache_lines[NAND_CACHE_LINES];
+static u32 nand_cache_clock;
+static int nand_cache_prefetch;		/* set while scanning */
+static u32 nand_cache_hits;
+static u32 nand_cache_misses;
+static u32 nand_cache_ahead;
+
+static void nand_cache_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < NAND_CACHE_LINES; i++)
+		nand_cache_lines[i].off = (u32)-1;
+}
+
+static struct nand_cache_line *nand_cache_find(int dev, u32 off)
+{
+	struct nand_cache_line *l;
+
+	if (!nand_cache)
+		return NULL;
+
+	for (l = nand_cache_lines; l < &nand_cache_lines[NAND_CACHE_LINES]; l++) {
+		if (l->off == off && l->dev == dev) {
+			l->used = ++nand_cache_clock;
+			return l;
+		}
+	}
+	return NULL;
+}
+
+static struct nand_cache_line *nand_cache_load(int dev, u32 off)
+{
+	struct nand_cache_line *l, *lru = nand_cache_lines;
+	size_t retlen;
+
+	if (!nand_cache) {
+		/* This memory never gets freed but 'cause
+		   it's a bootloader, nobody cares */
+		nand_cache = malloc(NAND_CACHE_SIZE);
+		if (!nand_cache) {
+			printf("read_nand_cached: can't alloc cache size %d bytes\n",
+			       NAND_CACHE_SIZE);
+			return NULL;
+		}
+		for (l = nand_cache_lines; l < &nand_cache_lines[NAND_CACHE_LINES]; l++)
+			l->data = nand_cache + (l - nand_cache_lines) * NAND_CACHE_LINE_SIZE;
+		nand_cache_invalidate();
+	}
+
+	for (l = nand_cache_lines; l < &nand_cache_lines[NAND_CACHE_LINES]; l++) {
+		if (l->off == (u32)-1) {
+			lru = l;
+			break;
+		}
+		if (l->used < lru->used)
+			lru = l;
+	}
+
+	lru->off = (u32)-1;
+	if (read_jffs2_nand(off, NAND_CACHE_LINE_SIZE,
+				&retlen, lru->data, dev) < 0 ||
+			retlen != NAND_CACHE_LINE_SIZE) {
+		printf("read_nand_cached: error reading nand off %#x size %d bytes\n",
+				off, NAND_CACHE_LINE_SIZE);
+		return NULL;
+	}
+	lru->off = off;
+	lru->dev = dev;
+	lru->used = ++nand_cache_clock;
+	return lru;
+}
+
+/* read the rest of the erase block holding off ahead of the scan */
+static void nand_cache_read_ahead(int dev, u32 off)
+{
+	extern struct nand_chip nand_dev_desc[];
+	u32 erasesize = nand_dev_desc[dev].erasesize;
+	u32 end = current_part->offset + current_part->size;
+	int i;
+
+	if (erasesize > NAND_CACHE_LINE_SIZE)
+		end = min(end, (off & ~(erasesize - 1)) + erasesize);
+
+	for (i = 0; i < NAND_CACHE_PREFETCH; i++) {
+		off += NAND_CACHE_LINE_SIZE;
+		if (off + NAND_CACHE_LINE_SIZE > end)
+			break;
+		if (nand_cache_find(dev, off))
+			continue;
+		if (!nand_cache_load(dev, off))
+			break;
+		nand_cache_ahead++;
+	}
+}
 
 static int read_nand_cached(u32 off, u32 size, u_char *buf)
 {
 	struct mtdids *id = current_part->dev->id;
+	struct nand_cache_line *l;
 	u32 bytes_read = 0;
-	size_t retlen;
+	u32 line_off;
 	int cpy_bytes;
 
 	while (bytes_read < size) {
-		if ((off + bytes_read < nand_cache_off) ||
-		    (off + bytes_read >= nand_cache_off+NAND_CACHE_SIZE)) {
-			nand_cache_off = (off + bytes_read) & NAND_PAGE_MASK;
-			if (!nand_cache) {
-				/* This memory never gets freed but 'cause
-				   it's a bootloader, nobody cares */
-				nand_cache = malloc(NAND_CACHE_SIZE);
-				if (!nand_cache) {
-					printf("read_nand_cached: can't alloc cache size %d bytes\n",
-					       NAND_CACHE_SIZE);
-					return -1;
-				}
-			}
-			if (read_jffs2_nand(nand_cache_off, NAND_CACHE_SIZE,
-						&retlen, nand_cache, id->num) < 0 ||
-					retlen != NAND_CACHE_SIZE) {
-				printf("read_nand_cached: error reading nand off %#x size %d bytes\n",
-						nand_cache_off, NAND_CACHE_SIZE);
+		line_off = (off + bytes_read) & NAND_CACHE_LINE_MASK;
+		if ((l = nand_cache_find(id->num, line_off)) != NULL) {
+			nand_cache_hits++;
+		} else {
+			nand_cache_misses++;
+			if ((l = nand_cache_load(id->num, line_off)) == NULL)
 				return -1;
-			}
+			if (nand_cache_prefetch)
+				nand_cache_read_ahead(id->num, line_off);
 		}
-		cpy_bytes = nand_cache_off + NAND_CACHE_SIZE - (off + bytes_read);
+		cpy_bytes = line_off + NAND_CACHE_LINE_SIZE - (off + bytes_read);
 		if (cpy_bytes > size - bytes_read)
 			cpy_bytes = size - bytes_read;
 		memcpy(buf + bytes_read,
-		       nand_cache + off + bytes_read - nand_cache_off,
+		       l->data + off + bytes_read - line_off,
 		       cpy_bytes);
 		bytes_read += cpy_bytes;
 	}
@@ -345,65 +458,37 @@ static char *compr_names[] = {
 /* Spinning wheel */
 static char spinner[] = { '|', '/', '-', '\\' };
 
-/* Memory management */
-struct mem_block {
-	u32	index;
-	struct mem_block *next;
-	struct b_node nodes[NODE_CHUNK];
-};
-
-
+/* Memory management: nodes come from a pool, NODE_CHUNK at a time */
 static void
 free_nodes(struct b_list *list)
 {
-	while (list->listMemBase != NULL) {
-		struct mem_block *next = list->listMemBase->next;
-		free( list->listMemBase );
-		list->listMemBase = next;
+	if (list->listHash != NULL) {
+		free(list->listHash);
+		list->listHash = NULL;
 	}
+	if (list->listInoHash != NULL) {
+		free(list->listInoHash);
+		list->listInoHash = NULL;
+	}
+	pool_destroy(&list->listPool);
 }
 
 static struct b_node *
 add_node(struct b_list *list)
 {
-	u32 index = 0;
-	struct mem_block *memBase;
 	struct b_node *b;
 
-	memBase = list->listMemBase;
-	if (memBase != NULL)
-		index = memBase->index;
-#if 0
-	putLabeledWord("add_node: index = ", index);
-	putLabeledWord("add_node: memBase = ", list->listMemBase);
-#endif
-
-	if (memBase == NULL || index >= NODE_CHUNK) {
-		/* we need more space before we continue */
-		memBase = mmalloc(sizeof(struct mem_block));
-		if (memBase == NULL) {
-			putstr("add_node: malloc failed\n");
-			return NULL;
-		}
-		memBase->next = list->listMemBase;
-		index = 0;
-#if 0
-		putLabeledWord("add_node: alloced a new membase at ", *memBase);
-#endif
-
+	b = pool_alloc(&list->listPool);
+	if (b == NULL) {
+		putstr("add_node: malloc failed\n");
+		return NULL;
 	}
-	/* now we have room to add it. */
-	b = &memBase->nodes[index];
-	index ++;
-
-	memBase->index = index;
-	list->listMemBase = memBase;
 	list->listCount++;
 	return b;
 }
 
 static struct b_node *
-insert_node(struct b_list *list, u32 offset)
+insert_node(struct b_list *list, u32 offset, u32 key)
 {
 	struct b_node *new;
 #ifdef CFG_JFFS2_SORT_FRAGMENTS
@@ -415,6 +500,9 @@ insert_node(struct b_list *list, u32 offset)
 		return NULL;
 	}
 	new->offset = offset;
+	new->key = key;
+	new->hdrcrc = CRC_UNKNOWN;
+	new->datacrc = CRC_UNKNOWN;
 
 #ifdef CFG_JFFS2_SORT_FRAGMENTS
 	if (list->listTail != NULL && list->listCompare(new, list->listTail))
@@ -453,6 +541,86 @@ insert_node(struct b_list *list, u32 offset)
 	return new;
 }
 
+/*
+ * Index a list by b_node->key once it is complete, and the directory
+ * entries also by the inode they point to (byino). The buckets are
+ * chained in list order, so walking a bucket sees the nodes in the same
+ * order as walking the whole list would.
+ */
+static int
+hash_nodes(struct b_list *list, int byino)
+{
+	struct b_node *b, **tail;
+	u32 size = 64;
+	u32 i;
+
+	while (size < list->listCount)
+		size <<= 1;
+
+	list->listHash = malloc(size * sizeof(struct b_node *));
+	if (byino)
+		list->listInoHash = malloc(size * sizeof(struct b_node *));
+	tail = malloc(size * sizeof(struct b_node *));
+	if (list->listHash == NULL || tail == NULL ||
+	    (byino && list->listInoHash == NULL)) {
+		putstr("hash_nodes: malloc failed\n");
+		if (tail != NULL)
+			free(tail);
+		if (list->listHash != NULL)
+			free(list->listHash);
+		if (list->listInoHash != NULL)
+			free(list->listInoHash);
+		list->listHash = list->listInoHash = NULL;
+		return 0;
+	}
+	list->listHashMask = size - 1;
+
+	for (i = 0; i < size; i++)
+		list->listHash[i] = tail[i] = NULL;
+
+	for (b = list->listHead; b != NULL; b = b->next) {
+		i = b->key & list->listHashMask;
+		b->hnext = NULL;
+		if (tail[i] != NULL)
+			tail[i]->hnext = b;
+		else
+			list->listHash[i] = b;
+		tail[i] = b;
+	}
+
+	if (byino) {
+		for (i = 0; i < size; i++)
+			list->listInoHash[i] = tail[i] = NULL;
+
+		for (b = list->listHead; b != NULL; b = b->next) {
+			i = b->ino & list->listHashMask;
+			b->inext = NULL;
+			if (tail[i] != NULL)
+				tail[i]->inext = b;
+			else
+				list->listInoHash[i] = b;
+			tail[i] = b;
+		}
+	}
+
+	free(tail);
+	return 1;
+}
+
+/* first node of the bucket of key; callers still have to compare keys */
+static inline struct b_node *
+hash_first(struct b_list *list, u32 key)
+{
+	return list->listHash[key & list->listHashMask];
+}
+
+/* first dirent of the bucket of ino, follow b_node->inext */
+static inline struct b_node *
+hash_first_ino(struct b_list *list, u32 ino)
+{
+	return list->listInoHash[ino & list->listHashMask];
+}
+
 #ifdef CFG_JFFS2_SORT_FRAGMENTS
 /* Sort data entries with the latest version last, so that if there
  * is overlapping data the latest version will be used.
@@ -515,21 +683,80 @@ static int compare_dirents(struct b_node *new, struct b_node *old)
 }
 #endif
 
+/*
+ * The CRCs of a node are checked the first time it is used, and the result
+ * is remembered in the b_node. jNode/jDir must hold the complete node when
+ * the name or data CRC is checked.
+ */
+static int
+inode_valid(struct b_node *b, struct jffs2_raw_inode *jNode)
+{
+	if (b->hdrcrc == CRC_UNKNOWN)
+		b->hdrcrc = inode_crc(jNode) ? CRC_OK : CRC_BAD;
+	return b->hdrcrc == CRC_OK;
+}
+
+static int
+inode_data_valid(struct b_node *b, struct jffs2_raw_inode *jNode)
+{
+	if (b->datacrc == CRC_UNKNOWN) {
+		b->datacrc = data_crc(jNode) ? CRC_OK : CRC_BAD;
+		if (b->datacrc == CRC_BAD)
+			printf("jffs2: data CRC error in node at %#x, "
+			       "skipped\n", b->offset);
+	}
+	return b->datacrc == CRC_OK;
+}
+
+static int
+dirent_valid(struct b_node *b, struct jffs2_raw_dirent *jDir)
+{
+	if (b->hdrcrc == CRC_UNKNOWN)
+		b->hdrcrc = (dirent_crc(jDir) && dirent_name_crc(jDir)) ?
+				CRC_OK : CRC_BAD;
+	return b->hdrcrc == CRC_OK;
+}
+
+#define	EMPTY_SCAN_SIZE	256	/* bytes checked per flash read in scan_empty */
+
+/*
+ * Skip erased flash a buffer at a time. Returns the offset of the first
+ * word which is not 0xFFFFFFFF, or the offset where spinning is due.
+ */
 static u32
 jffs2_scan_empty(u32 start_offset, struct part_info *part)
 {
-	char *max = (char *)(part->offset + part->size - sizeof(struct jffs2_raw_inode));
-	char *offset = (char *)(part->offset + start_offset);
-	u32 off;
+	u32 max = part->size - sizeof(struct jffs2_raw_inode);
+	u32 offset = start_offset;
+	u32 buf[EMPTY_SCAN_SIZE / sizeof(u32)];
+	u32 *p;
+	u32 len, i;
+
+	while (offset < max) {
+		len = max - offset;
+		if (len > EMPTY_SCAN_SIZE)
+			len = EMPTY_SCAN_SIZE;
+		len &= ~3;
+		if (len == 0)
+			break;
+
+		p = (u32 *)get_fl_mem(part->offset + offset, len, buf);
+		if (p == NULL)
+			break;
+		for (i = 0; i < len / sizeof(u32); i++) {
+			if (p[i] != 0xFFFFFFFF)
+				return offset + i * sizeof(u32);
+		}
 
-	while (offset < max &&
-	       *(u32*)get_fl_mem((u32)offset, sizeof(u32), &off) == 0xFFFFFFFF) {
-		offset += sizeof(u32);
 		/* return if spinning is due */
-		if (((u32)offset & ((1 << SPIN_BLKSIZE)-1)) == 0) break;
+		if (((offset + len) >> SPIN_BLKSIZE) != (offset >> SPIN_BLKSIZE)) {
+			offset += len;
+			break;
+		}
+		offset += len;
 	}
 
-	return (u32)offset - part->offset;
+	return offset;
 }
 
 void
@@ -556,6 +783,10 @@ jffs_init_1pass_list(struct part_info *part)
 		pL = (struct b_lists *)part->jffs2_priv;
 
 		memset(pL, 0, sizeof(*pL));
+		pool_init(&pL->dir.listPool, "jffs2 dirent",
+			  sizeof(struct b_node), NODE_CHUNK);
+		pool_init(&pL->frag.listPool, "jffs2 inode",
+			  sizeof(struct b_node), NODE_CHUNK);
 #ifdef CFG_JFFS2_SORT_FRAGMENTS
 		pL->dir.listCompare = compare_dirents;
 		pL->frag.listCompare = compare_inodes;
@@ -585,10 +816,12 @@ jffs2_1pass_read_inode(struct b_lists *pL, u32 inode, char *dest)
 	 * This shouldn't cause trouble when loading kernel images, so
 	 * we will live with it.
 	 */
-	for (b = pL->frag.listHead; b != NULL; b = b->next) {
+	for (b = hash_first(&pL->frag, inode); b != NULL; b = b->hnext) {
+		if (b->key != inode)
+			continue;
 		jNode = (struct jffs2_raw_inode *) get_fl_mem(b->offset,
 		        sizeof(struct jffs2_raw_inode), NULL);
-		if ((inode == jNode->ino)) {
+		if ((inode == jNode->ino) && inode_valid(b, jNode)) {
 			/* get actual file length from the newest node */
 			if (jNode->version >= latestVersion) {
 				totalSize = jNode->isize;
@@ -599,9 +832,11 @@ jffs2_1pass_read_inode(struct b_lists *pL, u32 inode, char *dest)
 	}
 #endif
 
-	for (b = pL->frag.listHead; b != NULL; b = b->next) {
+	for (b = hash_first(&pL->frag, inode); b != NULL; b = b->hnext) {
+		if (b->key != inode)
+			continue;
 		jNode = (struct jffs2_raw_inode *) get_node_mem(b->offset);
-		if ((inode == jNode->ino)) {
+		if ((inode == jNode->ino) && inode_valid(b, jNode)) {
 #if 0
 			putLabeledWord("\r\n\r\nread_inode: totlen = ", jNode->totlen);
 			putLabeledWord("read_inode: inode = ", jNode->ino);
@@ -630,6 +865,10 @@ jffs2_1pass_read_inode(struct b_lists *pL, u32 inode, char *dest)
 					put_fl_mem(jNode);
 					continue;
 				}
+				if (!inode_data_valid(b, jNode)) {
+					put_fl_mem(jNode);
+					continue;
+				}
 
 				lDest = (uchar *) (dest + jNode->offset);
 #if 0
@@ -699,17 +938,22 @@ jffs2_1pass_find_inode(struct b_lists * pL, const char *name, u32 pino)
 	u32 counter;
 	u32 version = 0;
 	u32 inode = 0;
+	u32 key;
 
 	/* name is assumed slash free */
 	len = strlen(name);
+	key = jffs2_dir_hash(pino, (const u8 *)name, len);
 
 	counter = 0;
 	/* we need to search all and return the inode with the highest version */
-	for(b = pL->dir.listHead; b; b = b->next, counter++) {
+	for(b = hash_first(&pL->dir, key); b; b = b->hnext, counter++) {
+		if (b->key != key)
+			continue;
 		jDir = (struct jffs2_raw_dirent *) get_node_mem(b->offset);
 		if ((pino == jDir->pino) && (len == jDir->nsize) &&
 		    (jDir->ino) &&	/* 0 for unlink */
-		    (!strncmp((char *)jDir->name, name, len))) {	/* a match */
+		    (!strncmp((char *)jDir->name, name, len)) &&	/* a match */
+		    dirent_valid(b, jDir)) {
 			if (jDir->version < version) {
 				put_fl_mem(jDir);
 				continue;
@@ -830,16 +1074,20 @@ jffs2_1pass_list_inodes(struct b_lists * pL, u32 pino)
 
 	for (b = pL->dir.listHead; b; b = b->next) {
 		jDir = (struct jffs2_raw_dirent *) get_node_mem(b->offset);
-		if ((pino == jDir->pino) && (jDir->ino)) { /* ino=0 -> unlink */
+		if ((pino == jDir->pino) && (jDir->ino) && /* ino=0 -> unlink */
+		    dirent_valid(b, jDir)) {
 			u32 i_version = 0;
 			struct jffs2_raw_inode ojNode;
 			struct jffs2_raw_inode *jNode, *i = NULL;
-			struct b_node *b2 = pL->frag.listHead;
+			struct b_node *b2;
 
-			while (b2) {
+			for (b2 = hash_first(&pL->frag, jDir->ino); b2; b2 = b2->hnext) {
+				if (b2->key != jDir->ino)
+					continue;
 				jNode = (struct jffs2_raw_inode *)
 					get_fl_mem(b2->offset, sizeof(ojNode), &ojNode);
-				if (jNode->ino == jDir->ino && jNode->version >= i_version) {
+				if (jNode->ino == jDir->ino && jNode->version >= i_version &&
+				    inode_valid(b2, jNode)) {
 					if (i)
 						put_fl_mem(i);
 
@@ -847,8 +1095,8 @@ jffs2_1pass_list_inodes(struct b_lists * pL, u32 pino)
 						i = get_node_mem(b2->offset);
 					else
 						i = get_fl_mem(b2->offset, sizeof(*i), NULL);
+					i_version = jNode->version;
 				}
-				b2 = b2->next;
 			}
 
 			dump_inode(pL, jDir, i);
@@ -921,19 +1169,39 @@ jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
 	struct b_node *b;
 	struct b_node *b2;
 	struct jffs2_raw_dirent *jDir;
+	struct jffs2_raw_inode ojNode;
 	struct jffs2_raw_inode *jNode;
 	u8 jDirFoundType = 0;
 	u32 jDirFoundIno = 0;
 	u32 jDirFoundPino = 0;
 	char tmp[256];
 	u32 version = 0;
+	u32 mode = 0;
 	u32 pino;
 	unsigned char *src;
 
-	/* we need to search all and return the inode with the highest version */
-	for(b = pL->dir.listHead; b; b = b->next) {
+	/* the newest inode node tells whether there is a link to follow */
+	for (b2 = hash_first(&pL->frag, ino); b2; b2 = b2->hnext) {
+		if (b2->key != ino)
+			continue;
+		jNode = (struct jffs2_raw_inode *) get_fl_mem(b2->offset,
+			sizeof(ojNode), &ojNode);
+		if (jNode->ino == ino && jNode->version >= version &&
+		    inode_valid(b2, jNode)) {
+			mode = jNode->mode;
+			version = jNode->version;
+		}
+	}
+	if (version != 0 && !S_ISLNK(mode))
+		return ino;
+	version = 0;
+
+	/* the newest directory entry pointing to it */
+	for (b = hash_first_ino(&pL->dir, ino); b; b = b->inext) {
+		if (b->ino != ino)
+			continue;
 		jDir = (struct jffs2_raw_dirent *) get_node_mem(b->offset);
-		if (ino == jDir->ino) {
+		if (ino == jDir->ino && dirent_valid(b, jDir)) {
 		    	if (jDir->version < version) {
 				put_fl_mem(jDir);
 				continue;
@@ -959,10 +1227,12 @@ jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
 		return jDirFoundIno;
 
 	/* it's a soft link so we follow it again. */
-	b2 = pL->frag.listHead;
-	while (b2) {
+	tmp[0] = '\0';
+	for (b2 = hash_first(&pL->frag, jDirFoundIno); b2; b2 = b2->hnext) {
+		if (b2->key != jDirFoundIno)
+			continue;
 		jNode = (struct jffs2_raw_inode *) get_node_mem(b2->offset);
-		if (jNode->ino == jDirFoundIno) {
+		if (jNode->ino == jDirFoundIno && inode_valid(b2, jNode)) {
 			src = (unsigned char *)jNode + sizeof(struct jffs2_raw_inode);
 
 #if 0
@@ -976,7 +1246,6 @@ jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
 			put_fl_mem(jNode);
 			break;
 		}
-		b2 = b2->next;
 		put_fl_mem(jNode);
 	}
 	/* ok so the name of the new file to find is in tmp */
@@ -1056,6 +1325,13 @@ jffs2_1pass_rescan_needed(struct part_info *part)
 		return 1;
 	}
 
+	/* the last scan did not finish */
+	if (pL->frag.listHash == NULL || pL->dir.listHash == NULL ||
+	    pL->dir.listInoHash == NULL) {
+		DEBUGF ("rescan: no index\n");
+		return 1;
+	}
+
 	/* but suppose someone reflashed a partition at the same offset... */
 	b = pL->dir.listHead;
 	while (b) {
@@ -1133,17 +1409,194 @@ dump_dirents(struct b_lists *pL)
 }
 #endif
 
+#ifdef CONFIG_JFFS2_SUMMARY
+/*
+ * Size of the erase blocks the file system was built for. For NOR flash
+ * with boot sectors this is the largest sector, like the MTD layer does.
+ */
+static u32
+jffs2_sector_size(struct part_info *part)
+{
+	struct mtdids *id = part->dev->id;
+
+#if (CONFIG_COMMANDS & CFG_CMD_FLASH)
+	if (id->type == MTD_DEV_TYPE_NOR) {
+		extern flash_info_t flash_info[];
+		flash_info_t *flash = &flash_info[id->num];
+		u32 size, max = 0;
+		int i;
+
+		for (i = 0; i < flash->sector_count; i++) {
+			if (i + 1 < flash->sector_count)
+				size = flash->start[i + 1] - flash->start[i];
+			else
+				size = flash->start[0] + flash->size - flash->start[i];
+			if (size > max)
+				max = size;
+		}
+		return max;
+	}
+#endif
+
+#if defined(CONFIG_JFFS2_NAND) && (CONFIG_COMMANDS & CFG_CMD_NAND)
+	if (id->type == MTD_DEV_TYPE_NAND) {
+		extern struct nand_chip nand_dev_desc[];
+
+		return nand_dev_desc[id->num].erasesize;
+	}
+#endif
+
+	return 0;
+}
+
+static inline int
+sum_crc(struct jffs2_raw_summary *sum)
+{
+	if (sum->node_crc != crc32_no_comp(0, (unsigned char *)sum,
+				sizeof(struct jffs2_raw_summary) - 8))
+		return 0;
+	if (sum->sum_crc != crc32_no_comp(0, (unsigned char *)sum->sum,
+				sum->totlen - sizeof(struct jffs2_raw_summary)))
+		return 0;
+	return 1;
+}
+
+/* does a node of at least 'size' bytes at 'offset' fit in the sector? */
+static inline int
+sum_node_fits(u32 offset, u32 size, u32 sector_size)
+{
+	return offset < sector_size && size <= sector_size - offset;
+}
+
+/*
+ * Add the nodes listed in the summary of the erase block at 'sector'
+ * (relative to the partition) to the lists. Returns 1 if the summary was
+ * used, 0 if the block has no usable summary and must be scanned, and -1
+ * if we ran out of memory.
+ */
+static int
+jffs2_sum_scan_sector(struct part_info *part, struct b_lists *pL,
+		      u32 sector, u32 sector_size)
+{
+	struct jffs2_sum_marker omarker;
+	struct jffs2_sum_marker *marker;
+	struct jffs2_raw_summary *sum;
+	union jffs2_sum_flash *sp;
+	struct b_node *b;
+	u32 base = part->offset + sector;
+	u8 *p, *end;
+	u32 i, len;
+	int pass, ret = 0;
+
+	marker = (struct jffs2_sum_marker *) get_fl_mem(base + sector_size -
+			sizeof(omarker), sizeof(omarker), &omarker);
+	if (marker == NULL || marker->magic != JFFS2_SUM_MAGIC ||
+	    marker->offset & 3 ||
+	    marker->offset + sizeof(struct jffs2_raw_summary) > sector_size)
+		return 0;
+
+	len = sector_size - marker->offset;
+	sum = (struct jffs2_raw_summary *) get_fl_mem(base + marker->offset,
+			len, NULL);
+	if (sum == NULL)
+		return 0;
+
+	if (sum->magic != JFFS2_MAGIC_BITMASK ||
+	    sum->nodetype != JFFS2_NODETYPE_SUMMARY ||
+	    sum->totlen < sizeof(struct jffs2_raw_summary) || sum->totlen > len ||
+	    !hdr_crc((struct jffs2_unknown_node *) sum) || !sum_crc(sum)) {
+		DEBUGF("jffs2: bad summary in sector %#x\n", sector);
+		goto out;
+	}
+
+	/* check all records before adding anything, then add them */
+	end = (u8 *) sum + sum->totlen;
+	for (pass = 0; pass < 2; pass++) {
+		p = (u8 *) sum->sum;
+		for (i = 0; i < sum->sum_num; i++) {
+			sp = (union jffs2_sum_flash *) p;
+			if (p + sizeof(sp->u) > end)
+				goto out;
+
+			switch (sp->u.nodetype) {
+			case JFFS2_NODETYPE_INODE:
+				len = JFFS2_SUMMARY_INODE_SIZE;
+				if (p + len > end ||
+				    !sum_node_fits(sp->i.offset,
+					sizeof(struct jffs2_raw_inode), sector_size))
+					goto out;
+				if (pass && insert_node(&pL->frag,
+						base + sp->i.offset,
+						sp->i.inode) == NULL) {
+					ret = -1;
+					goto out;
+				}
+				break;
+			case JFFS2_NODETYPE_DIRENT:
+				len = JFFS2_SUMMARY_DIRENT_SIZE(0);
+				if (p + len > end)
+					goto out;
+				len += sp->d.nsize;
+				if (p + len > end ||
+				    !sum_node_fits(sp->d.offset,
+					sizeof(struct jffs2_raw_dirent) + sp->d.nsize,
+					sector_size))
+					goto out;
+				if (pass && (b = insert_node(&pL->dir,
+						base + sp->d.offset,
+						jffs2_dir_hash(sp->d.pino, sp->d.name,
+							       sp->d.nsize))) == NULL) {
+					ret = -1;
+					goto out;
+				}
+				if (pass)
+					b->ino = sp->d.ino;
+				break;
+			case JFFS2_NODETYPE_XATTR:
+				len = JFFS2_SUMMARY_XATTR_SIZE;
+				break;
+			case JFFS2_NODETYPE_XREF:
+				len = JFFS2_SUMMARY_XREF_SIZE;
+				break;
+			default:
+				DEBUGF("jffs2: unknown summary record %#x in "
+					"sector %#x\n", sp->u.nodetype, sector);
+				goto out;
+			}
+			p += len;
+			if (p > end)
+				goto out;
+		}
+	}
+	ret = 1;
+
+out:
+	put_fl_mem(sum);
+	return ret;
+}
+#endif /* CONFIG_JFFS2_SUMMARY */
+
 static u32
 jffs2_1pass_build_lists(struct part_info * part)
 {
 	struct b_lists *pL;
+	union jffs2_node_union onode;
 	struct jffs2_unknown_node *node;
+	struct jffs2_raw_dirent *jDir;
+	struct b_node *b;
+	u8 oname[256];
+	u8 *name;
 	u32 offset, oldoffset = 0;
 	u32 max = part->size - sizeof(struct jffs2_raw_inode);
 	u32 counter = 0;
 	u32 counter4 = 0;
 	u32 counterF = 0;
 	u32 counterN = 0;
+#ifdef CONFIG_JFFS2_SUMMARY
+	u32 sector_size, next_sector = 0;
+	u32 counterS = 0;
+	int ret;
+#endif
 
 	/* turn off the lcd.  Refreshing the lcd adds 50% overhead to the */
 	/* jffs2 list building enterprise nope.  in newer versions the overhead is */
@@ -1156,6 +1609,12 @@ jffs2_1pass_build_lists(struct part_info * part)
 	offset = 0;
 	puts ("Scanning JFFS2 FS:   ");
 
+#ifdef CONFIG_JFFS2_SUMMARY
+	sector_size = jffs2_sector_size(part);
+	if (sector_size == 0 || part->size % sector_size)
+		sector_size = 0;
+#endif
+
 	/* start at the beginning of the partition */
 	while (offset < max) {
 	    	if ((oldoffset >> SPIN_BLKSIZE) != (offset >> SPIN_BLKSIZE)) {
@@ -1163,26 +1622,57 @@ jffs2_1pass_build_lists(struct part_info * part)
 			oldoffset = offset;
 		}
 
-		node = (struct jffs2_unknown_node *) get_node_mem((u32)part->offset + offset);
-		if (node->magic == JFFS2_MAGIC_BITMASK && hdr_crc(node)) {
+#ifdef CONFIG_JFFS2_SUMMARY
+		/* try the summary once at the start of every erase block */
+		if (sector_size && offset >= next_sector) {
+			u32 sector = offset - offset % sector_size;
+
+			next_sector = sector + sector_size;
+			if (sector == offset) {
+				ret = jffs2_sum_scan_sector(part, pL, sector,
+							    sector_size);
+				if (ret < 0)
+					return 0;
+				if (ret > 0) {
+					offset = next_sector;
+					counterS++;
+					continue;
+				}
+			}
+		}
+#endif
+
+		/*
+		 * Only the header is read here, the node and name CRCs are
+		 * checked when the node is used.
+		 */
+		node = (struct jffs2_unknown_node *) get_fl_mem((u32)part->offset +
+				offset, sizeof(struct jffs2_raw_inode), &onode);
+		if (node == NULL)
+			return 0;
+		if (node->magic == JFFS2_MAGIC_BITMASK && hdr_crc(node) &&
+		    node->totlen >= sizeof(struct jffs2_unknown_node)) {
 			/* if its a fragment add it */
-			if (node->nodetype == JFFS2_NODETYPE_INODE &&
-				    inode_crc((struct jffs2_raw_inode *) node)) {
+			if (node->nodetype == JFFS2_NODETYPE_INODE) {
 				if (insert_node(&pL->frag, (u32) part->offset +
-						offset) == NULL) {
-					put_fl_mem(node);
+						offset, ((struct jffs2_raw_inode *)
+						node)->ino) == NULL)
 					return 0;
-				}
-			} else if (node->nodetype == JFFS2_NODETYPE_DIRENT &&
-				   dirent_crc((struct jffs2_raw_dirent *) node)  &&
-				   dirent_name_crc((struct jffs2_raw_dirent *) node)) {
+			} else if (node->nodetype == JFFS2_NODETYPE_DIRENT) {
 				if (! (counterN%100))
 					puts ("\b\b.  ");
-				if (insert_node(&pL->dir, (u32) part->offset +
-						offset) == NULL) {
-					put_fl_mem(node);
+				jDir = (struct jffs2_raw_dirent *) node;
+				name = (u8 *) get_fl_mem((u32)part->offset + offset +
+						sizeof(struct jffs2_raw_dirent),
+						jDir->nsize, oname);
+				if (name == NULL)
 					return 0;
-				}
+				b = insert_node(&pL->dir, (u32) part->offset +
+						offset, jffs2_dir_hash(jDir->pino,
+						name, jDir->nsize));
+				if (b == NULL)
+					return 0;
+				b->ino = jDir->ino;
 				counterN++;
 			} else if (node->nodetype == JFFS2_NODETYPE_CLEANMARKER) {
 				if (node->totlen != sizeof(struct jffs2_unknown_node))
@@ -1194,6 +1684,8 @@ jffs2_1pass_build_lists(struct part_info * part)
 					printf("OOPS Padding has bad size "
 						"%d < %d\n", node->totlen,
 						sizeof(struct jffs2_unknown_node));
+			} else if (node->nodetype == JFFS2_NODETYPE_SUMMARY) {
+				/* summary not used for this block, skip it */
 			} else {
 				printf("Unknown node type: %x len %d "
 					"offset 0x%x\n", node->nodetype,
@@ -1209,9 +1701,11 @@ jffs2_1pass_build_lists(struct part_info * part)
 			counter4++;
 		}
 /*             printf("unknown node magic %4.4x %4.4x @ %lx\n", node->magic, node->nodetype, (unsigned long)node); */
-		put_fl_mem(node);
 	}
 
+	if (!hash_nodes(&pL->frag, 0) || !hash_nodes(&pL->dir, 1))
+		return 0;
+
 	putstr("\b\b done.\r\n");		/* close off the dots */
 	/* turn the lcd back on. */
 	/* splash(); */
@@ -1221,6 +1715,9 @@ jffs2_1pass_build_lists(struct part_info * part)
 	putLabeledWord("frag entries = ", pL->frag.listCount);
 	putLabeledWord("+4 increments = ", counter4);
 	putLabeledWord("+file_offset increments = ", counterF);
+#ifdef CONFIG_JFFS2_SUMMARY
+	putLabeledWord("summarized sectors = ", counterS);
+#endif
 
 #endif
 
@@ -1256,7 +1753,7 @@ jffs2_1pass_fill_info(struct b_lists * pL, struct b_jffs2_info * piL)
 	while (b) {
 		jNode = (struct jffs2_raw_inode *) get_fl_mem(b->offset,
 			sizeof(ojNode), &ojNode);
-		if (jNode->compr < JFFS2_NUM_COMPR) {
+		if (jNode->compr < JFFS2_NUM_COMPR && inode_valid(b, jNode)) {
 			piL->compr_info[jNode->compr].num_frags++;
 			piL->compr_info[jNode->compr].compr_sum += jNode->csize;
 			piL->compr_info[jNode->compr].decompr_sum += jNode->dsize;
@@ -1270,11 +1767,22 @@ jffs2_1pass_fill_info(struct b_lists * pL, struct b_jffs2_info * piL)
 static struct b_lists *
 jffs2_get_list(struct part_info * part, const char *who)
 {
+	u32 ret;
+
 	/* copy requested part_info struct pointer to global location */
 	current_part = part;
 
 	if (jffs2_1pass_rescan_needed(part)) {
-		if (!jffs2_1pass_build_lists(part)) {
+#if defined(CONFIG_JFFS2_NAND) && (CONFIG_COMMANDS & CFG_CMD_NAND)
+		/* the flash may have been rewritten since the last scan */
+		nand_cache_invalidate();
+		nand_cache_prefetch = 1;
+#endif
+		ret = jffs2_1pass_build_lists(part);
+#if defined(CONFIG_JFFS2_NAND) && (CONFIG_COMMANDS & CFG_CMD_NAND)
+		nand_cache_prefetch = 0;
+#endif
+		if (!ret) {
 			printf("%s: Failed to scan JFFSv2 file structure\n", who);
 			return NULL;
 		}
@@ -1364,6 +1872,11 @@ jffs2_1pass_info(struct part_info * part)
 			info.compr_info[i].compr_sum,
 			info.compr_info[i].decompr_sum);
 	}
+#if defined(CONFIG_JFFS2_NAND) && (CONFIG_COMMANDS & CFG_CMD_NAND)
+	if (part->dev->id->type == MTD_DEV_TYPE_NAND)
+		printf ("NAND cache: %d hits, %d misses, %d lines read ahead\n",
+			nand_cache_hits, nand_cache_misses, nand_cache_ahead);
+#endif
 	return 1;
 }
 
@@ -2,11 +2,21 @@
 #define jffs2_private_h
 
 #include <jffs2/jffs2.h>
+#include <region.h>
 
 
+/* node CRCs are checked the first time a node is used, not while scanning */
+enum { CRC_UNKNOWN = 0, CRC_OK, CRC_BAD };
+
 struct b_node {
 	u32 offset;
 	struct b_node *next;
+	struct b_node *hnext;	/* next node in the same hash bucket */
+	struct b_node *inext;	/* dirent: next in the same listInoHash bucket */
+	u32 key;	/* inode: ino, dirent: jffs2_dir_hash(pino, name) */
+	u32 ino;	/* dirent: inode it points to */
+	u8 hdrcrc;	/* node (and name) CRC state */
+	u8 datacrc;	/* data CRC state, inodes only */
 };
 
 struct b_list {
@@ -18,7 +28,10 @@ struct b_list {
 	u32 listLoops;
 #endif
 	u32 listCount;
-	struct mem_block *listMemBase;
+	pool_t listPool;
+	struct b_node **listHash;	/* buckets, chained in list order */
+	struct b_node **listInoHash;	/* dirents by ino, likewise */
+	u32 listHashMask;
 };
 
 struct b_lists {
@@ -37,6 +50,17 @@ struct b_jffs2_info {
 	struct b_compr_info compr_info[JFFS2_NUM_COMPR];
 };
 
+/* hash key of a directory entry */
+static inline u32
+jffs2_dir_hash(u32 pino, const u8 *name, int len)
+{
+	u32 hash = pino;
+
+	while (len-- > 0)
+		hash = (hash << 5) + hash + *name++;
+	return hash;
+}
+
 static inline int
 hdr_crc(struct jffs2_unknown_node *node)
 {
@@ -85,4 +109,14 @@ inode_crc(struct jffs2_raw_inode *node)
 	}
 }
 
+static inline int
+data_crc(struct jffs2_raw_inode *node)
+{
+	if (node->data_crc != crc32_no_comp(0, (unsigned char *)node + sizeof(struct jffs2_raw_inode), node->csize)) {
+		return 0;
+	} else {
+		return 1;
+	}
+}
+
 #endif /* jffs2_private.h */
@@ -98,12 +98,109 @@ journal_read (int block, int len, char *buffer)
 			   0, len, buffer);
 }
 
+/* Map of the blocks in the valid journal transactions.  journal_init()
+ * enters every block of every transaction, later transactions
+ * replacing earlier copies, so block_read() only needs one lookup
+ * instead of walking all transactions.  The map is an open addressing
+ * hash table which is doubled whenever it becomes half full.  If it
+ * can't be allocated, block_read() falls back to the transaction walk.
+ */
+struct journal_map_entry
+{
+  __u32 block;		/* real block number */
+  __u32 jblock;		/* its latest copy, relative to journal_block */
+};
+
+#define JOURNAL_MAP_FREE	0xffffffff
+#define JOURNAL_MAP_MIN_BITS	8
+
+static struct journal_map_entry *journal_map;
+static unsigned int journal_map_bits;
+static unsigned int journal_map_used;
+
+static void
+journal_map_free (void)
+{
+  if (journal_map)
+    free (journal_map);
+  journal_map = NULL;
+  journal_map_bits = 0;
+  journal_map_used = 0;
+}
+
+static struct journal_map_entry *
+journal_map_slot (struct journal_map_entry *map, unsigned int bits,
+		  __u32 block)
+{
+  unsigned int mask = (1 << bits) - 1;
+  unsigned int i = (block * 0x9e3779b1) >> (32 - bits);
+
+  while (map[i].block != JOURNAL_MAP_FREE && map[i].block != block)
+    i = (i + 1) & mask;
+  return &map[i];
+}
+
+static struct journal_map_entry *
+journal_map_alloc (unsigned int bits)
+{
+  struct journal_map_entry *map;
+
+  map = malloc (sizeof (*map) << bits);
+  if (map)
+    memset (map, 0xff, sizeof (*map) << bits);
+  return map;
+}
+
+/* Enter BLOCK, whose copy is at JBLOCK in the journal. */
+static void
+journal_map_insert (__u32 block, __u32 jblock)
+{
+  struct journal_map_entry *slot;
+
+  if (journal_map == NULL)
+    {
+      if (journal_map_bits != 0)
+	return;			/* allocation failed before */
+      journal_map = journal_map_alloc (JOURNAL_MAP_MIN_BITS);
+      journal_map_bits = JOURNAL_MAP_MIN_BITS;
+      if (journal_map == NULL)
+	return;
+    }
+
+  if ((journal_map_used + 1) * 2 > (1U << journal_map_bits))
+    {
+      struct journal_map_entry *map;
+      unsigned int i;
+
+      map = journal_map_alloc (journal_map_bits + 1);
+      if (map == NULL)
+	{
+	  free (journal_map);
+	  journal_map = NULL;	/* keep journal_map_bits != 0 */
+	  return;
+	}
+      for (i = 0; i < (1U << journal_map_bits); i++)
+	if (journal_map[i].block != JOURNAL_MAP_FREE)
+	  *journal_map_slot (map, journal_map_bits + 1,
+			     journal_map[i].block) = journal_map[i];
+      free (journal_map);
+      journal_map = map;
+      journal_map_bits++;
+    }
+
+  slot = journal_map_slot (journal_map, journal_map_bits, block);
+  if (slot->block == JOURNAL_MAP_FREE)
+    journal_map_used++;
+  slot->block = block;
+  slot->jblock = jblock;
+}
+
 /* Read a block from ReiserFS file system, taking the journal into
- * account.  If the block nr is in the journal, the block from the
- * journal taken.
+ * account by walking all transactions.  Only used when the journal
+ * map could not be allocated.
  */
 static int
-block_read (unsigned int blockNr, int start, int len, char *buffer)
+block_read_walk (unsigned int blockNr, int start, int len, char *buffer)
 {
   int transactions = INFO->journal_transactions;
   int desc_block = INFO->journal_first_desc;
@@ -171,6 +268,37 @@ block_read (unsigned int blockNr, int start, int len, char *buffer)
   return reiserfs_devread (translatedNr << INFO->blocksize_shift, start, len, buffer);
 }
 
+/* Read a block from ReiserFS file system, taking the journal into
+ * account.  If the block nr is in the journal, the block from the
+ * journal taken.
+ */
+static int
+block_read (unsigned int blockNr, int start, int len, char *buffer)
+{
+  int translatedNr = blockNr;
+
+  if (INFO->journal_transactions == 0)
+    ;
+  else if (journal_map)
+    {
+      struct journal_map_entry *slot;
+
+      slot = journal_map_slot (journal_map, journal_map_bits, blockNr);
+      if (slot->block == blockNr)
+	{
+	  translatedNr = INFO->journal_block + slot->jblock;
+#ifdef REISERDEBUG
+	  printf ("block_read: block %d is mapped to journal block %d.\n",
+		  blockNr, slot->jblock);
+#endif
+	}
+    }
+  else
+    return block_read_walk (blockNr, start, len, buffer);
+
+  return reiserfs_devread (translatedNr << INFO->blocksize_shift, start, len, buffer);
+}
+
 /* Init the journal data structure.  We try to cache as much as
  * possible in the JOURNAL_START-JOURNAL_END space, but if it is full
  * we can still read the rest from the disk on demand.
@@ -225,6 +353,20 @@ journal_init (void)
 	      __le32_to_cpu(desc.j_trans_id), __le32_to_cpu(desc.j_mount_id), desc_block);
 #endif
 
+      {
+	unsigned int i;
+	__u32 block;
+
+	for (i = 0; i < __le32_to_cpu(desc.j_len); i++)
+	  {
+	    if (i < JOURNAL_TRANS_HALF)
+	      block = __le32_to_cpu(desc.j_realblock[i]);
+	    else
+	      block = __le32_to_cpu(commit.j_realblock[i-JOURNAL_TRANS_HALF]);
+	    journal_map_insert (block, (desc_block + 1 + i) & (block_count - 1));
+	  }
+      }
+
       next_trans_id++;
       if (journal_table < JOURNAL_END)
 	{
@@ -307,7 +449,7 @@ reiserfs_mount (unsigned part_length)
 	{
 	  /* pre journaling super block ? */
 	  if (substring (REISERFS_SUPER_MAGIC_STRING,
-			 (char*) ((int) &super + 20)) > 0)
+			 (char*) ((long) &super + 20)) > 0)
 	    return 0;
 
 	  set_sb_blocksize(&super, REISERFS_OLD_BLOCKSIZE);
@@ -344,6 +486,7 @@ reiserfs_mount (unsigned part_length)
    * journal_transactions, so we don't access the journal at all.
    */
   INFO->journal_transactions = 0;
+  journal_map_free ();
   if (sb_journal_block(&super) != 0 && super.s_journal_dev == 0)
     {
       INFO->journal_block = sb_journal_block(&super);
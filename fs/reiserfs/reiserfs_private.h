@@ -466,19 +466,19 @@ struct fsys_reiser_info
 /* The cached s+tree blocks in FSYS_BUF,  see below
  * for a more detailed description.
  */
-#define ROOT     ((char *) ((int) FSYS_BUF))
+#define ROOT     ((char *) ((long) FSYS_BUF))
 #define CACHE(i) (ROOT + ((i) << INFO->fullblocksize_shift))
 #define LEAF     CACHE (DISK_LEAF_NODE_LEVEL)
 
 #define BLOCKHEAD(cache) ((struct block_head *) cache)
-#define ITEMHEAD         ((struct item_head  *) ((int) LEAF + BLKH_SIZE))
-#define KEY(cache)       ((struct key        *) ((int) cache + BLKH_SIZE))
+#define ITEMHEAD         ((struct item_head  *) ((long) LEAF + BLKH_SIZE))
+#define KEY(cache)       ((struct key        *) ((long) cache + BLKH_SIZE))
 #define DC(cache)        ((struct disk_child *) \
-			  ((int) cache + BLKH_SIZE + KEY_SIZE * nr_item))
+			  ((long) cache + BLKH_SIZE + KEY_SIZE * nr_item))
 /* The fsys_reiser_info block.
  */
 #define INFO \
-    ((struct fsys_reiser_info *) ((int) FSYS_BUF + FSYSREISER_CACHE_SIZE))
+    ((struct fsys_reiser_info *) ((long) FSYS_BUF + FSYSREISER_CACHE_SIZE))
 /*
  * The journal cache.  For each transaction it contains the number of
  * blocks followed by the real block numbers of this transaction.
@@ -168,6 +168,8 @@
 #define CONFIG_BOOTP_SEND_HOSTNAME	0x00000100
 #define CONFIG_BOOTP_NTPSERVER		0x00000200
 #define CONFIG_BOOTP_TIMEOFFSET		0x00000400
+#define CONFIG_BOOTP_REBOOT		0x00000800
+#define CONFIG_BOOTP_RAPID_COMMIT	0x00001000
 
 #define CONFIG_BOOTP_VENDOREX		0x80000000
 
@@ -253,7 +253,11 @@ int	misc_init_r   (void);
 void	jumptable_init(void);
 
 /* common/memsize.c */
-int	get_ram_size  (volatile long *, long);
+long	get_ram_size  (volatile long *, long);
+#ifdef CFG_MEMSIZE_CACHE_ADDR
+long	get_ram_size_cached (volatile long *, long, ulong *, int);
+void	get_ram_size_report (void);
+#endif
 
 /* $(BOARD)/$(BOARD).c */
 void	reset_phy     (void);
@@ -399,6 +403,10 @@ void	serial_putc_raw(const char);
 void	serial_puts   (const char *);
 int	serial_getc   (void);
 int	serial_tstc   (void);
+#ifdef CFG_NS16550_TXBUF
+void	serial_flush  (void);
+void	serial_txinfo (void);
+#endif
 
 void	_serial_setbrg (const int);
 void	_serial_putc   (const char, const int);
@@ -116,6 +116,9 @@
 #define CFG_BARGSIZE	CFG_CBSIZE	/* Boot Argument Buffer Size	*/
 #define CFG_LOAD_ADDR	0x00800000	/* Default load address: 8 MB	*/
 
+#define CONFIG_BOOTM_STAGE		/* copy flash images to ${bootm_stage} */
+#define CONFIG_BOOTM_TIMING		/* report bootm phase times	*/
+
 //#define CONFIG_BOOTCOMMAND  	"run nfsboot"
 #define CONFIG_BOOTCOMMAND  	"run bootcmd1"
 #define CONFIG_BOOTARGS			"root=/dev/hda1"
@@ -156,6 +159,7 @@
     "hdboot=run hdload boothd\0"				\
     "flboot=setenv bootargs root=/dev/hda1;bootm ffc00000\0"	\
     "emboot=setenv bootargs root=/dev/ram0;bootm ffc00000\0"	\
+    "bootm_stage=800000\0"						\
 	"nfsargs=setenv bootargs root=/dev/nfs rw nfsroot=${serverip}:${rootpath} "	\
 	"ip=${ipaddr}:${serverip}:${gatewayip}:${netmask}:${hostname}::off\0"	\
 	"bootretry=30\0"							\
@@ -228,6 +232,7 @@
 
 #define CFG_MONITOR_LEN     	0x00040000	/* 256 kB */
 #define CFG_MALLOC_LEN      	(512 << 10) /* Reserve some kB for malloc() */
+#define CFG_MALLOC_NO_CLEAR		/* calloc() clears, not the boot code	*/
 
 #define CFG_MEMTEST_START   	0x00100000	/* memtest works on		*/
 #define CFG_MEMTEST_END	    	0x00800000	/* 1M ... 8M in DRAM	*/
@@ -265,6 +270,14 @@
 #define CFG_GBL_DATA_SIZE		128
 #define CFG_GBL_DATA_OFFSET		(CFG_INIT_RAM_END - CFG_GBL_DATA_SIZE)
 
+/*
+ * Keep the detected RAM size in the page below the initial stack and
+ * trust it on warm resets (see get_ram_size_cached()). The time taken
+ * is reported on the "DRAM:" line.
+ */
+#define CFG_MEMSIZE_CACHE_ADDR		(CFG_INIT_RAM_ADDR - 0x1000)
+#define CONFIG_ADD_RAM_INFO		1
+
 /*----------------------------------------------------------------------
  * Serial configuration
  */
@@ -276,6 +289,7 @@
 #define CFG_NS16550_SERIAL
 
 #define CFG_NS16550_REG_SIZE	1
+#define CFG_NS16550_TXBUF	1024	/* Console output buffer */
 
 #define CFG_NS16550_CLK		get_bus_freq(0)
 
@@ -457,6 +471,7 @@
 #define CONFIG_IDE_RESET				/* no reset for ide supported	*/
 #define CONFIG_IDE_PREINIT				/* check for units				*/
 #define CONFIG_LBA48					/* 48 bit LBA supported			*/
+#define CONFIG_DEFERRED_INIT			/* disk spin-up in boot delay	*/
 
 #if defined(CONFIG_LAN) || defined(CONFIG_HLAN) || defined(CONFIG_HGLAN)
 #define CFG_IDE_MAXBUS			1		/* Scan only 1 IDE bus			*/
@@ -478,6 +493,8 @@
  * Partitions and file system
  */
 #define CONFIG_DOS_PARTITION
+#define CONFIG_BLOCK_CACHE				/* cache small disk reads		*/
+#define CONFIG_PART_CACHE				/* cache parsed partition tables	*/
 
 /*-----------------------------------------------------------------------
  * Internal Definitions
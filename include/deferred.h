@@ -0,0 +1,44 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+#ifndef _DEFERRED_H_
+#define _DEFERRED_H_
+
+/* return values of a step function */
+#define DEFERRED_BUSY	0	/* call again once 'wake' has passed */
+#define DEFERRED_DONE	1	/* finished, remove from the list */
+
+typedef struct deferred_init {
+	const char	*name;
+	int		(*step)(struct deferred_init *di);
+	void		*priv;		/* owner's data */
+	int		state;		/* owner's state, 0 when registered */
+	ulong		start;		/* get_timer() at registration */
+	ulong		wake;		/* don't call step before this time */
+	struct deferred_init *next;
+} deferred_init_t;
+
+void	deferred_init_register (deferred_init_t *di);
+void	deferred_init_sleep (deferred_init_t *di, ulong ms);
+int	deferred_init_poll (void);
+void	deferred_init_wait (deferred_init_t *di);
+
+#endif	/* _DEFERRED_H_ */
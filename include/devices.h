@@ -111,6 +111,7 @@ int	drv_usbtty_init (void);
 #endif
 #ifdef CONFIG_NETCONSOLE
 int	drv_nc_init (void);
+void	nc_flush (void);
 #endif
 #if defined(CFG_CONSOLE_IS_IN_ENV) || defined(CONFIG_SPLASH_SCREEN) || defined(CONFIG_SILENT_CONSOLE)
 device_t *search_device (int flags, char *name);
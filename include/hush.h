@@ -31,5 +31,9 @@
 extern int u_boot_hush_start(void);
 extern int parse_string_outer(char *, int);
 extern int parse_file_outer(void);
+#ifdef CFG_HUSH_RUN_CACHE
+extern int parse_run_cached(char *, char *, int);
+extern void hush_run_cache_forget(char *);
+#endif
 
 #endif
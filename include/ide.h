@@ -49,6 +49,9 @@ typedef ulong lbaint_t;
  */
 
 void  ide_init  (void);
+#ifdef CONFIG_DEFERRED_INIT
+void  ide_init_deferred (void);
+#endif
 ulong ide_read	(int device, lbaint_t blknr, ulong blkcnt, ulong *buffer);
 ulong ide_write (int device, lbaint_t blknr, ulong blkcnt, ulong *buffer);
 
@@ -0,0 +1,43 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+#ifndef _MEMTEST_H_
+#define _MEMTEST_H_
+
+/* number of passes made by memtest_fast() */
+#define MEMTEST_PASSES	5
+
+typedef struct memtest_result {
+	int	pass;		/* pass that failed, or MEMTEST_PASSES */
+	ulong	addr;		/* failing address */
+	ulong	expected;	/* value written there */
+	ulong	actual;		/* value read back */
+	ulong	bytes;		/* bytes covered by each pass */
+	ulong	ms[MEMTEST_PASSES];	/* time taken by each pass */
+	int	burst;		/* cache line bursts were used */
+} memtest_result_t;
+
+extern const char *memtest_pass_name[MEMTEST_PASSES];
+
+int	memtest_fast (ulong start, ulong end, memtest_result_t *res);
+ulong	memtest_rate (ulong bytes, ulong ms);
+
+#endif /* _MEMTEST_H_ */
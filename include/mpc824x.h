@@ -566,6 +566,10 @@ unsigned int mpc824x_mpc107_read32(unsigned int address);
 unsigned int mpc824x_eummbar_read(unsigned int regNum);
 void mpc824x_eummbar_write(unsigned int regNum, unsigned int regVal);
 
+/* memory controller registers returned by mpc824x_mem_config() */
+#define MPC824X_MEM_CONFIG_REGS	13
+int mpc824x_mem_config(unsigned long *regs);
+
 #ifdef CONFIG_PCI
 struct pci_controller;
 void pci_cpm824x_init(struct pci_controller* hose);
@@ -365,6 +365,10 @@ extern void	NetStop(void);
 /* Load failed.	 Start again. */
 extern void	NetStartAgain(void);
 
+/* ARP cache */
+extern void	ArpCacheFlush(void);
+extern void	ArpCachePrint(void);
+
 /* Get size of the ethernet header when we send */
 extern int 	NetEthHdrSize(void);
 
@@ -377,6 +381,8 @@ extern void	NetSetIP(volatile uchar *, IPaddr_t, int, int, int);
 /* Checksum */
 extern int	NetCksumOk(uchar *, int);	/* Return true if cksum OK	*/
 extern uint	NetCksum(uchar *, int);		/* Calculate the checksum	*/
+extern uint	NetCksumBytes(uchar *, int);	/* ... over a byte count	*/
+extern ushort	NetCksumUpdate(ushort, ushort, ushort);	/* Incremental update	*/
 
 /* Set callbacks */
 extern void	NetSetHandler(rxhand_f *);	/* Set RX packet handler	*/
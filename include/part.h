@@ -89,6 +89,22 @@ void print_part (block_dev_desc_t *dev_desc);
 void  init_part (block_dev_desc_t *dev_desc);
 void dev_print(block_dev_desc_t *dev_desc);
 
+/* Called for each partition found while walking a partition table */
+typedef int (part_found_t)(void *arg, int part, disk_partition_t *info);
+
+#ifdef CONFIG_PART_CACHE
+void part_cache_invalidate (block_dev_desc_t *dev_desc);
+void part_cache_list (void);
+#endif
+
+#ifdef CONFIG_BLOCK_CACHE
+/* disk/blkcache.c */
+void blkcache_register (block_dev_desc_t *dev_desc);
+void blkcache_invalidate (block_dev_desc_t *dev_desc);
+void blkcache_flush (void);
+void blkcache_stats (void);
+#endif
+
 
 #ifdef CONFIG_MAC_PARTITION
 /* disk/part_mac.c */
@@ -102,6 +118,7 @@ int   test_part_mac (block_dev_desc_t *dev_desc);
 int get_partition_info_dos (block_dev_desc_t * dev_desc, int part, disk_partition_t *info);
 void print_part_dos (block_dev_desc_t *dev_desc);
 int   test_part_dos (block_dev_desc_t *dev_desc);
+int   walk_part_dos (block_dev_desc_t *dev_desc, part_found_t *found, void *arg);
 #endif
 
 #ifdef CONFIG_ISO_PARTITION
@@ -0,0 +1,88 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+#ifndef _REGION_H_
+#define _REGION_H_
+
+/*
+ * Regions hand out memory by bumping a pointer through one malloc()ed
+ * block; everything allocated after a mark is given back at once by
+ * releasing the mark. Pools hand out objects of one size, carved from
+ * malloc()ed blocks and recycled through a free list.
+ */
+
+typedef struct region {
+	const char	*name;
+	ulong		size;		/* bytes in the backing block */
+	char		*base;		/* backing block, malloc()ed on first use */
+	ulong		used;
+	ulong		peak;
+	ulong		allocs;		/* successful region_alloc() calls */
+	ulong		fails;		/* calls which did not fit */
+	struct region	*next;		/* all regions, for "mstat" */
+} region_t;
+
+typedef struct pool {
+	const char	*name;
+	ulong		objsize;
+	ulong		perblock;	/* objects per malloc()ed block */
+	void		*free;		/* free objects, linked through themselves */
+	void		*blocks;	/* blocks, linked through their first word */
+	ulong		nblocks;
+	ulong		inuse;
+	ulong		peak;
+	ulong		allocs;		/* successful pool_alloc() calls */
+	struct pool	*next;		/* all pools, for "mstat" */
+} pool_t;
+
+#define REGION_INIT(name, size)	{ name, size }
+
+void	region_init (region_t *r, const char *name, ulong size);
+void	*region_alloc (region_t *r, ulong size);
+void	region_destroy (region_t *r);
+
+/* A mark is the number of bytes in use when it was taken */
+static inline ulong region_mark (region_t *r)
+{
+	return r->used;
+}
+
+static inline void region_release (region_t *r, ulong mark)
+{
+	if (mark < r->used)
+		r->used = mark;
+}
+
+void	pool_init (pool_t *p, const char *name, ulong objsize, ulong perblock);
+void	*pool_alloc (pool_t *p);
+void	pool_free (pool_t *p, void *obj);
+void	pool_destroy (pool_t *p);
+
+/* Short lived buffers of a single command; CFG_SCRATCH_LEN bytes */
+extern region_t scratch_region;
+
+#define scratch_alloc(size)	region_alloc (&scratch_region, size)
+#define scratch_mark()		region_mark (&scratch_region)
+#define scratch_release(mark)	region_release (&scratch_region, mark)
+
+void	region_info (void);
+
+#endif /* _REGION_H_ */
@@ -376,6 +376,9 @@ void panic(const char *fmt, ...)
 	vprintf(fmt, args);
 	putc('\n');
 	va_end(args);
+#ifdef CFG_NS16550_TXBUF
+	serial_flush ();
+#endif
 #if defined (CONFIG_PANIC_HANG)
 	hang();
 #else
@@ -65,9 +65,11 @@ static void mem_malloc_init (void)
 	mem_malloc_start = CFG_MALLOC_BASE;
 	mem_malloc_end = mem_malloc_start + CFG_MALLOC_LEN;
 	mem_malloc_brk = mem_malloc_start;
+#ifndef CFG_MALLOC_NO_CLEAR
 	memset ((void *) mem_malloc_start,
 		0,
 		mem_malloc_end - mem_malloc_start);
+#endif
 }
 
 void *sbrk (ptrdiff_t increment)
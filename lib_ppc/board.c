@@ -128,14 +128,26 @@ static	ulong	mem_malloc_brk	 = 0;
 static void mem_malloc_init (void)
 {
 	ulong dest_addr = CFG_MONITOR_BASE + gd->reloc_off;
+#if !defined(CFG_MALLOC_NO_CLEAR) && defined(DEBUG)
+	unsigned long long ticks;
+#endif
 
 	mem_malloc_end = dest_addr;
 	mem_malloc_start = dest_addr - TOTAL_MALLOC_LEN;
 	mem_malloc_brk = mem_malloc_start;
 
+#ifndef CFG_MALLOC_NO_CLEAR
+#ifdef DEBUG
+	ticks = get_ticks ();
+#endif
 	memset ((void *) mem_malloc_start,
 		0,
 		mem_malloc_end - mem_malloc_start);
+#ifdef DEBUG
+	debug ("Cleared malloc() area in %lu us\n",
+	       (ulong)(get_ticks () - ticks) / (get_tbclk () / 1000000));
+#endif
+#endif
 }
 
 void *sbrk (ptrdiff_t increment)
@@ -1021,7 +1033,11 @@ void board_init_r (gd_t *id, ulong dest_addr)
 # else
 	puts ("IDE:   ");
 #endif
+#ifdef CONFIG_DEFERRED_INIT
+	ide_init_deferred ();
+#else
 	ide_init ();
+#endif
 #endif /* CFG_CMD_IDE */
 
 #ifdef CONFIG_LAST_STAGE_INIT
@@ -1093,6 +1109,9 @@ void board_init_r (gd_t *id, ulong dest_addr)
 void hang (void)
 {
 	puts ("### ERROR ### Please RESET the board ###\n");
+#ifdef CFG_NS16550_TXBUF
+	serial_flush ();
+#endif
 #ifdef CONFIG_SHOW_BOOT_PROGRESS
 	show_boot_progress(-30);
 #endif
@@ -47,6 +47,10 @@
 #define CONFIG_DHCP_MIN_EXT_LEN 64
 #endif
 
+#ifndef CFG_DHCP_REBOOT_TIMEOUT		/* Seconds to wait for the old lease	*/
+#define CFG_DHCP_REBOOT_TIMEOUT	2
+#endif
+
 ulong		BootpID;
 int		BootpTry;
 #ifdef CONFIG_BOOTP_RANDOM_DELAY
@@ -425,6 +429,12 @@ static int DhcpExtended (u8 * e, int message_type, IPaddr_t ServerID, IPaddr_t R
 		*e++ = tmp >> 8;
 		*e++ = tmp & 0xff;
 	}
+#if (CONFIG_BOOTP_MASK & CONFIG_BOOTP_RAPID_COMMIT)
+	if (message_type == DHCP_DISCOVER) {
+		*e++ = 80;	/* Rapid Commit (RFC 4039) */
+		*e++ = 0;
+	}
+#endif
 #if (CONFIG_BOOTP_MASK & CONFIG_BOOTP_SEND_HOSTNAME)
 	if ((hostname = getenv ("hostname"))) {
 		int hostnamelen = strlen (hostname);
@@ -563,6 +573,21 @@ static int BootpExtended (u8 * e)
 }
 #endif	/* CFG_CMD_DHCP */
 
+/*
+ *	Bootp ID is the lower 4 bytes of our ethernet address
+ *	plus the current time in HZ.
+ */
+static void BootpSetID (Bootp_t *bp)
+{
+	BootpID = ((ulong)NetOurEther[2] << 24)
+		| ((ulong)NetOurEther[3] << 16)
+		| ((ulong)NetOurEther[4] << 8)
+		| (ulong)NetOurEther[5];
+	BootpID += get_timer(0);
+	BootpID	 = htonl(BootpID);
+	NetCopyLong(&bp->bp_id, &BootpID);
+}
+
 void
 BootpRequest (void)
 {
@@ -684,17 +709,7 @@ BootpRequest (void)
 	ext_len = BootpExtended((u8 *)bp->bp_vend);
 #endif	/* CFG_CMD_DHCP */
 
-	/*
-	 *	Bootp ID is the lower 4 bytes of our ethernet address
-	 *	plus the current time in HZ.
-	 */
-	BootpID = ((ulong)NetOurEther[2] << 24)
-		| ((ulong)NetOurEther[3] << 16)
-		| ((ulong)NetOurEther[4] << 8)
-		| (ulong)NetOurEther[5];
-	BootpID += get_timer(0);
-	BootpID	 = htonl(BootpID);
-	NetCopyLong(&bp->bp_id, &BootpID);
+	BootpSetID(bp);
 
 	/*
 	 * Calculate proper packet lengths taking into account the
@@ -772,6 +787,8 @@ static void DhcpOptionsProcess (uchar * popt)
 			break;
 		case 59:	/* Ignore Rebinding Time Option */
 			break;
+		case 80:	/* Ignore Rapid Commit Option */
+			break;
 		default:
 #if (CONFIG_BOOTP_MASK & CONFIG_BOOTP_VENDOREX)
 			if (dhcp_vendorex_proc (popt))
@@ -846,6 +863,55 @@ static void DhcpSendRequestPkt(Bootp_t *bp_offer)
 	NetSendPacket(NetTxPacket, pktlen);
 }
 
+/*
+ *	Got a DHCPACK: take over the lease and continue with the download
+ */
+static void DhcpBound(Bootp_t *bp)
+{
+	char *s;
+
+	if (NetReadLong((ulong*)&bp->bp_vend[0]) == htonl(BOOTP_VENDOR_MAGIC))
+		DhcpOptionsProcess((u8 *)&bp->bp_vend[4]);
+	BootpCopyNetParams(bp); /* Store net params from reply */
+	dhcp_state = BOUND;
+	puts ("DHCP client bound to address ");
+	print_IPaddr(NetOurIP);
+	putc ('\n');
+
+#if (CONFIG_BOOTP_MASK & CONFIG_BOOTP_REBOOT)
+	{
+		char tmp[22];
+
+		/* remember the lease for DHCP INIT-REBOOT next time */
+		ip_to_string (NetDHCPServerIP, tmp);
+		setenv ("dhcpserverip", tmp);
+		sprintf (tmp, "%lu", ntohl(dhcp_leasetime));
+		setenv ("dhcpleasetime", tmp);
+	}
+#endif
+
+	/* Obey the 'autoload' setting */
+	if ((s = getenv("autoload")) != NULL) {
+		if (*s == 'n') {
+			/*
+			 * Just use BOOTP to configure system;
+			 * Do not use TFTP to load the bootfile.
+			 */
+			NetState = NETLOOP_SUCCESS;
+			return;
+#if (CONFIG_COMMANDS & CFG_CMD_NFS)
+		} else if (strcmp(s, "NFS") == 0) {
+			/*
+			 * Use NFS to load the bootfile.
+			 */
+			NfsStart();
+			return;
+#endif
+		}
+	}
+	TftpStart();
+}
+
 /*
  *	Handle DHCP received packets.
  */
@@ -878,6 +944,14 @@ DhcpHandler(uchar * pkt, unsigned dest, unsigned src, unsigned len)
 			    strlen(CFG_BOOTFILE_PREFIX)) == 0 ) {
 #endif	/* CFG_BOOTFILE_PREFIX */
 
+#if (CONFIG_BOOTP_MASK & CONFIG_BOOTP_RAPID_COMMIT)
+			/* RFC 4039: server committed the lease to our DISCOVER */
+			if (DhcpMessageType((u8 *)bp->bp_vend) == DHCP_ACK) {
+				debug ("DHCP: rapid commit\n");
+				DhcpBound(bp);
+				return;
+			}
+#endif
 			debug ("TRANSITIONING TO REQUESTING STATE\n");
 			dhcp_state = REQUESTING;
 
@@ -898,39 +972,27 @@ DhcpHandler(uchar * pkt, unsigned dest, unsigned src, unsigned len)
 		debug ("DHCP State: REQUESTING\n");
 
 		if ( DhcpMessageType((u8 *)bp->bp_vend) == DHCP_ACK ) {
-			char *s;
+			DhcpBound(bp);
+			return;
+		}
+		break;
+#if (CONFIG_BOOTP_MASK & CONFIG_BOOTP_REBOOT)
+	case REBOOTING:
+		debug ("DHCP State: REBOOTING\n");
 
-			if (NetReadLong((ulong*)&bp->bp_vend[0]) == htonl(BOOTP_VENDOR_MAGIC))
-				DhcpOptionsProcess((u8 *)&bp->bp_vend[4]);
-			BootpCopyNetParams(bp); /* Store net params from reply */
-			dhcp_state = BOUND;
-			puts ("DHCP client bound to address ");
-			print_IPaddr(NetOurIP);
-			putc ('\n');
-
-			/* Obey the 'autoload' setting */
-			if ((s = getenv("autoload")) != NULL) {
-				if (*s == 'n') {
-					/*
-					 * Just use BOOTP to configure system;
-					 * Do not use TFTP to load the bootfile.
-					 */
-					NetState = NETLOOP_SUCCESS;
-					return;
-#if (CONFIG_COMMANDS & CFG_CMD_NFS)
-				} else if (strcmp(s, "NFS") == 0) {
-					/*
-					 * Use NFS to load the bootfile.
-					 */
-					NfsStart();
-					return;
-#endif
-				}
-			}
-			TftpStart();
+		switch (DhcpMessageType((u8 *)bp->bp_vend)) {
+		case DHCP_ACK:
+			DhcpBound(bp);
+			return;
+		case DHCP_NAK:
+			puts ("DHCP: previous lease declined\n");
+			setenv ("dhcpserverip", NULL);
+			setenv ("dhcpleasetime", NULL);
+			BootpRequest();
 			return;
 		}
 		break;
+#endif
 	default:
 		puts ("DHCP: INVALID STATE\n");
 		break;
@@ -938,8 +1000,71 @@ DhcpHandler(uchar * pkt, unsigned dest, unsigned src, unsigned len)
 
 }
 
+#if (CONFIG_BOOTP_MASK & CONFIG_BOOTP_REBOOT)
+/*
+ *	INIT-REBOOT (RFC 2131, 3.2): try to get the address of the previous
+ *	lease confirmed with a single broadcast DHCPREQUEST before going
+ *	through DISCOVER/OFFER.
+ */
+static void DhcpRebootTimeout(void)
+{
+	puts ("\nNo answer for previous lease, ");
+	BootpRequest();
+}
+
+static void DhcpSendRebootPkt(IPaddr_t RequestedIP)
+{
+	volatile uchar *pkt, *iphdr;
+	Bootp_t *bp;
+	int pktlen, iplen, extlen;
+
+	puts ("DHCP request for ");
+	print_IPaddr (RequestedIP);
+	putc ('\n');
+
+	pkt = NetTxPacket;
+	memset ((void*)pkt, 0, PKTSIZE);
+
+	pkt += NetSetEther(pkt, NetBcastAddr, PROT_IP);
+
+	iphdr = pkt;		/* We'll need this later to set proper pkt size */
+	pkt += IP_HDR_SIZE;
+
+	bp = (Bootp_t *)pkt;
+	bp->bp_op = OP_BOOTREQUEST;
+	bp->bp_htype = HWT_ETHER;
+	bp->bp_hlen = HWL_ETHER;
+	bp->bp_hops = 0;
+	bp->bp_secs = htons(get_timer(0) / CFG_HZ);
+	memcpy (bp->bp_chaddr, NetOurEther, 6);
+	BootpSetID(bp);
+
+	/* ciaddr stays 0, no server identifier, requested IP set */
+	extlen = DhcpExtended((u8 *)bp->bp_vend, DHCP_REQUEST, 0, RequestedIP);
+
+	pktlen = BOOTP_SIZE - sizeof(bp->bp_vend) + extlen;
+	iplen = BOOTP_HDR_SIZE - sizeof(bp->bp_vend) + extlen;
+	NetSetIP(iphdr, 0xFFFFFFFFL, PORT_BOOTPS, PORT_BOOTPC, iplen);
+
+	debug ("Transmitting DHCPREQUEST (INIT-REBOOT): len = %d\n", pktlen);
+	NetSendPacket(NetTxPacket, pktlen);
+}
+#endif	/* CONFIG_BOOTP_REBOOT */
+
 void DhcpRequest(void)
 {
+#if (CONFIG_BOOTP_MASK & CONFIG_BOOTP_REBOOT)
+	IPaddr_t PrevIP = getenv_IPaddr ("ipaddr");
+
+	/* Only if the address came from a DHCP server last time */
+	if (PrevIP != 0 && getenv ("dhcpserverip") != NULL) {
+		dhcp_state = REBOOTING;
+		NetSetTimeout(CFG_DHCP_REBOOT_TIMEOUT * CFG_HZ, DhcpRebootTimeout);
+		NetSetHandler(DhcpHandler);
+		DhcpSendRebootPkt(PrevIP);
+		return;
+	}
+#endif
 	BootpRequest();
 }
 #endif	/* CFG_CMD_DHCP */
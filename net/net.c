@@ -99,6 +99,16 @@
 # define ARP_TIMEOUT_COUNT  (CONFIG_NET_RETRY_COUNT)
 #endif
 
+#ifndef CFG_ARP_CACHE_SIZE
+# define CFG_ARP_CACHE_SIZE	4		/* # of cached ARP entries	   */
+#endif
+#ifndef CFG_ARP_CACHE_AGE
+# define CFG_ARP_CACHE_AGE	300		/* Seconds an entry is used	   */
+#endif
+#ifndef CFG_ARP_PENDING
+# define CFG_ARP_PENDING	2		/* # of packets waiting for ARP	   */
+#endif
+
 #if 0
 #define ET_DEBUG
 #endif
@@ -182,23 +192,132 @@ static int net_check_prereq (proto_t protocol);
 
 /**********************************************************************/
 
-IPaddr_t	NetArpWaitPacketIP;
-IPaddr_t	NetArpWaitReplyIP;
-uchar	       *NetArpWaitPacketMAC;	/* MAC address of waiting packet's destination	*/
-uchar	       *NetArpWaitTxPacket;	/* THE transmit packet			*/
-int		NetArpWaitTxPacketSize;
-uchar 		NetArpWaitPacketBuf[PKTSIZE_ALIGN + PKTALIGN];
-ulong		NetArpWaitTimerStart;
-int		NetArpWaitTry;
+/*
+ * ARP cache: resolved addresses are kept across NetLoop() invocations,
+ * so "dhcp; tftp; tftp" asks for the server's ethernet address once.
+ * Entries expire after CFG_ARP_CACHE_AGE seconds and are dropped when
+ * a transfer has to be restarted.
+ *
+ * Packets to hosts which are not in the cache are parked in one of
+ * CFG_ARP_PENDING slots until the reply arrives.
+ */
+typedef struct {
+	IPaddr_t	ip;
+	uchar		ether[6];
+	ulong		stamp;		/* get_timer() when learned	*/
+} ArpEntry_t;
+
+typedef struct {
+	IPaddr_t	ip;		/* destination of the packet	*/
+	IPaddr_t	reply_ip;	/* next hop: ip or gateway	*/
+	uchar		*mac;		/* caller's copy of the address	*/
+	uchar		*pkt;		/* the waiting packet		*/
+	int		size;
+	ulong		start;
+	int		try;
+	uchar		buf[PKTSIZE_ALIGN + PKTALIGN];
+} ArpWait_t;
+
+static ArpEntry_t	ArpCache[CFG_ARP_CACHE_SIZE];
+static ArpWait_t	ArpWait[CFG_ARP_PENDING];
+
+/* Address to ask for when sending to 'ip' */
+static IPaddr_t ArpNextHop (IPaddr_t ip)
+{
+	if ((ip & NetOurSubnetMask) != (NetOurIP & NetOurSubnetMask)) {
+		if (NetOurGatewayIP == 0) {
+			puts ("## Warning: gatewayip needed but not set\n");
+		}
+		return NetOurGatewayIP;
+	}
+	return ip;
+}
+
+static ArpEntry_t *ArpCacheFind (IPaddr_t ip)
+{
+	int i;
+
+	for (i = 0; i < CFG_ARP_CACHE_SIZE; i++) {
+		if (ArpCache[i].ip == ip && ip != 0)
+			return &ArpCache[i];
+	}
+	return NULL;
+}
+
+static int ArpCacheLookup (IPaddr_t ip, uchar *ether)
+{
+	ArpEntry_t *e = ArpCacheFind (ip);
+
+	if (e == NULL)
+		return 0;
+	if (get_timer (e->stamp) > CFG_ARP_CACHE_AGE * CFG_HZ) {
+		e->ip = 0;
+		return 0;
+	}
+	memcpy (ether, e->ether, 6);
+	return 1;
+}
+
+/*
+ * Remember 'ether' for 'ip'. Unless 'create' is set, only entries
+ * which are already in the cache are refreshed.
+ */
+static void ArpCacheUpdate (IPaddr_t ip, uchar *ether, int create)
+{
+	ArpEntry_t *e = ArpCacheFind (ip);
+	int i;
+
+	if (ip == 0 || ip == 0xFFFFFFFF || (ether[0] & 1))
+		return;
+	if (e == NULL) {
+		if (!create)
+			return;
+		/* a free slot, or else the oldest entry */
+		e = &ArpCache[0];
+		for (i = 1; i < CFG_ARP_CACHE_SIZE && e->ip != 0; i++) {
+			if (ArpCache[i].ip == 0 ||
+			    (long)(ArpCache[i].stamp - e->stamp) < 0)
+				e = &ArpCache[i];
+		}
+		e->ip = ip;
+	}
+	memcpy (e->ether, ether, 6);
+	e->stamp = get_timer (0);
+}
+
+void ArpCacheFlush (void)
+{
+	memset (ArpCache, 0, sizeof (ArpCache));
+}
 
-void ArpRequest (void)
+void ArpCachePrint (void)
+{
+	char tmp[22];
+	int i;
+
+	for (i = 0; i < CFG_ARP_CACHE_SIZE; i++) {
+		ArpEntry_t *e = &ArpCache[i];
+		ulong age;
+
+		if (e->ip == 0)
+			continue;
+		age = get_timer (e->stamp) / CFG_HZ;
+		ip_to_string (e->ip, tmp);
+		printf ("%-15s  %02x:%02x:%02x:%02x:%02x:%02x  %5lu s%s\n",
+			tmp, e->ether[0], e->ether[1], e->ether[2],
+			e->ether[3], e->ether[4], e->ether[5], age,
+			age > CFG_ARP_CACHE_AGE ? " (expired)" : "");
+	}
+}
+
+void ArpRequest (IPaddr_t ip)
 {
 	int i;
 	volatile uchar *pkt;
 	ARP_t *arp;
 
 #ifdef ET_DEBUG
-	printf ("ARP broadcast %d\n", NetArpWaitTry);
+	printf ("ARP broadcast for %08lx\n", ip);
 #endif
 	pkt = NetTxPacket;
 
@@ -218,41 +337,110 @@ void ArpRequest (void)
 		arp->ar_data[i] = 0;				/* dest ET addr = 0     */
 	}
 
-	if ((NetArpWaitPacketIP & NetOurSubnetMask) !=
-	    (NetOurIP & NetOurSubnetMask)) {
-		if (NetOurGatewayIP == 0) {
-			puts ("## Warning: gatewayip needed but not set\n");
+	NetWriteIP ((uchar *) & arp->ar_data[16], ip);
+	(void) eth_send (NetTxPacket, (pkt - NetTxPacket) + ARP_HDR_SIZE);
+}
+
+/*
+ * Transmit the IP packet in NetTxPacket ('size' bytes, ethernet header
+ * included) to 'dest'. If the ethernet address of the next hop is
+ * neither in 'ether' nor in the cache, the packet is parked and an ARP
+ * request is sent; 'ether' receives the address when the reply comes.
+ * Returns 0 if the packet was transmitted, 1 if it waits for ARP.
+ */
+static int NetSendIPPacket (uchar *ether, IPaddr_t dest, int size)
+{
+	ArpWait_t *w;
+	int i;
+
+	if (memcmp (ether, NetEtherNullAddr, 6) == 0 &&
+	    !ArpCacheLookup (ArpNextHop (dest), ether)) {
+#ifdef ET_DEBUG
+		printf("sending ARP for %08lx\n", dest);
+#endif
+		/* replace a packet to the same host, else take a free slot */
+		w = &ArpWait[0];
+		for (i = 0; i < CFG_ARP_PENDING; i++) {
+			if (ArpWait[i].ip == dest) {
+				w = &ArpWait[i];
+				break;
+			}
+			if (ArpWait[i].ip == 0 && w->ip != 0)
+				w = &ArpWait[i];
 		}
-		NetArpWaitReplyIP = NetOurGatewayIP;
-	} else {
-		NetArpWaitReplyIP = NetArpWaitPacketIP;
+
+		w->ip = dest;
+		w->reply_ip = ArpNextHop (dest);
+		w->mac = ether;
+		w->pkt = &w->buf[0] + (PKTALIGN - 1);
+		w->pkt -= (ulong)w->pkt % PKTALIGN;
+		w->size = size;
+		memcpy (w->pkt, (uchar *)NetTxPacket, size);
+
+		/* and do the ARP request */
+		w->try = 1;
+		w->start = get_timer(0);
+		ArpRequest (w->reply_ip);
+		return 1;	/* waiting */
 	}
 
-	NetWriteIP ((uchar *) & arp->ar_data[16], NetArpWaitReplyIP);
-	(void) eth_send (NetTxPacket, (pkt - NetTxPacket) + ARP_HDR_SIZE);
+	memcpy (((Ethernet_t *)NetTxPacket)->et_dest, ether, 6);
+	(void) eth_send (NetTxPacket, size);
+	return 0;	/* transmitted */
 }
 
-void ArpTimeoutCheck(void)
+/* Send the packets which waited for the ethernet address of 'ip' */
+static void ArpResolved (IPaddr_t ip, uchar *ether)
 {
-	ulong t;
+	int i;
 
-	if (!NetArpWaitPacketIP)
-		return;
+	for (i = 0; i < CFG_ARP_PENDING; i++) {
+		ArpWait_t *w = &ArpWait[i];
 
-	t = get_timer(0);
+		if (w->ip == 0 || w->reply_ip != ip)
+			continue;
+#ifdef ET_DEBUG
+		puts ("ARP reply IP matches original pkt IP\n");
+#endif
+		/* save address for later use */
+		memcpy (w->mac, ether, 6);
 
-	/* check for arp timeout */
-	if ((t - NetArpWaitTimerStart) > ARP_TIMEOUT * CFG_HZ) {
-		NetArpWaitTry++;
+#ifdef CONFIG_NETCONSOLE
+		if (packetHandler)
+			(*packetHandler)(0,0,0,0);
+		else
+			printf("ARP: NULL packetHandler\n");
+#endif
+		/* modify header, and transmit it */
+		memcpy (((Ethernet_t *)w->pkt)->et_dest, ether, 6);
+		(void) eth_send (w->pkt, w->size);
+
+		/* no arp request pending now */
+		w->ip = 0;
+	}
+}
+
+void ArpTimeoutCheck(void)
+{
+	ulong t = get_timer(0);
+	int i;
+
+	for (i = 0; i < CFG_ARP_PENDING; i++) {
+		ArpWait_t *w = &ArpWait[i];
 
-		if (NetArpWaitTry >= ARP_TIMEOUT_COUNT) {
+		/* check for arp timeout */
+		if (w->ip == 0 || (t - w->start) <= ARP_TIMEOUT * CFG_HZ)
+			continue;
+
+		w->try++;
+		if (w->try >= ARP_TIMEOUT_COUNT) {
 			puts ("\nARP Retry count exceeded; starting again\n");
-			NetArpWaitTry = 0;
+			w->ip = 0;
 			NetStartAgain();
-		} else {
-			NetArpWaitTimerStart = t;
-			ArpRequest();
+			return;
 		}
+		w->start = t;
+		ArpRequest (w->reply_ip);
 	}
 }
 
@@ -274,11 +462,7 @@ NetLoop(proto_t protocol)
 #endif
 
 	/* XXX problem with bss workaround */
-	NetArpWaitPacketMAC = NULL;
-	NetArpWaitTxPacket = NULL;
-	NetArpWaitPacketIP = 0;
-	NetArpWaitReplyIP = 0;
-	NetArpWaitTxPacket = NULL;
+	memset (ArpWait, 0, sizeof (ArpWait));
 	NetTxPacket = NULL;
 
 	if (!NetTxPacket) {
@@ -293,12 +477,6 @@ NetLoop(proto_t protocol)
 		}
 	}
 
-	if (!NetArpWaitTxPacket) {
-		NetArpWaitTxPacket = &NetArpWaitPacketBuf[0] + (PKTALIGN - 1);
-		NetArpWaitTxPacket -= (ulong)NetArpWaitTxPacket % PKTALIGN;
-		NetArpWaitTxPacketSize = 0;
-	}
-
 	eth_halt();
 #ifdef CONFIG_NET_MULTI
 	eth_set_current();
@@ -576,6 +754,9 @@ void NetStartAgain (void)
 	char *nretry;
 	int noretry = 0, once = 0;
 
+	/* a stale ARP entry may be the reason we are here */
+	ArpCacheFlush ();
+
 	if ((nretry = getenv ("netretry")) != NULL) {
 		noretry = (strcmp (nretry, "no") == 0);
 		once = (strcmp (nretry, "once") == 0);
@@ -655,42 +836,12 @@ NetSendUDPPacket(uchar *ether, IPaddr_t dest, int dport, int sport, int len)
 	if (dest == 0xFFFFFFFF)
 		ether = NetBcastAddr;
 
-	/* if MAC address was not discovered yet, save the packet and do an ARP request */
-	if (memcmp(ether, NetEtherNullAddr, 6) == 0) {
-
-#ifdef ET_DEBUG
-		printf("sending ARP for %08lx\n", dest);
-#endif
-		NetArpWaitPacketIP = dest;
-		NetArpWaitPacketMAC = ether;
-
-		pkt = NetArpWaitTxPacket;
-		pkt += NetSetEther (pkt, NetArpWaitPacketMAC, PROT_IP);
-
-		NetSetIP (pkt, dest, dport, sport, len);
-		memcpy(pkt + IP_HDR_SIZE, (uchar *)NetTxPacket + (pkt - (uchar *)NetArpWaitTxPacket) + IP_HDR_SIZE, len);
-
-		/* size of the waiting packet */
-		NetArpWaitTxPacketSize = (pkt - NetArpWaitTxPacket) + IP_HDR_SIZE + len;
-
-		/* and do the ARP request */
-		NetArpWaitTry = 1;
-		NetArpWaitTimerStart = get_timer(0);
-		ArpRequest();
-		return 1;	/* waiting */
-	}
-
-#ifdef ET_DEBUG
-	printf("sending UDP to %08lx/%02x:%02x:%02x:%02x:%02x:%02x\n",
-		dest, ether[0], ether[1], ether[2], ether[3], ether[4], ether[5]);
-#endif
-
 	pkt = (uchar *)NetTxPacket;
 	pkt += NetSetEther (pkt, ether, PROT_IP);
 	NetSetIP (pkt, dest, dport, sport, len);
-	(void) eth_send(NetTxPacket, (pkt - NetTxPacket) + IP_HDR_SIZE + len);
 
-	return 0;	/* transmitted */
+	/* if MAC address was not discovered yet, the packet waits for ARP */
+	return NetSendIPPacket (ether, dest, (pkt - NetTxPacket) + IP_HDR_SIZE + len);
 }
 
 #if (CONFIG_COMMANDS & CFG_CMD_PING)
@@ -703,18 +854,9 @@ int PingSend(void)
 	volatile ushort *s;
 	uchar *pkt;
 
-	/* XXX always send arp request */
-
 	memcpy(mac, NetEtherNullAddr, 6);
 
-#ifdef ET_DEBUG
-	printf("sending ARP for %08lx\n", NetPingIP);
-#endif
-
-	NetArpWaitPacketIP = NetPingIP;
-	NetArpWaitPacketMAC = mac;
-
-	pkt = NetArpWaitTxPacket;
+	pkt = (uchar *)NetTxPacket;
 	pkt += NetSetEther(pkt, mac, PROT_IP);
 
 	ip = (volatile IP_t *)pkt;
@@ -741,14 +883,8 @@ int PingSend(void)
 	s[3] = htons(PingSeqNo++);	/* sequence number */
 	s[1] = ~NetCksum((uchar *)s, 8/2);
 
-	/* size of the waiting packet */
-	NetArpWaitTxPacketSize = (pkt - NetArpWaitTxPacket) + IP_HDR_SIZE_NO_UDP + 8;
-
-	/* and do the ARP request */
-	NetArpWaitTry = 1;
-	NetArpWaitTimerStart = get_timer(0);
-	ArpRequest();
-	return 1;	/* waiting */
+	return NetSendIPPacket(mac, NetPingIP,
+			       (pkt - NetTxPacket) + IP_HDR_SIZE_NO_UDP + 8);
 }
 
 static void
@@ -1248,6 +1384,8 @@ NetReceive(volatile uchar * inpkt, int len)
 		 *   for the TFTP server's or the gateway's ethernet
 		 *   address; so if we receive such a packet, we set
 		 *   the server ethernet address
+		 * The sender of either goes into the ARP cache, and
+		 * packets waiting for its address are sent.
 		 */
 #ifdef ET_DEBUG
 		puts ("Got ARP\n");
@@ -1274,10 +1412,18 @@ NetReceive(volatile uchar * inpkt, int len)
 			return;
 		}
 
+		/* refresh the sender, if we know it already */
+		tmp = NetReadIP(&arp->ar_data[6]);
+		ArpCacheUpdate(tmp, &arp->ar_data[0], 0);
+
 		if (NetReadIP(&arp->ar_data[16]) != NetOurIP) {
 			return;
 		}
 
+		/* the sender will talk to us, so remember it */
+		ArpCacheUpdate(tmp, &arp->ar_data[0], 1);
+		ArpResolved(tmp, &arp->ar_data[0]);
+
 		switch (ntohs(arp->ar_op)) {
 		case ARPOP_REQUEST:		/* reply with our IP address	*/
 #ifdef ET_DEBUG
@@ -1294,42 +1440,13 @@ NetReceive(volatile uchar * inpkt, int len)
 			return;
 
 		case ARPOP_REPLY:		/* arp reply */
-			/* are we waiting for a reply */
-			if (!NetArpWaitPacketIP || !NetArpWaitPacketMAC)
-				break;
 #ifdef ET_DEBUG
 			printf("Got ARP REPLY, set server/gtwy eth addr (%02x:%02x:%02x:%02x:%02x:%02x)\n",
 				arp->ar_data[0], arp->ar_data[1],
 				arp->ar_data[2], arp->ar_data[3],
 				arp->ar_data[4], arp->ar_data[5]);
 #endif
-
-			tmp = NetReadIP(&arp->ar_data[6]);
-
-			/* matched waiting packet's address */
-			if (tmp == NetArpWaitReplyIP) {
-#ifdef ET_DEBUG
-				puts ("ARP reply IP matches original pkt IP\n");
-#endif
-				/* save address for later use */
-				memcpy(NetArpWaitPacketMAC, &arp->ar_data[0], 6);
-
-#ifdef CONFIG_NETCONSOLE
-				if (packetHandler)
-					(*packetHandler)(0,0,0,0);
-				else
-					printf("ARP: NULL packetHandler\n");
-#endif
-				/* modify header, and transmit it */
-				memcpy(((Ethernet_t *)NetArpWaitTxPacket)->et_dest, NetArpWaitPacketMAC, 6);
-				(void) eth_send(NetArpWaitTxPacket, NetArpWaitTxPacketSize);
-
-				/* no arp request pending now */
-				NetArpWaitPacketIP = 0;
-				NetArpWaitTxPacketSize = 0;
-				NetArpWaitPacketMAC = NULL;
-
-			}
+			/* already learned and sent above */
 			return;
 		default:
 #ifdef ET_DEBUG
@@ -1398,6 +1515,11 @@ NetReceive(volatile uchar * inpkt, int len)
 		if (NetOurIP && tmp != NetOurIP && tmp != 0xFFFFFFFF) {
 			return;
 		}
+		/* learn the ethernet address of senders on our network */
+		tmp = NetReadIP(&ip->ip_src);
+		if (NetOurIP && tmp != NetOurIP &&
+		    ((tmp ^ NetOurIP) & NetOurSubnetMask) == 0)
+			ArpCacheUpdate(tmp, et->et_src, 1);
 		/*
 		 * watch for ICMP host redirects
 		 *
@@ -1585,18 +1707,93 @@ NetCksumOk(uchar * ptr, int len)
 }
 
 
+/*
+ * Ones-complement sum of 'len' bytes, folded to 16 bits. Like the sum
+ * of 16-bit loads it is in memory byte order, so it can be stored back
+ * into a header as it is, on either endianness.
+ *
+ * The data is summed in 32-bit words into a 64-bit accumulator (an
+ * add/add-with-carry pair on 32-bit CPUs) which collects the carries
+ * and is folded once at the end. An odd start address is handled by
+ * summing the bytes shifted by one and swapping the result.
+ */
+unsigned
+NetCksumBytes(uchar * ptr, int len)
+{
+	u64	xsum = 0;
+	u32	w;
+	ushort	t;
+	int	odd = (ulong)ptr & 1;
+
+	if (len <= 0)
+		return 0;
+
+	if (odd) {
+		t = 0;
+		((uchar *)&t)[1] = *ptr++;
+		xsum = t;
+		len--;
+	}
+	if (len >= 2 && ((ulong)ptr & 2)) {
+		xsum += *(ushort *)ptr;
+		ptr += 2;
+		len -= 2;
+	}
+
+	while (len >= 16) {
+		xsum += ((u32 *)ptr)[0];
+		xsum += ((u32 *)ptr)[1];
+		xsum += ((u32 *)ptr)[2];
+		xsum += ((u32 *)ptr)[3];
+		ptr += 16;
+		len -= 16;
+	}
+	while (len >= 4) {
+		xsum += *(u32 *)ptr;
+		ptr += 4;
+		len -= 4;
+	}
+	if (len >= 2) {
+		xsum += *(ushort *)ptr;
+		ptr += 2;
+		len -= 2;
+	}
+	if (len) {
+		t = 0;
+		((uchar *)&t)[0] = *ptr;
+		xsum += t;
+	}
+
+	xsum = (xsum & 0xffffffff) + (xsum >> 32);
+	w = (u32)xsum + (u32)(xsum >> 32);
+	w = (w & 0xffff) + (w >> 16);
+	w = (w & 0xffff) + (w >> 16);
+	if (odd)
+		w = ((w & 0xff) << 8) | (w >> 8);
+	return w;
+}
+
+/* 'len' counts 16-bit words */
 unsigned
 NetCksum(uchar * ptr, int len)
+{
+	return NetCksumBytes(ptr, len * 2);
+}
+
+/*
+ * Update the checksum 'sum' of a header in which the 16-bit word 'old'
+ * was replaced by 'new' (RFC 1624, eqn. 3); all values as stored in
+ * the header.
+ */
+ushort
+NetCksumUpdate(ushort sum, ushort old, ushort new)
 {
 	ulong	xsum;
-	ushort *p = (ushort *)ptr;
 
-	xsum = 0;
-	while (len-- > 0)
-		xsum += *p++;
+	xsum = (ushort)~sum + (ushort)~old + new;
 	xsum = (xsum & 0xffff) + (xsum >> 16);
 	xsum = (xsum & 0xffff) + (xsum >> 16);
-	return (xsum & 0xffff);
+	return ~xsum;
 }
 
 int
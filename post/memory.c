@@ -148,12 +148,18 @@
  * 0x000ff800-0x00100800, 0x001ff800-0x00200800, ..., 0x03fff800-
  * 0x04000000. If the test is run in slow-test mode, it verifies
  * the whole RAM.
+ *
+ * With CFG_POST_MEMORY_FAST defined, the slow-test mode replaces
+ * tests 1-4 by the fused cache line test of common/memtest.c, which
+ * covers the address, ~address and both checkerboard patterns in
+ * five passes and logs the throughput of each.
  */
 
 #ifdef CONFIG_POST
 
 #include <post.h>
 #include <watchdog.h>
+#include <memtest.h>
 
 #if CONFIG_POST & CFG_POST_MEMORY
 
@@ -452,6 +458,46 @@ static int memory_post_tests (unsigned long start, unsigned long size)
 	return ret;
 }
 
+#ifdef CFG_POST_MEMORY_FAST
+/*
+ * Slow-test mode replacement for the pattern passes above: the data
+ * and address line tests are kept, the full-size passes are done by
+ * the fused cache line test shared with "mtest -f".
+ */
+static int memory_post_fast (unsigned long start, unsigned long size)
+{
+	memtest_result_t res;
+	int pass, ret = 0;
+
+	if (ret == 0)
+		ret = memory_post_dataline ((unsigned long long *)start);
+	WATCHDOG_RESET ();
+	if (ret == 0)
+		ret = memory_post_addrline ((ulong *)start, (ulong *)start, size);
+	WATCHDOG_RESET ();
+	if (ret == 0)
+		ret = memory_post_addrline ((ulong *)(start + size - 8),
+					    (ulong *)start, size);
+	WATCHDOG_RESET ();
+	if (ret != 0)
+		return ret;
+
+	ret = memtest_fast (start, start + size, &res);
+
+	for (pass = 0; pass < res.pass; pass++) {
+		post_log ("%s: %d MB/s\n", memtest_pass_name[pass],
+			  memtest_rate (res.bytes, res.ms[pass]));
+	}
+	if (ret != 0) {
+		post_log ("Memory error at %08x, "
+			  "wrote %08x, read %08x !\n",
+			  res.addr, res.expected, res.actual);
+	}
+
+	return ret;
+}
+#endif /* CFG_POST_MEMORY_FAST */
+
 int memory_post_test (int flags)
 {
 	int ret = 0;
@@ -462,7 +508,11 @@ int memory_post_test (int flags)
 
 
 	if (flags & POST_SLOWTEST) {
+#ifdef CFG_POST_MEMORY_FAST
+		ret = memory_post_fast (CFG_SDRAM_BASE, memsize);
+#else
 		ret = memory_post_tests (CFG_SDRAM_BASE, memsize);
+#endif
 	} else {			/* POST_NORMAL */
 
 		unsigned long i;
@@ -30,6 +30,7 @@
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include <linux/mtd/mtd.h>
 #include "fw_env.h"
@@ -65,6 +66,8 @@ typedef struct environment_s {
 } env_t;
 
 static env_t environment;
+static uchar *env_orig;			/* valid copy as read from flash */
+static int env_is_default;
 
 static int HaveRedundEnv = 0;
 
@@ -269,28 +272,23 @@ void fw_printenv (int argc, char *argv[])
 }
 
 /*
- * Deletes or sets environment variables. Returns errno style error codes:
- * 0	  - OK
- * EINVAL - need at least 1 argument
+ * Delete or set one variable in the in-memory copy of the environment.
+ * A NULL or empty value deletes the variable. Returns errno style
+ * error codes:
+ * 0	  - OK (also when the variable already had this value)
+ * EINVAL - environment not terminated
  * EROFS  - certain variables ("ethaddr", "serial#") cannot be
  *	    modified or deleted
- *
+ * -1	  - environment overflow
  */
-int fw_setenv (int argc, char *argv[])
+static int env_set (uchar *name, uchar *value)
 {
-	int i, len;
+	int len;
 	uchar *env, *nxt;
 	uchar *oldval = NULL;
-	uchar *name;
-
-	if (argc < 2) {
-		return (EINVAL);
-	}
-
-	if (env_init ())
-		return (errno);
 
-	name = argv[1];
+	if (value && *value == '\0')
+		value = NULL;
 
 	/*
 	 * search if variable with this name already exists
@@ -307,6 +305,12 @@ int fw_setenv (int argc, char *argv[])
 			break;
 	}
 
+	/* Nothing to do: keep the order, so unchanged stays unchanged */
+	if (oldval == NULL && value == NULL)
+		return (0);
+	if (oldval && value && strcmp ((char *)oldval, (char *)value) == 0)
+		return (0);
+
 	/*
 	 * Delete any existing definition
 	 */
@@ -334,8 +338,8 @@ int fw_setenv (int argc, char *argv[])
 	}
 
 	/* Delete only ? */
-	if (argc < 3)
-		goto WRITE_FLASH;
+	if (value == NULL)
+		return (0);
 
 	/*
 	 * Append new definition at the end
@@ -347,11 +351,7 @@ int fw_setenv (int argc, char *argv[])
 	 * Overflow when:
 	 * "name" + "=" + "val" +"\0\0"  > CFG_ENV_SIZE - (env-environment)
 	 */
-	len = strlen (name) + 2;
-	/* add '=' for first arg, ' ' for all others */
-	for (i = 2; i < argc; ++i) {
-		len += strlen (argv[i]) + 1;
-	}
+	len = strlen ((char *)name) + 2 + strlen ((char *)value) + 1;
 	if (len > (&environment.data[ENV_SIZE] - env)) {
 		fprintf (stderr,
 			"Error: environment overflow, \"%s\" deleted\n",
@@ -360,17 +360,25 @@ int fw_setenv (int argc, char *argv[])
 	}
 	while ((*env = *name++) != '\0')
 		env++;
-	for (i = 2; i < argc; ++i) {
-		uchar *val = argv[i];
-
-		*env = (i == 2) ? '=' : ' ';
-		while ((*++env = *val++) != '\0');
-	}
+	*env = '=';
+	while ((*++env = *value++) != '\0');
 
 	/* end is marked with double '\0' */
 	*++env = '\0';
 
-  WRITE_FLASH:
+	return (0);
+}
+
+/*
+ * Write the in-memory environment back to flash, unless it is still
+ * identical to the valid copy read by env_init().
+ */
+static int env_write (void)
+{
+	if (env_orig && memcmp (env_orig, environment.data, ENV_SIZE) == 0) {
+		printf ("Environment unchanged, not written\n");
+		return (0);
+	}
 
 	/* Update CRC */
 	environment.crc = crc32 (0, environment.data, ENV_SIZE);
@@ -384,6 +392,150 @@ int fw_setenv (int argc, char *argv[])
 	return (0);
 }
 
+static long msecs_since (struct timeval *start)
+{
+	struct timeval now;
+
+	gettimeofday (&now, NULL);
+	return (now.tv_sec - start->tv_sec) * 1000 +
+		(now.tv_usec - start->tv_usec) / 1000;
+}
+
+/*
+ * Apply a script of variable assignments, one per line:
+ *	name value	- set "name" to "value" (rest of the line)
+ *	name		- delete "name"
+ * Empty lines and lines starting with '#' are ignored. All changes
+ * are made in memory and written to flash with a single erase cycle.
+ */
+static int env_script (char *fname)
+{
+	FILE *fp;
+	char line[1024];
+	int lineno = 0, count = 0, rc = 0;
+	struct timeval start;
+	long t_apply;
+
+	if (strcmp (fname, "-") == 0) {
+		fp = stdin;
+	} else if ((fp = fopen (fname, "r")) == NULL) {
+		fprintf (stderr, "Can't open %s: %s\n",
+			fname, strerror (errno));
+		return (errno);
+	}
+
+	gettimeofday (&start, NULL);
+
+	while (fgets (line, sizeof (line), fp) != NULL) {
+		char *name, *val;
+		int len = strlen (line);
+
+		++lineno;
+		if (len > 0 && line[len - 1] != '\n' && !feof (fp)) {
+			fprintf (stderr, "## Error: %s:%d: line too long\n",
+				fname, lineno);
+			rc = EINVAL;
+			break;
+		}
+		while (len > 0 &&
+		       (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = '\0';
+
+		for (name = line; *name == ' ' || *name == '\t'; ++name);
+		if (*name == '\0' || *name == '#')
+			continue;
+
+		for (val = name; *val && *val != ' ' && *val != '\t'; ++val);
+		if (*val) {
+			*val++ = '\0';
+			while (*val == ' ' || *val == '\t')
+				++val;
+		}
+
+		if ((rc = env_set ((uchar *)name, (uchar *)val)) != 0) {
+			fprintf (stderr, "## Error: %s:%d: can't set \"%s\"\n",
+				fname, lineno, name);
+			break;
+		}
+		++count;
+	}
+
+	if (fp != stdin)
+		fclose (fp);
+
+	/* Leave the flash alone if any operation failed */
+	if (rc)
+		return (rc);
+
+	t_apply = msecs_since (&start);
+	gettimeofday (&start, NULL);
+
+	if (env_write ())
+		return (-1);
+
+	printf ("%d operations applied in %ld ms, flash update %ld ms\n",
+		count, t_apply, msecs_since (&start));
+	return (0);
+}
+
+/*
+ * Deletes or sets environment variables. Returns errno style error codes:
+ * 0	  - OK
+ * EINVAL - need at least 1 argument
+ * EROFS  - certain variables ("ethaddr", "serial#") cannot be
+ *	    modified or deleted
+ *
+ * "fw_setenv -s file" applies all assignments in "file" ("-" for
+ * stdin) and writes the flash once; see env_script().
+ */
+int fw_setenv (int argc, char *argv[])
+{
+	int i, len, rc;
+	char *value = NULL;
+
+	if (argc < 2) {
+		return (EINVAL);
+	}
+
+	if (strcmp (argv[1], "-s") == 0) {
+		if (argc != 3) {
+			fprintf (stderr, "## Error: "
+				"`-s' option requires exactly one argument\n");
+			return (EINVAL);
+		}
+		if (env_init ())
+			return (errno);
+		return (env_script (argv[2]));
+	}
+
+	if (env_init ())
+		return (errno);
+
+	/* all "value" arguments are concatenated, separated by blanks */
+	if (argc > 2) {
+		for (len = 0, i = 2; i < argc; ++i)
+			len += strlen (argv[i]) + 1;
+		if ((value = malloc (len)) == NULL) {
+			fprintf (stderr, "Cannot malloc %d bytes: %s\n",
+				len, strerror (errno));
+			return (errno);
+		}
+		*value = '\0';
+		for (i = 2; i < argc; ++i) {
+			if (i > 2)
+				strcat (value, " ");
+			strcat (value, argv[i]);
+		}
+	}
+
+	rc = env_set ((uchar *)argv[1], (uchar *)value);
+	free (value);
+	if (rc)
+		return (rc);
+
+	return (env_write ());
+}
+
 static int flash_io (int mode)
 {
 	int fd, fdr, rc, otherdev, len, resid;
@@ -580,6 +732,22 @@ static uchar *envmatch (uchar * s1, uchar * s2)
 	return (NULL);
 }
 
+/*
+ * Load the default environment into a full size buffer, so that
+ * variables can be added to it
+ */
+static void use_default (uchar *buf)
+{
+	ulong len = sizeof (default_environment);
+
+	if (len > ENV_SIZE)
+		len = ENV_SIZE;
+	memset (buf, 0, ENV_SIZE);
+	memcpy (buf, default_environment, len);
+	environment.data = buf;
+	env_is_default = 1;
+}
+
 /*
  * Prevent confusion if running from erased flash memory
  */
@@ -614,8 +782,7 @@ static int env_init (void)
 		if (!crc1_ok) {
 			fprintf (stderr,
 				"Warning: Bad CRC, using default environment\n");
-			environment.data = default_environment;
-			free (addr1);
+			use_default (addr1);
 		}
 	} else {
 		flag1 = environment.flags;
@@ -652,10 +819,9 @@ static int env_init (void)
 		} else if (!crc1_ok && !crc2_ok) {
 			fprintf (stderr,
 				"Warning: Bad CRC, using default environment\n");
-			environment.data = default_environment;
+			use_default (addr1);
 			curdev = 0;
 			free (addr2);
-			free (addr1);
 		} else if (flag1 == active_flag && flag2 == obsolete_flag) {
 			environment.data = addr1;
 			environment.flags = flag1;
@@ -688,6 +854,11 @@ static int env_init (void)
 			free (addr1);
 		}
 	}
+
+	/* Remember what is in flash, to skip writing it back unchanged */
+	if (!env_is_default && (env_orig = malloc (ENV_SIZE)) != NULL)
+		memcpy (env_orig, environment.data, ENV_SIZE);
+
 	return (0);
 }
 
@@ -36,6 +36,11 @@
  *		  separated by sinlge blank characters, and the
  *		  resulting string is assigned to the environment
  *		  variable "name"
+ *	fw_setenv -s file
+ *		- applies all "name [value]" lines of "file" (or of
+ *		  stdin, if "file" is "-") and writes the environment
+ *		  to flash once; nothing is written if the environment
+ *		  did not change
  */
 
 #include <stdio.h>
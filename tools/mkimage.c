@@ -30,6 +30,9 @@
 #endif
 #include <sys/mman.h>
 #include <sys/stat.h>
+#ifndef __WIN32__
+#include <sys/wait.h>
+#endif
 #include <time.h>
 #include <unistd.h>
 
@@ -139,6 +142,9 @@ table_entry_t comp_name[] = {
     {	-1,		"",		"",			},
 };
 
+static	int	mkimage (int, char **);
+static	int	batch (const char *);
+static	void	write_data (int, const unsigned char *, int);
 static	void	copy_file (int, const char *, int);
 static	void	usage	(void);
 static	void	print_header (image_header_t *);
@@ -157,34 +163,54 @@ static	int	get_type(char *);
 
 char	*datafile;
 char	*imagefile;
+char	*batchfile;
 
+int bflag    = 0;
 int dflag    = 0;
 int eflag    = 0;
 int lflag    = 0;
+int sflag    = 0;
 int vflag    = 0;
 int xflag    = 0;
 int opt_os   = IH_OS_LINUX;
 int opt_arch = IH_CPU_PPC;
 int opt_type = IH_TYPE_KERNEL;
 int opt_comp = IH_COMP_GZIP;
+int opt_jobs = 0;
+uint32_t opt_addr = 0;
+uint32_t opt_ep   = 0;
+char	*opt_name = "";
 
 image_header_t header;
 image_header_t *hdr = &header;
 
+/*
+ * The data CRC is computed on the fly while the payload is written,
+ * so the image never has to be read back.
+ */
+uint32_t data_crc;
+uint32_t data_size;
+
+#define COPY_CHUNK	(64 * 1024)	/* write + CRC granularity	*/
+#define BATCH_MAXARGS	64		/* max. arguments per manifest line */
+
 int
 main (int argc, char **argv)
+{
+	cmdname = *argv;
+
+	return mkimage (argc, argv);
+}
+
+static int
+mkimage (int argc, char **argv)
 {
 	int ifd;
 	uint32_t checksum;
-	uint32_t addr;
-	uint32_t ep;
 	struct stat sbuf;
 	unsigned char *ptr;
-	char *name = "";
-
-	cmdname = *argv;
-
-	addr = ep = 0;
+	unsigned char *hbuf;
+	int hlen;
 
 	while (--argc > 0 && **++argv == '-') {
 		while (*++*argv) {
@@ -216,7 +242,7 @@ main (int argc, char **argv)
 			case 'a':
 				if (--argc <= 0)
 					usage ();
-				addr = strtoul (*++argv, (char **)&ptr, 16);
+				opt_addr = strtoul (*++argv, (char **)&ptr, 16);
 				if (*ptr) {
 					fprintf (stderr,
 						"%s: invalid load address %s\n",
@@ -224,6 +250,12 @@ main (int argc, char **argv)
 					exit (EXIT_FAILURE);
 				}
 				goto NXTARG;
+			case 'b':
+				if (--argc <= 0)
+					usage ();
+				batchfile = *++argv;
+				bflag = 1;
+				goto NXTARG;
 			case 'd':
 				if (--argc <= 0)
 					usage ();
@@ -233,7 +265,7 @@ main (int argc, char **argv)
 			case 'e':
 				if (--argc <= 0)
 					usage ();
-				ep = strtoul (*++argv, (char **)&ptr, 16);
+				opt_ep = strtoul (*++argv, (char **)&ptr, 16);
 				if (*ptr) {
 					fprintf (stderr,
 						"%s: invalid entry point %s\n",
@@ -242,11 +274,25 @@ main (int argc, char **argv)
 				}
 				eflag = 1;
 				goto NXTARG;
+			case 'j':
+				if (--argc <= 0)
+					usage ();
+				opt_jobs = strtoul (*++argv, (char **)&ptr, 10);
+				if (*ptr || opt_jobs <= 0) {
+					fprintf (stderr,
+						"%s: invalid number of jobs %s\n",
+						cmdname, *argv);
+					exit (EXIT_FAILURE);
+				}
+				goto NXTARG;
 			case 'n':
 				if (--argc <= 0)
 					usage ();
-				name = *++argv;
+				opt_name = *++argv;
 				goto NXTARG;
+			case 's':
+				sflag = 1;
+				break;
 			case 'v':
 				vflag++;
 				break;
@@ -260,14 +306,20 @@ main (int argc, char **argv)
 NXTARG:		;
 	}
 
+	if (bflag) {
+		if (argc != 0 || lflag)
+			usage ();
+		exit (batch (batchfile));
+	}
+
 	if ((argc != 1) || ((lflag ^ dflag) == 0))
 		usage();
 
 	if (!eflag) {
-		ep = addr;
+		opt_ep = opt_addr;
 		/* If XIP, entry point must be after the U-Boot header */
 		if (xflag)
-			ep += sizeof(image_header_t);
+			opt_ep += sizeof(image_header_t);
 	}
 
 	/*
@@ -275,7 +327,7 @@ NXTARG:		;
 	 * the size of the U-Boot header.
 	 */
 	if (xflag) {
-		if (ep != addr + sizeof(image_header_t)) {
+		if (opt_ep != opt_addr + sizeof(image_header_t)) {
 			fprintf (stderr, "%s: For XIP, the entry point must be the load addr + %lu\n",
 				cmdname,
 				(unsigned long)sizeof(image_header_t));
@@ -371,56 +423,65 @@ NXTARG:		;
 	/*
 	 * Must be -w then:
 	 *
-	 * write dummy header, to be fixed later
+	 * Keep the header and, for multi-file images, the length table
+	 * in memory; the latter is needed again by print_header().
 	 */
-	memset (hdr, 0, sizeof(image_header_t));
+	hlen = sizeof(image_header_t);
 
+	if (opt_type == IH_TYPE_MULTI || opt_type == IH_TYPE_SCRIPT) {
+		char *file;
+
+		hlen += sizeof(uint32_t);	/* terminating 0 */
+		for (file = datafile; file != NULL; file = strchr(file, ':')) {
+			if (*file == ':')
+				++file;
+			hlen += sizeof(uint32_t);
+		}
+	}
+
+	if ((hbuf = calloc (1, hlen)) == NULL) {
+		fprintf (stderr, "%s: Out of memory\n", cmdname);
+		exit (EXIT_FAILURE);
+	}
+	hdr = (image_header_t *)hbuf;
+
+	/* write dummy header, to be fixed later */
 	if (write(ifd, hdr, sizeof(image_header_t)) != sizeof(image_header_t)) {
 		fprintf (stderr, "%s: Write error on %s: %s\n",
 			cmdname, imagefile, strerror(errno));
 		exit (EXIT_FAILURE);
 	}
 
+	data_crc  = 0;
+	data_size = 0;
+
 	if (opt_type == IH_TYPE_MULTI || opt_type == IH_TYPE_SCRIPT) {
 		char *file = datafile;
-		unsigned long size;
+		uint32_t *len_ptr = (uint32_t *)(hbuf + sizeof(image_header_t));
 
 		for (;;) {
 			char *sep = NULL;
 
-			if (file) {
-				if ((sep = strchr(file, ':')) != NULL) {
-					*sep = '\0';
-				}
-
-				if (stat (file, &sbuf) < 0) {
-					fprintf (stderr, "%s: Can't stat %s: %s\n",
-						cmdname, file, strerror(errno));
-					exit (EXIT_FAILURE);
-				}
-				size = htonl(sbuf.st_size);
-			} else {
-				size = 0;
+			if ((sep = strchr(file, ':')) != NULL) {
+				*sep = '\0';
 			}
 
-			if (write(ifd, (char *)&size, sizeof(size)) != sizeof(size)) {
-				fprintf (stderr, "%s: Write error on %s: %s\n",
-					cmdname, imagefile, strerror(errno));
+			if (stat (file, &sbuf) < 0) {
+				fprintf (stderr, "%s: Can't stat %s: %s\n",
+					cmdname, file, strerror(errno));
 				exit (EXIT_FAILURE);
 			}
+			*len_ptr++ = htonl(sbuf.st_size);
 
-			if (!file) {
+			if (!sep)
 				break;
-			}
-
-			if (sep) {
-				*sep = ':';
-				file = sep + 1;
-			} else {
-				file = NULL;
-			}
+			*sep = ':';
+			file = sep + 1;
 		}
 
+		write_data (ifd, hbuf + sizeof(image_header_t),
+			    hlen - sizeof(image_header_t));
+
 		file = datafile;
 
 		for (;;) {
@@ -439,62 +500,44 @@ NXTARG:		;
 		copy_file (ifd, datafile, 0);
 	}
 
-	/* We're a bit of paranoid */
-#if defined(_POSIX_SYNCHRONIZED_IO) && !defined(__sun__) && !defined(__FreeBSD__)
-	(void) fdatasync (ifd);
-#else
-	(void) fsync (ifd);
-#endif
-
-	if (fstat(ifd, &sbuf) < 0) {
-		fprintf (stderr, "%s: Can't stat %s: %s\n",
-			cmdname, imagefile, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
-
-	ptr = (unsigned char *)mmap(0, sbuf.st_size,
-				    PROT_READ|PROT_WRITE, MAP_SHARED, ifd, 0);
-	if (ptr == (unsigned char *)MAP_FAILED) {
-		fprintf (stderr, "%s: Can't map %s: %s\n",
-			cmdname, imagefile, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
-
-	hdr = (image_header_t *)ptr;
-
-	checksum = crc32 (0,
-			  (const char *)(ptr + sizeof(image_header_t)),
-			  sbuf.st_size - sizeof(image_header_t)
-			 );
-
 	/* Build new header */
 	hdr->ih_magic = htonl(IH_MAGIC);
-	hdr->ih_time  = htonl(sbuf.st_mtime);
-	hdr->ih_size  = htonl(sbuf.st_size - sizeof(image_header_t));
-	hdr->ih_load  = htonl(addr);
-	hdr->ih_ep    = htonl(ep);
-	hdr->ih_dcrc  = htonl(checksum);
+	hdr->ih_time  = htonl(time(NULL));
+	hdr->ih_size  = htonl(data_size);
+	hdr->ih_load  = htonl(opt_addr);
+	hdr->ih_ep    = htonl(opt_ep);
+	hdr->ih_dcrc  = htonl(data_crc);
 	hdr->ih_os    = opt_os;
 	hdr->ih_arch  = opt_arch;
 	hdr->ih_type  = opt_type;
 	hdr->ih_comp  = opt_comp;
 
-	strncpy((char *)hdr->ih_name, name, IH_NMLEN);
+	strncpy((char *)hdr->ih_name, opt_name, IH_NMLEN);
 
 	checksum = crc32(0,(const char *)hdr,sizeof(image_header_t));
 
 	hdr->ih_hcrc = htonl(checksum);
 
-	print_header (hdr);
+	if (lseek (ifd, 0, SEEK_SET) != 0 ||
+	    write(ifd, hdr, sizeof(image_header_t)) != sizeof(image_header_t)) {
+		fprintf (stderr, "%s: Write error on %s: %s\n",
+			cmdname, imagefile, strerror(errno));
+		exit (EXIT_FAILURE);
+	}
 
-	(void) munmap((void *)ptr, sbuf.st_size);
+	if (bflag == 0 && batchfile != NULL)	/* running as a batch job */
+		printf ("Image File:   %s\n", imagefile);
+
+	print_header (hdr);
 
-	/* We're a bit of paranoid */
+	/* Flush to disk only on request (-s) */
+	if (sflag) {
 #if defined(_POSIX_SYNCHRONIZED_IO) && !defined(__sun__) && !defined(__FreeBSD__)
-	(void) fdatasync (ifd);
+		(void) fdatasync (ifd);
 #else
-	(void) fsync (ifd);
+		(void) fsync (ifd);
 #endif
+	}
 
 	if (close(ifd)) {
 		fprintf (stderr, "%s: Write error on %s: %s\n",
@@ -502,9 +545,33 @@ NXTARG:		;
 		exit (EXIT_FAILURE);
 	}
 
+	free (hbuf);
+
 	exit (EXIT_SUCCESS);
 }
 
+/*
+ * Append payload data to the image and account for it in the data CRC
+ */
+static void
+write_data (int ifd, const unsigned char *buf, int len)
+{
+	while (len > 0) {
+		int n = (len > COPY_CHUNK) ? COPY_CHUNK : len;
+
+		if (write(ifd, buf, n) != n) {
+			fprintf (stderr, "%s: Write error on %s: %s\n",
+				cmdname, imagefile, strerror(errno));
+			exit (EXIT_FAILURE);
+		}
+		/* CRC the chunk while it is still in the cache */
+		data_crc = crc32 (data_crc, (const char *)buf, n);
+		data_size += n;
+		buf += n;
+		len -= n;
+	}
+}
+
 static void
 copy_file (int ifd, const char *datafile, int pad)
 {
@@ -568,33 +635,183 @@ copy_file (int ifd, const char *datafile, int pad)
 	}
 
 	size = sbuf.st_size - offset;
-	if (write(ifd, ptr + offset, size) != size) {
-		fprintf (stderr, "%s: Write error on %s: %s\n",
-			cmdname, imagefile, strerror(errno));
+	write_data (ifd, ptr + offset, size);
+
+	if (pad && ((tail = size % 4) != 0)) {
+		write_data (ifd, (unsigned char *)&zero, 4-tail);
+	}
+
+	(void) munmap((void *)ptr, sbuf.st_size);
+	(void) close (dfd);
+}
+
+#ifndef __WIN32__
+/*
+ * Split a manifest line into arguments. Arguments are separated by
+ * white space; single or double quotes group words (for -n).
+ */
+static int
+split_args (char *line, char **args, int max)
+{
+	int n = 0;
+
+	for (;;) {
+		char quote = 0;
+		char *dst;
+
+		while (*line == ' ' || *line == '\t' ||
+		       *line == '\n' || *line == '\r')
+			++line;
+		if (*line == '\0' || *line == '#')
+			break;
+		if (n == max)
+			return -1;
+
+		args[n++] = dst = line;
+		while (*line) {
+			if (quote) {
+				if (*line == quote) {
+					quote = 0;
+					++line;
+					continue;
+				}
+			} else if (*line == '"' || *line == '\'') {
+				quote = *line++;
+				continue;
+			} else if (*line == ' ' || *line == '\t' ||
+				   *line == '\n' || *line == '\r') {
+				++line;
+				break;
+			}
+			*dst++ = *line++;
+		}
+		*dst = '\0';
+	}
+	return n;
+}
+
+/*
+ * Build all images listed in a manifest file, one per line, with the
+ * usual mkimage arguments. Options given on the command line before
+ * -b serve as defaults. Up to opt_jobs images are built in parallel.
+ */
+static int
+batch (const char *manifest)
+{
+	char *args[BATCH_MAXARGS + 2];
+	char *buf, *line, *next;
+	struct stat sbuf;
+	int fd, status;
+	int running = 0, failed = 0, total = 0, lineno = 0;
+
+	if (opt_jobs == 0) {
+		long ncpu = sysconf (_SC_NPROCESSORS_ONLN);
+
+		opt_jobs = (ncpu > 0) ? ncpu : 1;
+	}
+
+	/*
+	 * Read the whole manifest first: a buffered stream would share
+	 * its file offset with the child processes.
+	 */
+	if ((fd = open(manifest, O_RDONLY|O_BINARY)) < 0 ||
+	    fstat(fd, &sbuf) < 0) {
+		fprintf (stderr, "%s: Can't open %s: %s\n",
+			cmdname, manifest, strerror(errno));
 		exit (EXIT_FAILURE);
 	}
+	if ((buf = malloc (sbuf.st_size + 1)) == NULL) {
+		fprintf (stderr, "%s: Out of memory\n", cmdname);
+		exit (EXIT_FAILURE);
+	}
+	if (read(fd, buf, sbuf.st_size) != sbuf.st_size) {
+		fprintf (stderr, "%s: Can't read %s: %s\n",
+			cmdname, manifest, strerror(errno));
+		exit (EXIT_FAILURE);
+	}
+	buf[sbuf.st_size] = '\0';
+	(void) close (fd);
+
+	for (line = buf; line != NULL; line = next) {
+		pid_t pid;
+		int n;
+
+		if ((next = strchr(line, '\n')) != NULL)
+			*next++ = '\0';
+		++lineno;
+
+		n = split_args (line, args + 1, BATCH_MAXARGS);
+		if (n < 0) {
+			fprintf (stderr, "%s: %s:%d: too many arguments\n",
+				cmdname, manifest, lineno);
+			++failed;
+			continue;
+		}
+		if (n == 0)
+			continue;
+		args[0] = cmdname;
+		args[n + 1] = NULL;
 
-	if (pad && ((tail = size % 4) != 0)) {
+		for (; running >= opt_jobs; --running) {
+			if (wait (&status) < 0)
+				break;
+			if (!WIFEXITED(status) || WEXITSTATUS(status))
+				++failed;
+		}
 
-		if (write(ifd, (char *)&zero, 4-tail) != 4-tail) {
-			fprintf (stderr, "%s: Write error on %s: %s\n",
-				cmdname, imagefile, strerror(errno));
+		fflush (stdout);
+		fflush (stderr);
+
+		if ((pid = fork ()) < 0) {
+			fprintf (stderr, "%s: Can't fork: %s\n",
+				cmdname, strerror(errno));
 			exit (EXIT_FAILURE);
 		}
+		if (pid == 0) {
+			/* keep the output of each image in one piece */
+			setvbuf (stdout, NULL, _IOFBF, BUFSIZ);
+			bflag = 0;
+			mkimage (n + 1, args);	/* does not return */
+		}
+		++running;
+		++total;
 	}
 
-	(void) munmap((void *)ptr, sbuf.st_size);
-	(void) close (dfd);
+	for (; running > 0; --running) {
+		if (wait (&status) < 0)
+			break;
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			++failed;
+	}
+
+	free (buf);
+
+	if (failed) {
+		fprintf (stderr, "%s: %d of %d images failed\n",
+			cmdname, failed, total);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
 }
+#else
+static int
+batch (const char *manifest)
+{
+	fprintf (stderr, "%s: batch mode not supported on this host\n",
+		cmdname);
+	return EXIT_FAILURE;
+}
+#endif	/* __WIN32__ */
 
 void
 usage ()
 {
 	fprintf (stderr, "Usage: %s -l image\n"
 			 "          -l ==> list image header information\n"
-			 "       %s [-x] -A arch -O os -T type -C comp "
-			 "-a addr -e ep -n name -d data_file[:data_file...] image\n",
-		cmdname, cmdname);
+			 "       %s [-x] [-s] -A arch -O os -T type -C comp "
+			 "-a addr -e ep -n name -d data_file[:data_file...] image\n"
+			 "       %s [options] -b manifest [-j jobs]\n",
+		cmdname, cmdname, cmdname);
 	fprintf (stderr, "          -A ==> set architecture to 'arch'\n"
 			 "          -O ==> set operating system to 'os'\n"
 			 "          -T ==> set image type to 'type'\n"
@@ -604,6 +821,9 @@ usage ()
 			 "          -n ==> set image name to 'name'\n"
 			 "          -d ==> use image data from 'datafile'\n"
 			 "          -x ==> set XIP (execute in place)\n"
+			 "          -s ==> sync image to disk before exit\n"
+			 "          -b ==> build all images listed in 'manifest'\n"
+			 "          -j ==> run up to 'jobs' builds in parallel\n"
 		);
 	exit (EXIT_FAILURE);
 }
@@ -628,7 +848,7 @@ print_header (image_header_t *hdr)
 	if (hdr->ih_type == IH_TYPE_MULTI || hdr->ih_type == IH_TYPE_SCRIPT) {
 		int i, ptrs;
 		uint32_t pos;
-		unsigned long *len_ptr = (unsigned long *) (
+		uint32_t *len_ptr = (uint32_t *) (
 					(unsigned long)hdr + sizeof(image_header_t)
 				);
 
@@ -637,7 +857,7 @@ print_header (image_header_t *hdr)
 			;
 		ptrs = i;		/* null pointer terminates list */
 
-		pos = sizeof(image_header_t) + ptrs * sizeof(long);
+		pos = sizeof(image_header_t) + ptrs * sizeof(uint32_t);
 		printf ("Contents:\n");
 		for (i=0; len_ptr[i]; ++i) {
 			size = ntohl(len_ptr[i]);
@@ -0,0 +1,186 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * The parts of U-Boot's run time environment the host tests need: a
+ * fake clock which only moves when told to, ctrlc() on request and a
+ * private table of environment variables.
+ */
+#include <common.h>
+#if defined(CFG_HUSH_PARSER) && defined(CFG_HUSH_RUN_CACHE)
+#include <hush.h>
+#endif
+
+static bd_t host_bd = { 0, 0, 0, { 0 }, 115200 };
+static gd_t host_gd = { GD_FLG_RELOC, 115200, 0, 0, &host_bd };
+gd_t *gd = &host_gd;
+
+ulong load_addr;
+
+int host_fails;
+
+/* ------------------------------------------------------------------------- */
+
+static ulong host_ms;		/* fake clock, advanced by udelay() too */
+static ulong host_us;
+
+ulong get_timer (ulong base)
+{
+	return host_ms - base;
+}
+
+void host_advance (ulong ms)
+{
+	host_ms += ms;
+}
+
+void udelay (unsigned long usec)
+{
+	host_us += usec;
+	host_ms += host_us / 1000;
+	host_us %= 1000;
+}
+
+unsigned long long get_ticks (void)
+{
+	return (unsigned long long)host_ms * 1000 + host_us;
+}
+
+ulong get_tbclk (void)
+{
+	return 1000000;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int ctrlc_after = -1;
+static int ctrlc_seen;
+
+void host_ctrlc (int after)
+{
+	ctrlc_after = after;
+}
+
+int ctrlc (void)
+{
+	if (ctrlc_after > 0)
+		ctrlc_after--;
+	else if (ctrlc_after == 0)
+		ctrlc_seen = 1;
+	return ctrlc_seen;
+}
+
+int had_ctrlc (void)
+{
+	return ctrlc_seen;
+}
+
+void clear_ctrlc (void)
+{
+	ctrlc_seen = 0;
+	ctrlc_after = -1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+#define HOST_ENV_MAX	64
+
+static char *env_name[HOST_ENV_MAX];
+static char *env_value[HOST_ENV_MAX];
+
+char *ub_getenv (const char *name)
+{
+	int i;
+
+	for (i = 0; i < HOST_ENV_MAX; i++)
+		if (env_name[i] && strcmp (env_name[i], name) == 0)
+			return env_value[i];
+	return NULL;
+}
+
+int ub_setenv (char *name, char *value)
+{
+	int i, empty = -1;
+
+#if defined(CFG_HUSH_PARSER) && defined(CFG_HUSH_RUN_CACHE)
+	/* as in cmd_nvedit.c */
+	hush_run_cache_forget (name);
+#endif
+
+	for (i = 0; i < HOST_ENV_MAX; i++) {
+		if (env_name[i] == NULL) {
+			if (empty < 0)
+				empty = i;
+			continue;
+		}
+		if (strcmp (env_name[i], name) == 0)
+			break;
+	}
+	if (i == HOST_ENV_MAX) {
+		if (empty < 0 || value == NULL)
+			return value == NULL ? 0 : 1;
+		i = empty;
+		env_name[i] = strdup (name);
+	} else {
+		/* poison the old value, callers must not keep pointers */
+		memset (env_value[i], '#', strlen (env_value[i]));
+		free (env_value[i]);
+	}
+	if (value == NULL) {
+		free (env_name[i]);
+		env_name[i] = NULL;
+		env_value[i] = NULL;
+	} else
+		env_value[i] = strdup (value);
+	return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+ulong simple_strtoul (const char *cp, char **endp, unsigned int base)
+{
+	return strtoul (cp, endp, base);
+}
+
+ulong crc32_no_comp (ulong crc, const unsigned char *buf, uint len)
+{
+	int k;
+
+	crc &= 0xffffffff;
+	while (len--) {
+		crc ^= *buf++;
+		for (k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	return crc;
+}
+
+ulong crc32 (ulong crc, const unsigned char *buf, uint len)
+{
+	return ~crc32_no_comp (~crc, buf, len) & 0xffffffff;
+}
+
+void hang (void)
+{
+	puts ("### ERROR ### Please RESET the board ###\n");
+	exit (2);
+}
@@ -0,0 +1,131 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * A network interface for tests which build net/net.c: packets sent
+ * are kept for the test to look at, and shown to host_eth_peer() which
+ * can answer them; packets queued by the test are handed to
+ * NetReceive() by eth_rx(). Each eth_rx() call which finds nothing to
+ * receive moves the fake clock on by one millisecond, so NetLoop()
+ * timeouts expire. The protocols net.c starts are stubs, except that
+ * TftpStart() calls host_net_start().
+ */
+#include <common.h>
+#include <net.h>
+#include "hostnet.h"
+
+#define HOST_ETH_QUEUE	32
+
+static struct host_pkt {
+	uchar	data[PKTSIZE];
+	int	len;
+} tx_queue[HOST_ETH_QUEUE], rx_queue[HOST_ETH_QUEUE];
+
+static int tx_count, rx_head, rx_tail;
+
+void (*host_eth_peer)(uchar *pkt, int len);
+void (*host_net_start)(void);
+
+int host_eth_sent (void)
+{
+	return tx_count;
+}
+
+uchar *host_eth_packet (int n, int *len)
+{
+	if (n < 0 || n >= tx_count || n >= HOST_ETH_QUEUE)
+		return NULL;
+	if (len)
+		*len = tx_queue[n].len;
+	return tx_queue[n].data;
+}
+
+void host_eth_clear (void)
+{
+	tx_count = rx_head = rx_tail = 0;
+}
+
+int host_eth_queue (uchar *pkt, int len)
+{
+	struct host_pkt *p;
+
+	if (rx_tail - rx_head >= HOST_ETH_QUEUE || len > PKTSIZE)
+		return -1;
+	p = &rx_queue[rx_tail++ % HOST_ETH_QUEUE];
+	memcpy (p->data, pkt, len);
+	p->len = len;
+	return 0;
+}
+
+int eth_init (bd_t *bis)
+{
+	return 0;
+}
+
+void eth_halt (void)
+{
+}
+
+int eth_send (volatile void *packet, int length)
+{
+	if (tx_count < HOST_ETH_QUEUE) {
+		memcpy (tx_queue[tx_count].data, (void *)packet, length);
+		tx_queue[tx_count].len = length;
+	}
+	tx_count++;
+	if (host_eth_peer)
+		(*host_eth_peer)((uchar *)packet, length);
+	return 0;
+}
+
+int eth_rx (void)
+{
+	struct host_pkt *p;
+
+	if (rx_head == rx_tail) {
+		host_advance (1);
+		return 0;
+	}
+	p = &rx_queue[rx_head++ % HOST_ETH_QUEUE];
+	memcpy ((void *)NetRxPackets[0], p->data, p->len);
+	NetReceive (NetRxPackets[0], p->len);
+	return p->len;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int BootpTry;
+int RarpTry;
+
+void BootpRequest (void)
+{
+}
+
+void RarpRequest (void)
+{
+}
+
+void TftpStart (void)
+{
+	if (host_net_start)
+		(*host_net_start)();
+}
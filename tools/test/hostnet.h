@@ -0,0 +1,37 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * hostnet.c: the network interface of tests which build net/net.c
+ */
+#ifndef __HOSTNET_H_
+#define __HOSTNET_H_
+
+int	host_eth_sent (void);			/* packets sent so far */
+uchar	*host_eth_packet (int n, int *len);	/* the n-th of them */
+int	host_eth_queue (uchar *pkt, int len);	/* to be received */
+void	host_eth_clear (void);
+
+extern void (*host_eth_peer)(uchar *pkt, int len);	/* sees all sent */
+extern void (*host_net_start)(void);		/* NetLoop(TFTP) calls it */
+
+#endif	/* __HOSTNET_H_ */
@@ -0,0 +1,16 @@
+/*
+ * Host stand-in for <asm/byteorder.h>: the byte order of the host,
+ * as in asm-i386.
+ */
+#ifndef __HOSTTEST_ASM_BYTEORDER_H_
+#define __HOSTTEST_ASM_BYTEORDER_H_
+
+#include <linux/byteorder/little_endian.h>
+
+/*
+ * <endian.h> also defines __BIG_ENDIAN, as a value for __BYTE_ORDER;
+ * U-Boot code tests it with #ifdef.
+ */
+#undef __BIG_ENDIAN
+
+#endif	/* __HOSTTEST_ASM_BYTEORDER_H_ */
@@ -0,0 +1,13 @@
+/*
+ * Host stand-in for <asm/io.h>: port I/O goes to the simulated device
+ * of the test.
+ */
+#ifndef __HOSTTEST_ASM_IO_H_
+#define __HOSTTEST_ASM_IO_H_
+
+unsigned char	inb (unsigned long port);
+void		outb (unsigned char val, unsigned long port);
+void		insw (unsigned long port, void *buf, int words);
+void		outsw (unsigned long port, const void *buf, int words);
+
+#endif	/* __HOSTTEST_ASM_IO_H_ */
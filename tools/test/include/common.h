@@ -0,0 +1,155 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Host stand-in for <common.h>: just enough of U-Boot's environment to
+ * build single files of the tree into host test programs. The rest of
+ * the environment (timer, console, environment variables) is in
+ * hostlib.c.
+ */
+#ifndef __HOSTTEST_COMMON_H_
+#define __HOSTTEST_COMMON_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <config.h>
+
+typedef unsigned char		uchar;
+typedef unsigned short		ushort;
+typedef unsigned int		uint;
+typedef unsigned long		ulong;
+typedef volatile unsigned long	vu_long;
+typedef volatile unsigned short	vu_short;
+typedef volatile unsigned char	vu_char;
+
+typedef uint8_t		u8;
+typedef uint16_t	u16;
+typedef uint32_t	u32;
+typedef uint64_t	u64;
+typedef uint8_t		__u8;
+typedef uint16_t	__u16;
+typedef uint32_t	__u32;
+typedef int8_t		__s8;
+typedef int16_t		__s16;
+typedef int32_t		__s32;
+typedef unsigned long long	__u64;	/* as <asm/types.h> has them */
+typedef long long		__s64;
+
+#include <asm/byteorder.h>	/* through <linux/bitops.h> in U-Boot */
+
+/* U-Boot's console functions differ from stdio's */
+#undef putc
+#define putc(c)		putchar (c)
+#define puts(s)		fputs ((s), stdout)
+#undef getc
+#define getc()		host_getc ()
+
+#ifdef DEBUG
+#define debug(fmt,args...)	printf (fmt ,##args)
+#else
+#define debug(fmt,args...)
+#endif
+
+#define WATCHDOG_RESET()
+
+#define max(X, Y)				\
+	({ typeof (X) __x = (X), __y = (Y);	\
+		(__x > __y) ? __x : __y; })
+#define min(X, Y)				\
+	({ typeof (X) __x = (X), __y = (Y);	\
+		(__x < __y) ? __x : __y; })
+
+#define GD_FLG_RELOC	0x00001
+
+typedef struct bd_info {
+	ulong	bi_memstart;
+	ulong	bi_memsize;
+	ulong	bi_ip_addr;
+	uchar	bi_enetaddr[6];
+	ulong	bi_baudrate;
+} bd_t;
+
+typedef struct global_data {
+	ulong	flags;
+	ulong	baudrate;
+	ulong	reloc_off;
+	ulong	ram_size;
+	bd_t	*bd;
+} gd_t;
+
+extern gd_t *gd;
+#define DECLARE_GLOBAL_DATA_PTR	extern gd_t *gd
+
+extern ulong load_addr;		/* hostlib.c */
+
+#include <part.h>
+#ifdef CFG_MAX_FLASH_SECT
+#include <flash.h>		/* tests with a flash_info[] define it */
+#endif
+
+/* hostlib.c; the environment is a private table, not the process' */
+#define getenv(name)		ub_getenv (name)
+#define setenv(name, value)	ub_setenv (name, value)
+char	*ub_getenv (const char *name);
+int	ub_setenv (char *name, char *value);
+
+ulong	get_timer (ulong base);
+void	udelay (unsigned long usec);
+unsigned long long get_ticks (void);
+ulong	get_tbclk (void);
+void	host_advance (ulong ms);	/* move the fake clock */
+
+int	ctrlc (void);
+int	had_ctrlc (void);
+void	clear_ctrlc (void);
+void	host_ctrlc (int after);		/* ctrlc() fires after n calls */
+
+ulong	simple_strtoul (const char *cp, char **endp, unsigned int base);
+ulong	crc32 (ulong crc, const unsigned char *buf, uint len);
+ulong	crc32_no_comp (ulong crc, const unsigned char *buf, uint len);
+void	hang (void) __attribute__ ((noreturn));
+int	readline (const char *const prompt);	/* provided by the test */
+
+/* provided by the tests which need them */
+int	host_getc (void);		/* console input */
+int	tstc (void);
+void	serial_setbrg (void);
+struct image_header;
+void	print_image_hdr (struct image_header *hdr);
+void	flush_cache (unsigned long start, unsigned long size);
+char	*strswab (const char *s);
+
+extern int host_fails;		/* failed checks */
+
+#define check(cond)	do {						\
+	if (!(cond)) {							\
+		printf ("%s:%d: check failed: %s\n",			\
+			__FILE__, __LINE__, #cond);			\
+		host_fails++;						\
+	}								\
+} while (0)
+
+#endif	/* __HOSTTEST_COMMON_H_ */
@@ -0,0 +1,4 @@
+/*
+ * Host tests: configuration options are passed with -D by the Makefile
+ */
+#include <cmd_confdefs.h>
@@ -0,0 +1,8 @@
+/*
+ * Host stand-in for <exports.h>: there are no standalone applications
+ * to export functions to, and <common.h> declares the console.
+ */
+#ifndef __HOSTTEST_EXPORTS_H_
+#define __HOSTTEST_EXPORTS_H_
+
+#endif	/* __HOSTTEST_EXPORTS_H_ */
@@ -0,0 +1,2 @@
+/* the host's, not the tree's */
+#include <ctype.h>
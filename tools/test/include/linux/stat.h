@@ -0,0 +1,2 @@
+/* the host's struct stat and S_IS*() */
+#include <sys/stat.h>
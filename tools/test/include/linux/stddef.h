@@ -0,0 +1,2 @@
+/* the host's, not the tree's kernel headers */
+#include <stddef.h>
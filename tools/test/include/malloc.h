@@ -0,0 +1,15 @@
+/*
+ * Host tests use the C library's allocator. test_dlmalloc builds the
+ * tree's own with USE_DL_PREFIX, which needs the real <malloc.h>.
+ * Tests built with HOST_MALLOC provide host_malloc() to make the
+ * allocations of the file under test fail.
+ */
+#ifdef USE_DL_PREFIX
+#include "../../../include/malloc.h"
+#else
+#include <stdlib.h>
+#ifdef HOST_MALLOC
+#define malloc(size)	host_malloc (size)
+void	*host_malloc (size_t size);
+#endif
+#endif
@@ -0,0 +1,3 @@
+/*
+ * Host tests: WATCHDOG_RESET() is defined in <common.h>
+ */
@@ -0,0 +1,282 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * The ARP cache of net/net.c, driven through NetLoop() with a
+ * simulated network: a server and other hosts on our subnet, and a
+ * gateway to the rest. Each "transfer" sends a UDP packet to one or
+ * more hosts and is done when all of them have answered. The number
+ * of ARP requests every step needs is checked: cached addresses are
+ * reused across NetLoop() runs, expire, are learned from ARP requests
+ * for us and from IP packets of local hosts but not from other ARP
+ * traffic, the oldest entry is replaced when the cache is full, two
+ * packets can wait for ARP at once, and an ARP timeout flushes it all.
+ */
+#include <common.h>
+#include <net.h>
+#include "hostnet.h"
+
+#ifndef CFG_ARP_CACHE_AGE
+#define CFG_ARP_CACHE_AGE	300		/* as in net.c */
+#endif
+
+#define IP(a,b,c,d)	((IPaddr_t)(a) << 24 | (b) << 16 | (c) << 8 | (d))
+
+#define OUR_IP		IP(192,168,11,150)
+#define SERVER_IP	IP(192,168,11,1)
+#define GATEWAY_IP	IP(192,168,11,254)
+
+static uchar our_ether[6] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+
+/* which hosts answer ARP requests */
+static int silent;
+
+/* what the current transfer sends to */
+static IPaddr_t target[2];
+static uchar target_ether[2][6];
+static int ntargets, answered;
+
+/* queued by the test for the start of the next transfer */
+static uchar pre_rx[4][PKTSIZE];
+static int pre_len[4], npre;
+
+static int arp_requests, arp_replies;	/* sent by us */
+
+/* hosts have ethernet address 02:00:<ip> */
+static void host_ether (IPaddr_t ip, uchar *ether)
+{
+	ether[0] = 0x02;
+	ether[1] = 0x00;
+	ether[2] = ip >> 24;
+	ether[3] = ip >> 16;
+	ether[4] = ip >> 8;
+	ether[5] = ip;
+}
+
+static int make_arp (uchar *pkt, int op, IPaddr_t sip, IPaddr_t tip)
+{
+	Ethernet_t *et = (Ethernet_t *)pkt;
+	ARP_t *arp = (ARP_t *)(pkt + ETHER_HDR_SIZE);
+	uchar ether[6];
+
+	host_ether (sip, ether);
+	memcpy (et->et_dest, op == ARPOP_REQUEST ? NetBcastAddr : our_ether, 6);
+	memcpy (et->et_src, ether, 6);
+	et->et_protlen = htons (PROT_ARP);
+	arp->ar_hrd = htons (ARP_ETHER);
+	arp->ar_pro = htons (PROT_IP);
+	arp->ar_hln = 6;
+	arp->ar_pln = 4;
+	arp->ar_op = htons (op);
+	memcpy (&arp->ar_data[0], ether, 6);
+	NetWriteIP (&arp->ar_data[6], htonl (sip));
+	memset (&arp->ar_data[10], 0, 6);
+	NetWriteIP (&arp->ar_data[16], htonl (tip));
+	return ETHER_HDR_SIZE + ARP_HDR_SIZE;
+}
+
+/* a UDP packet to us from 'sip', coming through 'via' */
+static int make_udp (uchar *pkt, IPaddr_t sip, IPaddr_t via, int dport)
+{
+	Ethernet_t *et = (Ethernet_t *)pkt;
+	IP_t *ip = (IP_t *)(pkt + ETHER_HDR_SIZE);
+
+	memset (pkt, 0, ETHER_HDR_SIZE + IP_HDR_SIZE);
+	memcpy (et->et_dest, our_ether, 6);
+	host_ether (via, et->et_src);
+	et->et_protlen = htons (PROT_IP);
+	ip->ip_hl_v = 0x45;
+	ip->ip_len = htons (IP_HDR_SIZE);
+	ip->ip_ttl = 64;
+	ip->ip_p = IPPROTO_UDP;
+	NetWriteIP ((uchar *)&ip->ip_src, htonl (sip));
+	NetWriteIP ((uchar *)&ip->ip_dst, htonl (OUR_IP));
+	ip->udp_src = htons (69);
+	ip->udp_dst = htons (dport);
+	ip->udp_len = htons (8);
+	ip->ip_sum = ~NetCksum ((uchar *)ip, IP_HDR_SIZE_NO_UDP / 2);
+	return ETHER_HDR_SIZE + IP_HDR_SIZE;
+}
+
+/* the rest of the network, answering what we send */
+static void peer (uchar *pkt, int len)
+{
+	Ethernet_t *et = (Ethernet_t *)pkt;
+	uchar reply[PKTSIZE], ether[6];
+	IPaddr_t dst, via;
+	int n;
+
+	if (ntohs (et->et_protlen) == PROT_ARP) {
+		ARP_t *arp = (ARP_t *)(pkt + ETHER_HDR_SIZE);
+
+		if (ntohs (arp->ar_op) == ARPOP_REPLY)
+			arp_replies++;
+		if (ntohs (arp->ar_op) != ARPOP_REQUEST)
+			return;
+		arp_requests++;
+		if (silent)
+			return;
+		dst = ntohl (NetReadIP (&arp->ar_data[16]));
+		n = make_arp (reply, ARPOP_REPLY, dst, OUR_IP);
+		host_eth_queue (reply, n);
+	} else if (ntohs (et->et_protlen) == PROT_IP) {
+		IP_t *ip = (IP_t *)(pkt + ETHER_HDR_SIZE);
+
+		dst = ntohl (NetReadIP ((uchar *)&ip->ip_dst));
+		via = (dst & 0xffffff00) == (OUR_IP & 0xffffff00) ?
+			dst : GATEWAY_IP;
+		/* the packet must have gone to the right station */
+		host_ether (via, ether);
+		check (memcmp (et->et_dest, ether, 6) == 0);
+		n = make_udp (reply, dst, via, ntohs (ip->udp_src));
+		host_eth_queue (reply, n);
+	}
+}
+
+static void handler (uchar *pkt, unsigned dest, unsigned src, unsigned len)
+{
+	if (dest == 1024 && ++answered == ntargets)
+		NetState = NETLOOP_SUCCESS;
+}
+
+static void timeout (void)
+{
+	NetState = NETLOOP_FAIL;
+}
+
+static void start (void)
+{
+	int i;
+
+	NetSetHandler (handler);
+	NetSetTimeout (60 * CFG_HZ, timeout);
+	for (i = 0; i < npre; i++)
+		host_eth_queue (pre_rx[i], pre_len[i]);
+	npre = 0;
+	for (i = 0; i < ntargets; i++) {
+		memset (target_ether[i], 0, 6);
+		NetSendUDPPacket (target_ether[i], htonl (target[i]),
+				  69, 1024, 0);
+	}
+}
+
+/*
+ * Send to 'ip1' and, unless it is 0, 'ip2'; returns the number of ARP
+ * requests that took, or -1 if the transfer failed.
+ */
+static int transfer (IPaddr_t ip1, IPaddr_t ip2)
+{
+	target[0] = ip1;
+	target[1] = ip2;
+	ntargets = ip2 ? 2 : 1;
+	answered = 0;
+	arp_requests = arp_replies = 0;
+	host_eth_clear ();
+	host_advance (1000);	/* a second between commands */
+	if (NetLoop (TFTP) < 0)
+		return -1;
+	return arp_requests;
+}
+
+static void queue_arp (int op, IPaddr_t sip, IPaddr_t tip)
+{
+	pre_len[npre] = make_arp (pre_rx[npre], op, sip, tip);
+	npre++;
+}
+
+static void queue_udp (IPaddr_t sip, IPaddr_t via)
+{
+	pre_len[npre] = make_udp (pre_rx[npre], sip, via, 2000);
+	npre++;
+}
+
+int main (int argc, char *argv[])
+{
+	int i;
+
+	gd->bd->bi_ip_addr = htonl (OUR_IP);
+	memcpy (gd->bd->bi_enetaddr, our_ether, 6);
+	setenv ("serverip", "192.168.11.1");
+	setenv ("gatewayip", "192.168.11.254");
+	setenv ("netmask", "255.255.255.0");
+	setenv ("netretry", "no");
+	host_eth_peer = peer;
+	host_net_start = start;
+
+	/* resolved once, then cached across NetLoop() runs */
+	check (transfer (SERVER_IP, 0) == 1);
+	check (transfer (SERVER_IP, 0) == 0);
+	check (transfer (SERVER_IP, 0) == 0);
+
+	/* expired */
+	host_advance ((CFG_ARP_CACHE_AGE + 1) * 1000);
+	check (transfer (SERVER_IP, 0) == 1);
+	check (transfer (SERVER_IP, 0) == 0);
+
+	/* off the subnet: the gateway is asked for and cached */
+	check (transfer (IP(10,0,0,5), 0) == 1);
+	check (transfer (IP(10,0,0,6), 0) == 0);
+
+	/* learned from an ARP request for us, which is answered */
+	queue_arp (ARPOP_REQUEST, IP(192,168,11,7), OUR_IP);
+	check (transfer (SERVER_IP, 0) == 0);
+	check (arp_replies == 1);
+	check (transfer (IP(192,168,11,7), 0) == 0);
+
+	/* not learned from ARP requests for other hosts */
+	queue_arp (ARPOP_REQUEST, IP(192,168,11,8), IP(192,168,11,9));
+	check (transfer (SERVER_IP, 0) == 0);
+	check (transfer (IP(192,168,11,8), 0) == 1);
+
+	/* learned from IP packets of hosts on our network only */
+	queue_udp (IP(192,168,11,20), IP(192,168,11,20));
+	queue_udp (IP(10,0,0,20), GATEWAY_IP);
+	check (transfer (SERVER_IP, 0) == 0);
+	check (transfer (IP(192,168,11,20), 0) == 0);
+
+	/*
+	 * Cache of 4, oldest first: .7, .8, server, .20. The gateway
+	 * went for .20; it comes back in place of .7, and two hosts
+	 * waiting for ARP at the same time replace .8 and the server.
+	 */
+	check (transfer (IP(10,0,0,5), 0) == 1);
+	check (transfer (IP(192,168,11,30), IP(192,168,11,31)) == 2);
+	check (transfer (IP(192,168,11,30), IP(192,168,11,31)) == 0);
+	check (transfer (IP(10,0,0,5), 0) == 0);
+	check (transfer (IP(192,168,11,20), 0) == 0);
+	check (transfer (IP(192,168,11,7), 0) == 1);
+	check (transfer (SERVER_IP, 0) == 1);
+
+	/* an ARP timeout gives up and flushes the cache */
+	silent = 1;
+	i = transfer (IP(192,168,11,40), 0);
+	check (i == -1);
+	check (arp_requests == 4);	/* first request, 3 retries */
+	silent = 0;
+	check (transfer (SERVER_IP, 0) == 1);
+
+	puts ("arp cache after the run:\n");
+	ArpCachePrint ();
+
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
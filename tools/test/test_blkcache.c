@@ -0,0 +1,146 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * disk/blkcache.c on file-backed block devices: every read through the
+ * cache is compared with the file, and the statistics and slot handling
+ * are checked.
+ */
+#include <common.h>
+#include <part.h>
+
+#define NDEVS		6		/* more than the cache has slots */
+#define DEV_BLOCKS	4096
+#define BLKSZ		512
+
+static FILE *dev_file[NDEVS];
+static ulong dev_reads[NDEVS];
+static block_dev_desc_t dev[NDEVS];
+
+static ulong file_read (int n, ulong start, lbaint_t blkcnt, ulong *buffer)
+{
+	dev_reads[n]++;
+	if (start + blkcnt > DEV_BLOCKS)
+		blkcnt = start < DEV_BLOCKS ? DEV_BLOCKS - start : 0;
+	fseek (dev_file[n], (long)start * BLKSZ, SEEK_SET);
+	return fread (buffer, BLKSZ, blkcnt, dev_file[n]);
+}
+
+static void dev_create (int n)
+{
+	uchar blk[BLKSZ];
+	int i, j;
+
+	dev_file[n] = tmpfile ();
+	for (i = 0; i < DEV_BLOCKS; i++) {
+		for (j = 0; j < BLKSZ; j++)
+			blk[j] = (uchar)(i * 7 + j * 13 + n);
+		fwrite (blk, BLKSZ, 1, dev_file[n]);
+	}
+	memset (&dev[n], 0, sizeof (dev[n]));
+	dev[n].if_type = IF_TYPE_IDE;
+	dev[n].dev = n;
+	dev[n].type = DEV_TYPE_HARDDISK;
+	dev[n].lba = DEV_BLOCKS;
+	dev[n].blksz = BLKSZ;
+	dev[n].block_read = file_read;
+}
+
+/* read through the cache and compare with the file */
+static void check_read (int n, ulong start, lbaint_t cnt)
+{
+	static ulong buf[64 * BLKSZ / sizeof (ulong)];
+	static ulong ref[64 * BLKSZ / sizeof (ulong)];
+	ulong got, want;
+
+	got = dev[n].block_read (n, start, cnt, buf);
+	want = (start + cnt > DEV_BLOCKS) ?
+		(start < DEV_BLOCKS ? DEV_BLOCKS - start : 0) : cnt;
+	check (got == want);
+	fseek (dev_file[n], (long)start * BLKSZ, SEEK_SET);
+	fread (ref, BLKSZ, want, dev_file[n]);
+	check (memcmp (buf, ref, want * BLKSZ) == 0);
+}
+
+int main (void)
+{
+	ulong before;
+	int i, n;
+
+	for (n = 0; n < NDEVS; n++)
+		dev_create (n);
+
+	/* repeated small reads are served from the cache */
+	blkcache_register (&dev[0]);
+	check (dev[0].block_read != file_read);
+	check_read (0, 2, 1);
+	before = dev_reads[0];
+	for (i = 0; i < 100; i++)
+		check_read (0, 2, 1);
+	check (dev_reads[0] == before);
+
+	/* sequential reads: one driver call per read-ahead window */
+	before = dev_reads[0];
+	for (i = 0; i < 512; i++)
+		check_read (0, 1000 + i, 1);
+	printf ("512 sequential 1-block reads: %ld driver reads\n",
+		dev_reads[0] - before);
+	check (dev_reads[0] - before < 512 / 4);
+
+	/* large reads bypass the cache, reads past the end are short */
+	check_read (0, 3000, 64);
+	check_read (0, DEV_BLOCKS - 2, 4);
+
+	/* random reads on two devices */
+	blkcache_register (&dev[1]);
+	srand (1);
+	for (i = 0; i < 20000; i++) {
+		n = rand () & 1;
+		check_read (n, rand () % DEV_BLOCKS, 1 + rand () % 8);
+	}
+
+	/* invalidate drops cached data */
+	before = dev_reads[0];
+	check_read (0, 2, 1);
+	blkcache_invalidate (&dev[0]);
+	check_read (0, 2, 1);
+	check (dev_reads[0] > before);
+
+	/* more devices than slots: the least recently read one is evicted */
+	for (n = 2; n < NDEVS; n++) {
+		blkcache_register (&dev[n]);
+		check_read (n, 5, 1);
+	}
+	for (n = 0; n < NDEVS; n++)
+		check_read (n, 7, 2);
+
+	/* a device which went away gives its slot back silently */
+	dev[5].type = DEV_TYPE_UNKNOWN;
+	blkcache_register (&dev[0]);
+	check (dev[5].block_read == file_read);
+	check_read (0, 9, 1);
+
+	blkcache_stats ();
+
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
@@ -0,0 +1,307 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * fs/cramfs/cramfs.c and uncompress.c, with lib_generic/zlib.c, on an
+ * image made by mkfs.cramfs from a tree generated here: a large
+ * directory, a kernel of several hundred blocks, an empty file and a
+ * symlink. The image is in "flash" twice, once as made (sorted
+ * directories) and once without CRAMFS_FLAG_SORTED_DIRS, so that
+ * directories are scanned linearly. Every file is loaded from both
+ * and compared, names which aren't there must not be found. The time
+ * per lookup in the large directory with binary search and linear
+ * scan, and to load the kernel with the inflate context kept and set
+ * up for every file, are reported.
+ */
+#include <common.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <jffs2/load_kernel.h>
+#include <cramfs/cramfs_fs.h>
+
+#define IMG_MAX		(8 << 20)
+#define KERNEL_SIZE	(2 << 20)
+#define NLIBS		500
+#define LIB_SIZE(i)	(50 + (i) * 97 % 9000)
+#define LOOKUPS		20000
+#define LOADS		20
+
+int cramfs_load (char *loadoffset, struct part_info *info, char *filename);
+int cramfs_ls (struct part_info *info, char *filename);
+int cramfs_uncompress_exit (void);
+
+/* two flash banks with the image, sorted and unsorted */
+flash_info_t flash_info[2];
+static struct mtdids id[2];
+static struct mtd_device mtd[2];
+static struct part_info part[2];
+static u8 img[2][IMG_MAX];
+
+/* fs/jffs2/jffs2_1pass.c has the real one */
+char *mkmodestr (unsigned long mode, char *str)
+{
+	sprintf (str, "%06lo", mode);
+	return str;
+}
+
+static ulong mallocs;
+
+void *host_malloc (size_t size)
+{
+	mallocs++;
+	return malloc (size);
+}
+
+/* the contents of the generated tree */
+static u8 kernel[KERNEL_SIZE];
+static u8 *lib[NLIBS];
+static const char motd[] = "Welcome to U-Boot\n";
+
+/* something text-like, which compresses to about half */
+static void fill (u8 *buf, int size, u32 seed)
+{
+	static const char chars[] = "etaoin shrdlu\n.,";
+	u32 x = seed;
+	int i;
+
+	for (i = 0; i < size; i++) {
+		if (i % 8 == 0)
+			x = x * 1103515245 + 12345;
+		buf[i] = chars[(x >> (i % 8 * 2 + 8)) & 15];
+	}
+}
+
+static int put_file (const char *dir, const char *name, const void *data,
+		     int size)
+{
+	char path[256];
+	FILE *f;
+
+	sprintf (path, "%s/%s", dir, name);
+	f = fopen (path, "wb");
+	if (f == NULL)
+		return -1;
+	fwrite (data, 1, size, f);
+	fclose (f);
+	return 0;
+}
+
+/* generate the tree and make cramfs.img from it */
+static int make_image (void)
+{
+	char dir[] = "/tmp/test_cramfs.XXXXXX";
+	char path[256], name[32];
+	int i, err = 0;
+
+	if (mkdtemp (dir) == NULL) {
+		perror ("mkdtemp");
+		return -1;
+	}
+	sprintf (path, "%s/boot", dir);
+	mkdir (path, 0755);
+	sprintf (path, "%s/etc", dir);
+	mkdir (path, 0755);
+	sprintf (path, "%s/lib", dir);
+	mkdir (path, 0755);
+	err |= put_file (dir, "boot/uImage", kernel, KERNEL_SIZE);
+	sprintf (path, "%s/boot/vmlinux", dir);
+	err |= symlink ("uImage", path);
+	err |= put_file (dir, "etc/motd", motd, sizeof (motd) - 1);
+	err |= put_file (dir, "etc/empty", "", 0);
+	for (i = 0; i < NLIBS; i++) {
+		sprintf (name, "lib/lib%03d.so", i);
+		err |= put_file (dir, name, lib[i], LIB_SIZE (i));
+	}
+
+	sprintf (path, "mkfs.cramfs %s cramfs.img > /dev/null", dir);
+	if (!err)
+		err = system (path);
+	sprintf (path, "rm -rf %s", dir);
+	system (path);
+	return err;
+}
+
+static FILE *devnull;
+static int stdout_fd;
+
+static void quiet (int on)
+{
+	fflush (stdout);
+	if (on) {
+		stdout_fd = dup (1);
+		dup2 (fileno (devnull), 1);
+	} else {
+		dup2 (stdout_fd, 1);
+		close (stdout_fd);
+	}
+}
+
+static int load (int p, const char *path, u8 *buf)
+{
+	char name[256];			/* cramfs_load() strtok()s it */
+	int ret;
+
+	strcpy (name, path);
+	quiet (1);
+	ret = cramfs_load ((char *)buf, &part[p], name);
+	quiet (0);
+	return ret;
+}
+
+static void check_file (int p, const char *path, const u8 *data, int size)
+{
+	static u8 buf[KERNEL_SIZE + 4096];
+	int got;
+
+	memset (buf, 0, sizeof (buf));
+	got = load (p, path, buf);
+	if (got != size || memcmp (buf, data, size) != 0)
+		printf ("%s: %d bytes loaded, %d expected\n", path, got, size);
+	check (got == size && memcmp (buf, data, size) == 0);
+}
+
+static void check_fs (int p)
+{
+	static u8 buf[4096];
+	char name[32];
+	int i;
+
+	check_file (p, "/boot/uImage", kernel, KERNEL_SIZE);
+	check_file (p, "/etc/motd", motd, sizeof (motd) - 1);
+	check_file (p, "/etc/empty", NULL, 0);
+	for (i = 0; i < NLIBS; i++) {
+		sprintf (name, "/lib/lib%03d.so", i);
+		check_file (p, name, lib[i], LIB_SIZE (i));
+	}
+
+	/* before the first, between two, after the last entry */
+	check (load (p, "/lib/aaa", buf) == 0);
+	check (load (p, "/lib/lib000", buf) == 0);
+	check (load (p, "/lib/lib123.sox", buf) == 0);
+	check (load (p, "/lib/zzz", buf) == 0);
+	check (load (p, "/none/lib000.so", buf) == 0);
+	check (load (p, "/boot/vmlinux", buf) == 0);	/* no symlinks */
+
+	strcpy (name, "/boot");
+	quiet (1);
+	i = cramfs_ls (&part[p], name);
+	quiet (0);
+	check (i == 1);
+}
+
+/* microseconds per lookup of a name in /lib */
+static double lookup_time (int p)
+{
+	static u8 buf[4096];
+	char name[32];
+	clock_t t;
+	int i;
+
+	t = clock ();
+	for (i = 0; i < LOOKUPS; i++) {
+		/* missing, but only the last component */
+		sprintf (name, "/lib/lib%03d.sx", i % NLIBS);
+		load (p, name, buf);
+	}
+	t = clock () - t;
+	return (double)t * 1000000 / CLOCKS_PER_SEC / LOOKUPS;
+}
+
+/* milliseconds per load of the kernel */
+static double load_time (int p, int reinit, ulong *allocs)
+{
+	static u8 buf[KERNEL_SIZE + 4096];
+	clock_t t;
+	int i;
+
+	load (p, "/boot/uImage", buf);
+	mallocs = 0;
+	t = clock ();
+	for (i = 0; i < LOADS; i++) {
+		if (reinit)
+			cramfs_uncompress_exit ();
+		load (p, "/boot/uImage", buf);
+	}
+	t = clock () - t;
+	*allocs = mallocs;
+	return (double)t * 1000 / CLOCKS_PER_SEC / LOADS;
+}
+
+int main (int argc, char *argv[])
+{
+	struct cramfs_super *sb;
+	double sorted, linear, kept, reinit;
+	ulong kept_allocs, reinit_allocs;
+	FILE *f;
+	long size;
+	int i;
+
+	devnull = fopen ("/dev/null", "w");
+	fill (kernel, KERNEL_SIZE, 1);
+	for (i = 0; i < NLIBS; i++) {
+		lib[i] = malloc (LIB_SIZE (i));
+		fill (lib[i], LIB_SIZE (i), i + 2);
+	}
+
+	check (make_image () == 0);
+	f = fopen ("cramfs.img", "rb");
+	if (f == NULL) {
+		printf ("no image from mkfs.cramfs\nFAILED\n");
+		return 1;
+	}
+	size = fread (img[0], 1, IMG_MAX, f);
+	fclose (f);
+	check (size > 0 && size < IMG_MAX);
+	memcpy (img[1], img[0], size);
+	sb = (struct cramfs_super *)img[1];
+	check (sb->flags & CRAMFS_FLAG_SORTED_DIRS);
+	sb->flags &= ~CRAMFS_FLAG_SORTED_DIRS;
+
+	for (i = 0; i < 2; i++) {
+		flash_info[i].start[0] = (ulong)img[i];
+		id[i].num = i;
+		mtd[i].id = &id[i];
+		part[i].dev = &mtd[i];
+		part[i].offset = 0;
+		part[i].size = size;
+		check_fs (i);
+	}
+	printf ("%ld kB image, %d files in /lib\n", size / 1024, NLIBS);
+
+	sorted = lookup_time (0);
+	linear = lookup_time (1);
+	printf ("lookup in /lib: %.2f us binary search, %.2f us linear scan\n",
+		sorted, linear);
+
+	kept = load_time (0, 0, &kept_allocs);
+	reinit = load_time (0, 1, &reinit_allocs);
+	printf ("%d kB kernel: %.2f ms, %ld allocations to load with the "
+		"inflate context kept; %.2f ms, %ld setting it up for each "
+		"file\n", KERNEL_SIZE / 1024, kept, kept_allocs / LOADS,
+		reinit, reinit_allocs / LOADS);
+	/* zlib allocates per deflate block, the context once per file */
+	check (reinit_allocs >= kept_allocs + LOADS);
+
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
@@ -0,0 +1,424 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * common/deferred.c with test state machines, and the deferred bus scan
+ * of common/cmd_ide.c against simulated ATA drives which take a while to
+ * spin up after reset, all on the fake clock. The deferred scan must
+ * find the same drives as ide_init(), give up after the same time on a
+ * drive which never gets ready, and overlap the spin-up with the boot
+ * delay.
+ */
+#include <common.h>
+#include <unistd.h>
+#include <asm/io.h>
+#include <ide.h>
+#include <ata.h>
+#include <deferred.h>
+#include <command.h>
+
+#define BUS_PORTS	CFG_ATA_IDE1_OFFSET	/* I/O ports per bus */
+#define NEVER		(~0UL)
+#define RESET_WAIT	250	/* ide_reset() after releasing reset, in ms */
+
+extern block_dev_desc_t ide_dev_desc[CFG_IDE_MAXDEVICE];
+
+/* ------------------------------------------------------------------------- */
+
+/* the simulated drives */
+struct drive {
+	const char	*model;		/* NULL: no drive */
+	ulong		spinup;		/* ms from reset until ready */
+	ulong		sectors;
+};
+
+static struct drive drive[CFG_IDE_MAXDEVICE];
+static int in_reset;
+static ulong reset_at;
+static int selected[CFG_IDE_MAXBUS];
+static int transfer[CFG_IDE_MAXBUS];	/* DRQ: data to read */
+static ushort ident[CFG_IDE_MAXBUS][256];
+static int ident_pos[CFG_IDE_MAXBUS];
+
+void ide_set_reset (int on)
+{
+	in_reset = on;
+	reset_at = get_timer (0);
+}
+
+static uchar status (int bus)
+{
+	int dev = bus * 2 + selected[bus];
+
+	if (drive[dev].model == NULL)
+		return 0;
+	if (in_reset || get_timer (reset_at) < drive[dev].spinup)
+		return ATA_STAT_BUSY;
+	return ATA_STAT_READY | ATA_STAT_SEEK | (transfer[bus] ? ATA_STAT_DRQ : 0);
+}
+
+/* ATA strings have the first character of a pair in the high byte */
+static void ata_string (ushort *w, const char *s, int len)
+{
+	char buf[64];
+	int i;
+
+	memset (buf, ' ', len);
+	memcpy (buf, s, strlen (s));
+	for (i = 0; i < len; i += 2)
+		*w++ = (buf[i] << 8) | buf[i + 1];
+}
+
+static void identify (int bus)
+{
+	struct drive *d = &drive[bus * 2 + selected[bus]];
+	hd_driveid_t *id = (hd_driveid_t *)ident[bus];
+
+	memset (ident[bus], 0, sizeof (ident[bus]));
+	ata_string ((ushort *)id->model, d->model, sizeof (id->model));
+	ata_string ((ushort *)id->fw_rev, "1.0", sizeof (id->fw_rev));
+	ata_string ((ushort *)id->serial_no, "0815", sizeof (id->serial_no));
+	id->capability = 2;		/* LBA */
+	id->lba_capacity = d->sectors;
+	ident_pos[bus] = 0;
+}
+
+uchar inb (unsigned long port)
+{
+	int bus = port / BUS_PORTS;
+
+	switch (port % BUS_PORTS) {
+	case ATA_STATUS:
+		return status (bus);
+	case ATA_SECT_CNT:
+		return 0xff;		/* CHECK POWER MODE: active */
+	}
+	return 0;
+}
+
+void outb (uchar val, unsigned long port)
+{
+	int bus = port / BUS_PORTS;
+
+	switch (port % BUS_PORTS) {
+	case ATA_DEV_HD:
+		selected[bus] = (val & ATA_DEVICE(1)) != 0;
+		break;
+	case ATA_COMMAND:
+		transfer[bus] = 0;
+		if ((status (bus) & ATA_STAT_READY) == 0)
+			break;
+		if (val == ATA_CMD_IDENT) {
+			identify (bus);
+			transfer[bus] = 1;
+		} else if (val == ATA_CMD_READ) {
+			ident_pos[bus] = -1;	/* blank sectors */
+			transfer[bus] = 1;
+		}
+		break;
+	}
+}
+
+void insw (unsigned long port, void *buf, int words)
+{
+	int bus = port / BUS_PORTS;
+	ushort *p = buf;
+
+	while (words-- > 0) {
+		if (ident_pos[bus] >= 0 && ident_pos[bus] < 256)
+			*p++ = ident[bus][ident_pos[bus]++];
+		else
+			*p++ = 0;
+	}
+}
+
+void outsw (unsigned long port, const void *buf, int words)
+{
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* U-Boot functions cmd_ide.c refers to, not used here */
+void flush_cache (ulong start, ulong size)
+{
+}
+
+void print_image_hdr (struct image_header *hdr)
+{
+}
+
+int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	return 1;
+}
+
+/* lib_generic/string.c */
+char *strswab (const char *s)
+{
+	char *p, tmp;
+
+	if ((NULL == s) || ('\0' == *s))
+		return (NULL);
+
+	for (p = (char *)s; ((p[0] != '\0') && (p[1] != '\0')); p += 2) {
+		tmp = p[0];
+		p[0] = p[1];
+		p[1] = tmp;
+	}
+
+	return (char *)s;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static FILE *devnull;
+static int stdout_fd;
+
+static void quiet (int on)
+{
+	fflush (stdout);
+	if (on) {
+		stdout_fd = dup (1);
+		dup2 (fileno (devnull), 1);
+	} else {
+		dup2 (stdout_fd, 1);
+		close (stdout_fd);
+	}
+}
+
+/* test state machines: 'steps' steps 'sleep' ms apart */
+struct machine {
+	deferred_init_t	di;
+	int		steps;
+	ulong		sleep;
+	int		calls;
+	ulong		last;		/* get_timer() at the last call */
+	int		early;		/* calls before the wake time */
+	int		nested;		/* deferred_init_poll() from a step */
+};
+
+static char order[32];		/* names of the steps, in calling order */
+
+static int machine_step (deferred_init_t *di)
+{
+	struct machine *m = di->priv;
+
+	if (m->calls && get_timer (m->last) < m->sleep)
+		m->early++;
+	m->calls++;
+	m->last = get_timer (0);
+	strncat (order, di->name, sizeof (order) - strlen (order) - 1);
+	m->nested += deferred_init_poll ();
+	if (++di->state == m->steps)
+		return DEFERRED_DONE;
+	deferred_init_sleep (di, m->sleep);
+	return DEFERRED_BUSY;
+}
+
+static void machine_init (struct machine *m, const char *name,
+			  int steps, ulong sleep)
+{
+	memset (m, 0, sizeof (*m));
+	m->di.name = name;
+	m->di.step = machine_step;
+	m->di.priv = m;
+	m->steps = steps;
+	m->sleep = sleep;
+}
+
+/* the autoboot countdown: poll every 10 ms */
+static void boot_delay (ulong ms)
+{
+	ulong i;
+
+	for (i = 0; i < ms / 10; i++) {
+		deferred_init_poll ();
+		udelay (10000);
+	}
+}
+
+static void test_deferred (void)
+{
+	struct machine a, b, c;
+	ulong t;
+
+	/* steps run in registration order, never before their wake time */
+	machine_init (&a, "a", 5, 100);
+	machine_init (&b, "b", 3, 250);
+	deferred_init_register (&a.di);
+	deferred_init_register (&b.di);
+	deferred_init_register (&a.di);		/* not linked twice */
+	check (deferred_init_poll () == 2);
+	check (strcmp (order, "ab") == 0);
+	check (deferred_init_poll () == 2);	/* nothing due */
+	check (a.calls == 1 && b.calls == 1);
+	boot_delay (1000);
+	check (deferred_init_poll () == 0);
+	check (a.calls == 5 && b.calls == 3);
+	check (a.early == 0 && b.early == 0);
+	check (a.nested == 0 && b.nested == 0);
+	check (strcmp (order, "abaabaab") == 0);
+
+	/* waiting for one entry leaves the others pending */
+	order[0] = '\0';
+	machine_init (&a, "a", 2, 100);
+	machine_init (&c, "c", 20, 500);
+	deferred_init_register (&c.di);
+	deferred_init_register (&a.di);
+	t = get_timer (0);
+	deferred_init_wait (&a.di);
+	check (a.calls == 2);
+	check (get_timer (t) >= 100 && get_timer (t) < 200);
+	check (deferred_init_poll () == 1);
+
+	/* and waiting for all of them runs them to completion */
+	deferred_init_wait (NULL);
+	check (c.calls == 20);
+	check (get_timer (t) >= 19 * 500 && get_timer (t) < 19 * 500 + 100);
+	check (c.early == 0);
+	check (deferred_init_poll () == 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct result {
+	int	type[CFG_IDE_MAXDEVICE];
+	ulong	lba[CFG_IDE_MAXDEVICE];
+	char	vendor[CFG_IDE_MAXDEVICE][41];
+};
+
+static void save (struct result *r)
+{
+	int i;
+
+	memset (r, 0, sizeof (*r));
+	for (i = 0; i < CFG_IDE_MAXDEVICE; i++) {
+		r->type[i] = ide_dev_desc[i].type;
+		r->lba[i] = ide_dev_desc[i].lba;
+		strcpy (r->vendor[i], ide_dev_desc[i].vendor);
+	}
+}
+
+/* ide_init() followed by the boot delay */
+static ulong scan_sync (ulong delay, struct result *r)
+{
+	ulong t = get_timer (0);
+
+	quiet (1);
+	ide_init ();
+	quiet (0);
+	save (r);
+	udelay (delay * 1000);
+	return get_timer (t);
+}
+
+/*
+ * ide_init_deferred(), the boot delay, and the first command after
+ * 'delay' ms, which waits for the scan to finish
+ */
+static ulong scan_deferred (ulong delay, struct result *r)
+{
+	ulong t = get_timer (0);
+
+	quiet (1);
+	ide_init_deferred ();
+	boot_delay (delay);
+	deferred_init_wait (NULL);
+	quiet (0);
+	save (r);
+	return get_timer (t);
+}
+
+static void set_drives (ulong spinup0, ulong spinup1)
+{
+	memset (drive, 0, sizeof (drive));
+	drive[0].model = "SIM HD-0";
+	drive[0].spinup = spinup0;
+	drive[0].sectors = 1000000;
+	drive[2].model = "SIM HD-2";
+	drive[2].spinup = spinup1;
+	drive[2].sectors = 2000000;
+	drive[3].model = "SIM CF-3";
+	drive[3].spinup = 0;
+	drive[3].sectors = 64000;
+}
+
+static void test_ide (void)
+{
+	struct result rs, rd;
+	ulong ts, td;
+
+	/* two busses, the slowest drive needs 4 s */
+	set_drives (2500, 4000);
+	ts = scan_sync (3000, &rs);
+	td = scan_deferred (3000, &rd);
+	printf ("drives ready 4 s after reset, 3 s boot delay: first command "
+		"after %ld ms, %ld ms deferred\n", ts, td);
+	check (rs.type[0] == DEV_TYPE_HARDDISK && rs.lba[0] == 1000000);
+	check (strcmp (rs.vendor[0], "SIM HD-0") == 0);
+	check (rs.type[1] == DEV_TYPE_UNKNOWN);
+	check (rs.type[2] == DEV_TYPE_HARDDISK && rs.lba[2] == 2000000);
+	check (rs.type[3] == DEV_TYPE_HARDDISK && rs.lba[3] == 64000);
+	check (memcmp (&rs, &rd, sizeof (rs)) == 0);
+	check (td >= 4000 && td < 4000 + 100);
+	check (ts >= 4000 + 3000);
+
+	/* with a longer boot delay, the scan costs nothing */
+	td = scan_deferred (5000, &rd);
+	check (memcmp (&rs, &rd, sizeof (rs)) == 0);
+	check (td >= RESET_WAIT + 5000 && td < RESET_WAIT + 5000 + 50);
+
+	/* a key pressed at once: the command waits for the drives */
+	td = scan_deferred (0, &rd);
+	check (memcmp (&rs, &rd, sizeof (rs)) == 0);
+	check (td >= 4000 && td < 4000 + 100);
+
+	/* a drive which never gets ready: both give up after the same time */
+	set_drives (NEVER, 1000);
+	ts = scan_sync (0, &rs);
+	td = scan_deferred (0, &rd);
+	printf ("drive never ready: ide_init() gives up after %ld ms, "
+		"deferred after %ld ms\n", ts, td);
+	check (memcmp (&rs, &rd, sizeof (rs)) == 0);
+	check (rs.type[0] == DEV_TYPE_UNKNOWN && rs.type[2] == DEV_TYPE_UNKNOWN);
+	check (ts >= ATA_RESET_TIME * 1000);
+	check (td + 1000 > ts && td < ts + 1000);
+
+	/* no drives */
+	memset (drive, 0, sizeof (drive));
+	ts = scan_sync (0, &rs);
+	td = scan_deferred (0, &rd);
+	check (memcmp (&rs, &rd, sizeof (rs)) == 0);
+	check (rs.type[0] == DEV_TYPE_UNKNOWN && rs.type[2] == DEV_TYPE_UNKNOWN);
+	check (td < 1000);
+}
+
+int main (void)
+{
+	devnull = fopen ("/dev/null", "w");
+
+	test_deferred ();
+	test_ide ();
+
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
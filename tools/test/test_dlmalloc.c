@@ -0,0 +1,146 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * common/dlmalloc.c, built with a "dl" prefix and CFG_MALLOC_NO_CLEAR,
+ * on an sbrk() arena which, as after a reset, holds garbage. 200000
+ * random malloc(), calloc(), realloc() and free() calls are made;
+ * every calloc() result must be zero filled and every live block must
+ * keep its contents.
+ *
+ * Built without CFG_MALLOC_NO_CLEAR on a zeroed arena the same run
+ * finds a few dirty calloc() results: memory that malloc_trim() gave
+ * back through sbrk() and got again is not zero any more.
+ */
+#include <common.h>
+#include <malloc.h>
+
+#define ARENA_SIZE	(1 << 20)
+#define NBLOCKS		256
+#define ROUNDS		200000
+
+static char arena[ARENA_SIZE] __attribute__((aligned(16)));
+static ulong mem_malloc_start, mem_malloc_end, mem_malloc_brk;
+
+/* as in lib_ppc/board.c */
+static void mem_malloc_init (void)
+{
+	mem_malloc_start = (ulong)arena;
+	mem_malloc_end = mem_malloc_start + ARENA_SIZE;
+	mem_malloc_brk = mem_malloc_start;
+
+	/* whatever the RAM held before */
+	memset (arena, 0xa5, sizeof (arena));
+#ifndef CFG_MALLOC_NO_CLEAR
+	memset ((void *) mem_malloc_start, 0,
+			mem_malloc_end - mem_malloc_start);
+#endif
+}
+
+void *sbrk (ptrdiff_t increment)
+{
+	ulong old = mem_malloc_brk;
+	ulong new = old + increment;
+
+	if ((new < mem_malloc_start) || (new > mem_malloc_end)) {
+		return (NULL);
+	}
+	mem_malloc_brk = new;
+	return ((void *) old);
+}
+
+static struct {
+	unsigned char *p;
+	size_t size;
+	unsigned char fill;
+} blk[NBLOCKS];
+
+static int check_block (int k)
+{
+	size_t j;
+
+	for (j = 0; j < blk[k].size; j++)
+		if (blk[k].p[j] != blk[k].fill)
+			return 0;
+	return 1;
+}
+
+int main (int argc, char *argv[])
+{
+	int i, k, callocs = 0, dirty = 0, corrupt = 0;
+	size_t size;
+
+	mem_malloc_init ();
+	srand (1);
+
+	for (i = 0; i < ROUNDS; i++) {
+		k = rand () % NBLOCKS;
+		size = 1 + rand () % ((rand () & 7) ? 200 : 20000);
+
+		if (blk[k].p) {
+			if (!check_block (k))
+				corrupt++;
+			if (rand () & 3) {
+				dlfree (blk[k].p);
+				blk[k].p = NULL;
+				continue;
+			}
+			/* grow or shrink, keeping the common part */
+			blk[k].p = dlrealloc (blk[k].p, size);
+			if (!blk[k].p)
+				continue;
+			if (size > blk[k].size)
+				memset (blk[k].p + blk[k].size, blk[k].fill,
+					size - blk[k].size);
+			blk[k].size = size;
+			continue;
+		}
+
+		blk[k].size = size;
+		if (rand () & 1) {
+			blk[k].p = dlcalloc (1, size);
+			blk[k].fill = 0;
+			if (!blk[k].p)
+				continue;
+			callocs++;
+			if (!check_block (k))
+				dirty++;
+			/* reused memory is dirty too */
+			blk[k].fill = 0x5a;
+		} else {
+			blk[k].p = dlmalloc (size);
+			blk[k].fill = rand ();
+			if (!blk[k].p)
+				continue;
+		}
+		memset (blk[k].p, blk[k].fill, size);
+	}
+
+	printf ("%d calloc()s, %d returned dirty memory, %lu kB in use\n",
+		callocs, dirty, (mem_malloc_brk - mem_malloc_start) >> 10);
+	check (callocs > 0);
+	check (dirty == 0);
+	check (corrupt == 0);
+
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
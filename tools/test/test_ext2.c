@@ -0,0 +1,292 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * fs/ext2/ext2fs.c and dev.c on file-backed block devices with images
+ * made by e2fsprogs from a tree generated here: a module directory
+ * with 3000 short and 3000 long names, some of them with non-ASCII
+ * characters (their hash depends on the signedness of char), and a
+ * kernel in indirect blocks. mke2fs -d builds the image, debugfs sets
+ * the hash flags and checks the index e2fsck -D made: half MD4, TEA
+ * and legacy hashes, signed and unsigned, 1 kB blocks (two index
+ * levels) and 4 kB blocks (one), and the directory without an index.
+ * Every file is opened and its contents compared. The device reads
+ * per lookup in the module directory are reported for each image.
+ */
+#include <common.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <ext2fs.h>
+
+#define IMG		"ext2.img"
+#define NMODS		3000
+#define KERNEL_SIZE	(300 * 1024)
+
+static FILE *dev_file;
+static ulong dev_reads;
+static block_dev_desc_t dev;
+
+static ulong file_read (int n, ulong start, lbaint_t blkcnt, ulong *buffer)
+{
+	dev_reads++;
+	fseek (dev_file, (long)start * SECTOR_SIZE, SEEK_SET);
+	return fread (buffer, SECTOR_SIZE, blkcnt, dev_file);
+}
+
+/* the file system is on the whole device, partition 0 */
+int get_partition_info (block_dev_desc_t *dev_desc, int part,
+			disk_partition_t *info)
+{
+	return -1;
+}
+
+/* the generated tree */
+static u8 kernel[KERNEL_SIZE];
+
+static void mod_name (char *name, int i, int kind)
+{
+	if (kind == 0)
+		sprintf (name, "module_%d.ko", i);
+	else if (i % 2)
+		sprintf (name, "module_with_a_rather_long_name_%d.ko", i);
+	else
+		sprintf (name, "mod\xc3\xbcl\xc3\xa9_%d.ko", i);	/* UTF-8 */
+}
+
+static int put_file (const char *path, const void *data, int size)
+{
+	FILE *f = fopen (path, "wb");
+
+	if (f == NULL)
+		return -1;
+	fwrite (data, 1, size, f);
+	fclose (f);
+	return 0;
+}
+
+static int make_tree (const char *dir)
+{
+	char path[256], name[64];
+	int i, kind, err = 0;
+
+	sprintf (path, "%s/boot", dir);
+	mkdir (path, 0755);
+	sprintf (path, "%s/lib", dir);
+	mkdir (path, 0755);
+	sprintf (path, "%s/lib/modules", dir);
+	mkdir (path, 0755);
+	sprintf (path, "%s/boot/vmlinux", dir);
+	err |= put_file (path, kernel, KERNEL_SIZE);
+	for (i = 0; i < NMODS; i++) {
+		for (kind = 0; kind < 2; kind++) {
+			mod_name (name, i, kind);
+			sprintf (path, "%s/lib/modules/%s", dir, name);
+			err |= put_file (path, name, strlen (name));
+		}
+	}
+	return err;
+}
+
+/* run an e2fsprogs command line quietly */
+static int run (const char *fmt, const char *arg)
+{
+	char cmd[512];
+
+	sprintf (cmd, fmt, arg);
+	strcat (cmd, " > /dev/null 2>&1");
+	return system (cmd);
+}
+
+/* what debugfs says about the index of /lib/modules: hash version and
+   levels, -1 without index */
+static int htree_info (int *levels)
+{
+	char line[256];
+	FILE *p;
+	int version = -1;
+
+	*levels = -1;
+	p = popen ("debugfs -R 'htree /lib/modules' " IMG " 2> /dev/null", "r");
+	if (p == NULL)
+		return -1;
+	while (fgets (line, sizeof (line), p)) {
+		sscanf (line, "%*[ \t]Hash Version: %d", &version);
+		sscanf (line, "%*[ \t]Indirect levels: %d", levels);
+	}
+	pclose (p);
+	return version;
+}
+
+static FILE *devnull;
+static int stdout_fd;
+
+static void quiet (int on)
+{
+	fflush (stdout);
+	if (on) {
+		stdout_fd = dup (1);
+		dup2 (fileno (devnull), 1);
+	} else {
+		dup2 (stdout_fd, 1);
+		close (stdout_fd);
+	}
+}
+
+static int mount (void)
+{
+	long size;
+
+	if (dev_file)
+		fclose (dev_file);
+	dev_file = fopen (IMG, "rb");
+	if (dev_file == NULL)
+		return 0;
+	fseek (dev_file, 0, SEEK_END);
+	size = ftell (dev_file);
+	memset (&dev, 0, sizeof (dev));
+	dev.if_type = IF_TYPE_IDE;
+	dev.type = DEV_TYPE_HARDDISK;
+	dev.blksz = SECTOR_SIZE;
+	dev.lba = size / SECTOR_SIZE;
+	dev.block_read = file_read;
+	ext2fs_close ();
+	return ext2fs_mount (ext2fs_set_blk_dev (&dev, 0));
+}
+
+static int check_file (const char *path, const void *data, int size)
+{
+	static u8 buf[KERNEL_SIZE];
+	char name[256];
+	int got = -1;
+
+	strcpy (name, path);
+	memset (buf, 0, sizeof (buf));
+	quiet (1);
+	if (ext2fs_open (name) == size)
+		got = ext2fs_read ((char *)buf, size);
+	quiet (0);
+	if (got != size || memcmp (buf, data, size) != 0) {
+		printf ("%s: %d bytes loaded, %d expected\n", path, got, size);
+		return 1;
+	}
+	return 0;
+}
+
+/* load every file, return the device reads per module lookup */
+static double check_fs (void)
+{
+	char name[64], path[128];
+	ulong reads = 0;
+	int i, kind, bad = 0;
+
+	check (mount ());
+	bad += check_file ("/boot/vmlinux", kernel, KERNEL_SIZE);
+	for (i = 0; i < NMODS; i++) {
+		for (kind = 0; kind < 2; kind++) {
+			mod_name (name, i, kind);
+			sprintf (path, "/lib/modules/%s", name);
+			dev_reads = 0;
+			bad += check_file (path, name, strlen (name));
+			reads += dev_reads;
+		}
+	}
+	check (bad == 0);
+
+	strcpy (path, "/lib/modules/nothere.ko");
+	quiet (1);
+	i = ext2fs_open (path);
+	quiet (0);
+	check (i < 0);
+	return (double)reads / (2 * NMODS);
+}
+
+static const struct image {
+	const char	*desc;
+	const char	*mke2fs;	/* options */
+	const char	*hash;		/* tune2fs -E hash_alg= */
+	int		flags;		/* EXT2_FLAGS_(UN)SIGNED_HASH */
+	int		version;	/* expected from debugfs */
+	int		levels;
+} images[] = {
+	{ "1 kB, half MD4, signed",	"-b 1024", "half_md4", 1, 1, 1 },
+	{ "1 kB, half MD4, unsigned",	"-b 1024", "half_md4", 2, 1, 1 },
+	{ "1 kB, TEA, signed",		"-b 1024", "tea", 1, 2, 1 },
+	{ "1 kB, TEA, unsigned",	"-b 1024", "tea", 2, 2, 1 },
+	{ "1 kB, legacy, signed",	"-b 1024", "legacy", 1, 0, 1 },
+	{ "1 kB, legacy, unsigned",	"-b 1024", "legacy", 2, 0, 1 },
+	{ "4 kB, half MD4, signed",	"-b 4096", "half_md4", 1, 1, 0 },
+	{ "1 kB, no index",		"-b 1024", NULL, 0, -1, -1 },
+};
+#define NIMAGES		(sizeof (images) / sizeof (images[0]))
+
+int main (int argc, char *argv[])
+{
+	char dir[] = "/tmp/test_ext2.XXXXXX";
+	char opt[256];
+	const struct image *im;
+	double reads[NIMAGES];
+	int i, version, levels;
+
+	devnull = fopen ("/dev/null", "w");
+	for (i = 0; i < KERNEL_SIZE; i++)
+		kernel[i] = (u8)(i * 7 + (i >> 10));
+
+	if (mkdtemp (dir) == NULL) {
+		perror ("mkdtemp");
+		return 1;
+	}
+	check (make_tree (dir) == 0);
+
+	for (i = 0; i < NIMAGES; i++) {
+		im = &images[i];
+		sprintf (opt, "mke2fs -q -F -t ext2 %s -I 128 -N 8000 "
+			 "-O %sdir_index -d %%s " IMG " 64M", im->mke2fs,
+			 im->hash ? "" : "^");
+		check (run (opt, dir) == 0);
+		if (im->hash) {
+			check (run ("tune2fs -E hash_alg=%s " IMG, im->hash) == 0);
+			sprintf (opt, "%d", im->flags);
+			check (run ("debugfs -w -R 'ssv flags %s' " IMG, opt) == 0);
+			/* index all directories with the new hash */
+			run ("e2fsck -fyD " IMG, NULL);
+		}
+		version = htree_info (&levels);
+		if (version != im->version || levels != im->levels)
+			printf ("%s: debugfs reports hash version %d, %d "
+				"levels\n", im->desc, version, levels);
+		check (version == im->version && levels == im->levels);
+
+		reads[i] = check_fs ();
+		printf ("%-26s %5.1f device reads per lookup\n", im->desc,
+			reads[i]);
+	}
+	ext2fs_close ();
+	sprintf (opt, "rm -rf %s", dir);
+	system (opt);
+
+	/* the index must save most of the directory scan */
+	for (i = 0; i < NIMAGES - 1; i++)
+		check (reads[i] * 10 < reads[NIMAGES - 1]);
+
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * board/linkstation/checksum.c on synthetic firmimg.bin images: a
+ * firminfo header followed by random "kernel" and "initrd" data, with
+ * the chksum word set so that the whole image sums to zero. The sum
+ * with and without copying is checked against a plain word-by-word
+ * reference for every length of the tail, copies against the source,
+ * and a corrupted image must not sum to zero.
+ */
+#include <common.h>
+
+#include "../../board/linkstation/firminfo.h"
+
+#define MAXSIZE		(3 << 20)
+#define INFO_SIZE	0x60		/* firminfo as laid out on the target */
+#define INFO_CHKSUM	84		/* offset of chksum in the header */
+
+static u32 image[MAXSIZE / 4 + 8];
+static u32 copy[MAXSIZE / 4 + 16];
+
+/* the checksum as the original loader computed it */
+static u32 reference_sum(const unsigned char *addr, u32 size)
+{
+	u32 sum = 0, remain = 0, w;
+	int i;
+
+	for (; size >= 4; size -= 4, addr += 4) {
+		memcpy(&w, addr, 4);
+		sum += w;
+	}
+	for (i = 0; i < 4; i++)
+		remain = (remain << 8) + (i < size ? addr[i] : 0);
+	return sum + remain;
+}
+
+static void make_image(u32 size)
+{
+	unsigned char *p = (unsigned char *)image;
+	u32 i, sum;
+
+	srand(size);
+	for (i = 0; i < size; i++)
+		p[i] = rand();
+	memset(p, 0, INFO_SIZE);
+	strcpy((char *)p + 8, "HD-HGLAN");
+	memcpy(p + 80, &size, 4);
+	sum = reference_sum(p, size);
+	sum = -sum;
+	memcpy(p + INFO_CHKSUM, &sum, 4);
+}
+
+static void test_size(u32 size)
+{
+	unsigned char *p = (unsigned char *)image;
+	unsigned char *c;
+	int off;
+
+	make_image(size);
+	check(reference_sum(p, size) == 0);
+	check(checksum_check(p, size) == 0);
+
+	/* aligned and unaligned copies, nothing written past the end */
+	for (off = 0; off < 32; off += 4) {
+		c = (unsigned char *)copy + off;
+		memset(copy, 0xa5, sizeof(copy));
+		check(checksum_copy((u32 *)c, image, size) == 0);
+		check(memcmp(c, p, size) == 0);
+		check(c[size] == 0xa5 && c[size + 1] == 0xa5);
+		check(off == 0 || c[-1] == 0xa5);
+	}
+
+	/* a flipped bit anywhere, also in the tail, breaks the sum */
+	p[size - 1] ^= 0x10;
+	check(checksum_check(p, size) != 0);
+	check(checksum_copy(copy, image, size) != 0);
+	p[size - 1] ^= 0x10;
+	p[size / 2] ^= 0x01;
+	check(checksum_check(p, size) == reference_sum(p, size));
+	check(checksum_check(p, size) != 0);
+}
+
+int main(int argc, char *argv[])
+{
+	u32 sizes[] = { 96, 97, 98, 99, 100, 127, 128, 129, 4095,
+			65536, 65539, 1000001, MAXSIZE - 1, MAXSIZE };
+	int i, n = 0;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++, n++)
+		test_size(sizes[i]);
+	for (i = INFO_SIZE; i < INFO_SIZE + 64; i++, n++)
+		test_size(i);
+
+	printf("%d images checked\n", n);
+	printf("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * common/hush.c fed a scripted session (hush.script) with a handful of
+ * commands: echo, setenv, run (as in common/main.c), inc, lt, eq and
+ * ctrlc, which makes the next ctrlc() poll see a Ctrl-C. The output
+ * must match hush.out, which the build without CFG_HUSH_RUN_CACHE
+ * produces, byte for byte. The script covers recursive run, setenv of
+ * the variable running, for loops aborted by Ctrl-C, exit, local
+ * assignments, if/elif, && and ||, more variables than cache entries
+ * and IFS.
+ *
+ * A "#bench N" line times N runs of "run probe" and reports it
+ * outside the compared output.
+ */
+#include <common.h>
+#include <command.h>
+#include <hush.h>
+#include <time.h>
+#include <unistd.h>
+
+char console_buffer[CFG_CBSIZE];
+
+static int quiet;
+
+int readline (const char *const prompt)
+{
+	return -1;
+}
+
+static int do_echo (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	int i;
+
+	if (quiet)
+		return 0;
+	for (i = 1; i < argc; i++)
+		printf ("%s%s", i > 1 ? " " : "", argv[i]);
+	putc ('\n');
+	return 0;
+}
+
+static int do_setenv (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	char buf[CFG_CBSIZE] = "";
+	int i;
+
+	for (i = 2; i < argc; i++) {
+		if (i > 2)
+			strcat (buf, " ");
+		strcat (buf, argv[i]);
+	}
+	return setenv (argv[1], argc > 2 ? buf : NULL);
+}
+
+/* common/main.c */
+static int do_run (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	int i;
+
+	if (argc < 2) {
+		printf ("Usage:\n%s\n", cmdtp->usage);
+		return 1;
+	}
+
+	for (i=1; i<argc; ++i) {
+		char *arg;
+
+		if ((arg = getenv (argv[i])) == NULL) {
+			printf ("## Error: \"%s\" not defined\n", argv[i]);
+			return 1;
+		}
+#ifdef CFG_HUSH_RUN_CACHE
+		if (parse_run_cached(argv[i], arg,
+		    FLAG_PARSE_SEMICOLON | FLAG_EXIT_FROM_LOOP) != 0)
+			return 1;
+#else
+		if (parse_string_outer(arg,
+		    FLAG_PARSE_SEMICOLON | FLAG_EXIT_FROM_LOOP) != 0)
+			return 1;
+#endif
+	}
+	return 0;
+}
+
+static int do_inc (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	char buf[16];
+	char *s = getenv (argv[1]);
+
+	sprintf (buf, "%lu", (s ? simple_strtoul (s, NULL, 10) : 0) + 1);
+	return setenv (argv[1], buf);
+}
+
+static int do_lt (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	return !(simple_strtoul (argv[1], NULL, 10) <
+		 simple_strtoul (argv[2], NULL, 10));
+}
+
+static int do_eq (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	return strcmp (argv[1], argv[2]) != 0;
+}
+
+static int do_ctrlc (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	host_ctrlc (0);
+	return 0;
+}
+
+static cmd_tbl_t cmd_tbl[] = {
+	{ "echo",	CFG_MAXARGS,	1,	do_echo,	"echo"	},
+	{ "setenv",	CFG_MAXARGS,	0,	do_setenv,	"setenv" },
+	{ "run",	CFG_MAXARGS,	1,	do_run,		"run var [...]" },
+	{ "inc",	2,		0,	do_inc,		"inc var" },
+	{ "lt",		3,		0,	do_lt,		"lt a b" },
+	{ "eq",		3,		0,	do_eq,		"eq a b" },
+	{ "ctrlc",	1,		0,	do_ctrlc,	"ctrlc" },
+};
+
+cmd_tbl_t *find_cmd (const char *cmd)
+{
+	int i;
+
+	for (i = 0; i < sizeof (cmd_tbl) / sizeof (cmd_tbl[0]); i++)
+		if (strcmp (cmd_tbl[i].name, cmd) == 0)
+			return &cmd_tbl[i];
+	return NULL;
+}
+
+static void bench (int n)
+{
+	char cmd[] = "run probe";
+	clock_t t;
+	int i;
+
+	quiet = 1;
+	t = clock ();
+	for (i = 0; i < n; i++)
+		parse_string_outer (cmd, FLAG_PARSE_SEMICOLON | FLAG_EXIT_FROM_LOOP);
+	t = clock () - t;
+	quiet = 0;
+	fprintf (stderr, "%d x \"run probe\": %.1f us/run\n", n,
+		 (double)t * 1000000 / CLOCKS_PER_SEC / n);
+}
+
+/* compare what is in out from the current position with file name */
+static int compare (FILE *out, const char *name)
+{
+	FILE *f = fopen (name, "r");
+	int a, b, line = 1;
+
+	if (f == NULL) {
+		perror (name);
+		return 0;
+	}
+	do {
+		a = fgetc (out);
+		b = fgetc (f);
+		if (a != b) {
+			printf ("output differs from %s at line %d\n",
+				name, line);
+			break;
+		}
+		if (a == '\n')
+			line++;
+	} while (a != EOF);
+	fclose (f);
+	return a == b;
+}
+
+int main (int argc, char *argv[])
+{
+	const char *script = argc > 1 ? argv[1] : "hush.script";
+	const char *expect = argc > 2 ? argv[2] : "hush.out";
+	char line[CFG_CBSIZE];
+	FILE *in, *out;
+	int fd;
+
+	in = fopen (script, "r");
+	out = tmpfile ();
+	if (in == NULL || out == NULL) {
+		perror (script);
+		return 1;
+	}
+
+	/* the session goes to out, bench results to stderr */
+	fflush (stdout);
+	fd = dup (1);
+	dup2 (fileno (out), 1);
+
+	u_boot_hush_start ();
+	while (fgets (line, sizeof (line), in)) {
+		line[strcspn (line, "\n")] = '\0';
+		if (strncmp (line, "#bench ", 7) == 0) {
+			fflush (stdout);
+			bench (simple_strtoul (line + 7, NULL, 10));
+			continue;
+		}
+		clear_ctrlc ();
+		printf ("=> %s\n", line);
+		parse_string_outer (line, FLAG_PARSE_SEMICOLON |
+					  FLAG_EXIT_FROM_LOOP);
+	}
+	fclose (in);
+
+	fflush (stdout);
+	dup2 (fd, 1);
+	close (fd);
+
+	rewind (out);
+	check (compare (out, expect));
+	fclose (out);
+
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
@@ -0,0 +1,574 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * fs/jffs2/jffs2_1pass.c on a file-backed NAND simulator. The images are
+ * generated here (there is no mkfs.jffs2/sumtool on the build host):
+ * directories, a file written in several nodes, relative and absolute
+ * symlinks, a replaced entry, with and without erase block summaries, and
+ * with summaries whose records point outside their erase block. Every
+ * file is loaded and compared. The NAND reads of the cache in front of
+ * the simulator are logged per cache line.
+ *
+ *	test_jffs2 [image [erasesize]]
+ *
+ * scans an image made elsewhere instead and lists its root directory.
+ */
+#include <common.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <linux/stat.h>
+#include <linux/mtd/nand.h>
+#include <jffs2/jffs2.h>
+#include <jffs2/load_kernel.h>
+#include "../../fs/jffs2/summary.h"
+
+#define ERASESIZE	(16 * 1024)
+#define BLOCKS		32
+#define IMG_SIZE	(BLOCKS * ERASESIZE)
+#define PART_OFFSET	ERASESIZE	/* the partition starts at block 1 */
+#define FRAG_SIZE	4096
+#define KERNEL_SIZE	(10 * FRAG_SIZE + 123)
+#define NLIBS		200
+
+#ifndef NAND_CACHE_PAGES
+#define NAND_CACHE_PAGES 64		/* as in jffs2_1pass.c */
+#endif
+#define LINE_SIZE	(4 * 512)	/* NAND_CACHE_LINE_PAGES pages */
+#define CACHE_LINES	(NAND_CACHE_PAGES / 4)
+
+extern void jffs2_free_cache (struct part_info *part);
+
+/* the generated images are not compressed */
+void rtime_decompress (unsigned char *data_in, unsigned char *cpage_out,
+		       u32 srclen, u32 destlen)
+{
+	check (0);
+}
+
+void dynrubin_decompress (unsigned char *data_in, unsigned char *cpage_out,
+			  unsigned long sourcelen, unsigned long dstlen)
+{
+	check (0);
+}
+
+long zlib_decompress (unsigned char *data_in, unsigned char *cpage_out,
+		      __u32 srclen, __u32 destlen)
+{
+	check (0);
+	return -1;
+}
+
+/* the simulated NAND chip */
+struct nand_chip nand_dev_desc[CFG_MAX_NAND_DEVICE];
+static FILE *nand_file;
+static ulong nand_size;
+static ulong nand_reads;
+static ulong nand_bytes;
+static u8 line_reads[(PART_OFFSET + IMG_SIZE) / LINE_SIZE];
+
+int read_jffs2_nand (size_t start, size_t len, size_t *retlen,
+		     u_char *buf, int nanddev)
+{
+	nand_reads++;
+	nand_bytes += len;
+	if (start / LINE_SIZE < sizeof (line_reads))
+		line_reads[start / LINE_SIZE]++;
+	/* the cache reads whole lines */
+	check (start % LINE_SIZE == 0 && len == LINE_SIZE);
+	*retlen = 0;
+	if (nanddev != 0 || start + len > nand_size)
+		return -1;
+	fseek (nand_file, start, SEEK_SET);
+	*retlen = fread (buf, 1, len, nand_file);
+	return *retlen == len ? 0 : -1;
+}
+
+static struct mtdids nand_id;
+static struct mtd_device nand_mtd;
+static struct part_info part;
+
+/* the image being generated */
+static u8 img[IMG_SIZE];
+static u32 cur;			/* next free byte */
+static u32 blocks;		/* erase blocks used */
+static u32 version;
+static int summaries;		/* write erase block summaries */
+static u8 sum[ERASESIZE];	/* summary records of the current block */
+static u32 sum_len, sum_num;
+static u32 bad_block;		/* block whose first record is broken... */
+static u32 bad_offset;		/* ...by pointing it here */
+
+#define ALIGN4(x)	(((x) + 3) & ~3)
+#define SUM_SPACE(len)	(ALIGN4 (sizeof (struct jffs2_raw_summary) + (len)) + \
+			 sizeof (struct jffs2_sum_marker))
+
+static void close_block (void)
+{
+	u32 base = cur - cur % ERASESIZE;
+	union jffs2_sum_flash *sp = (union jffs2_sum_flash *)sum;
+	struct jffs2_raw_summary *s;
+	struct jffs2_sum_marker *m;
+	u32 off;
+
+	if (cur % ERASESIZE == 0)
+		return;
+
+	if (summaries && sum_num) {
+		if (base / ERASESIZE == bad_block) {
+			if (sp->u.nodetype == JFFS2_NODETYPE_INODE)
+				sp->i.offset = bad_offset;
+			else
+				sp->d.offset = bad_offset;
+		}
+		off = ERASESIZE - SUM_SPACE (sum_len);
+		s = (struct jffs2_raw_summary *)(img + base + off);
+		s->magic = JFFS2_MAGIC_BITMASK;
+		s->nodetype = JFFS2_NODETYPE_SUMMARY;
+		s->totlen = sizeof (*s) + sum_len;
+		s->hdr_crc = crc32_no_comp (0, (uchar *)s, 8);
+		s->sum_num = sum_num;
+		s->cln_mkr = 0;
+		s->padded = 0;
+		memcpy (s->sum, sum, sum_len);
+		s->sum_crc = crc32_no_comp (0, (uchar *)s->sum, sum_len);
+		s->node_crc = crc32_no_comp (0, (uchar *)s, sizeof (*s) - 8);
+		m = (struct jffs2_sum_marker *)(img + base + ERASESIZE -
+						sizeof (*m));
+		m->offset = off;
+		m->magic = JFFS2_SUM_MAGIC;
+	}
+	sum_len = sum_num = 0;
+	cur = base + ERASESIZE;
+}
+
+/*
+ * Copy a node to the image, leaving room for the summary with one more
+ * record of rec_len bytes. Returns its offset in the erase block.
+ */
+static u32 put_node (void *node, u32 len, u32 rec_len)
+{
+	u32 need = ALIGN4 (len);
+	u32 start;
+
+	if (summaries)
+		need += SUM_SPACE (sum_len + rec_len);
+	if (cur % ERASESIZE + need > ERASESIZE)
+		close_block ();
+	if (cur + need > IMG_SIZE) {
+		printf ("image full\n");
+		exit (1);
+	}
+	start = cur;
+	memcpy (img + start, node, len);
+	cur += ALIGN4 (len);
+	return start % ERASESIZE;
+}
+
+static void add_inode (u32 ino, u32 mode, u32 isize, u32 offset,
+		       const void *data, u32 len)
+{
+	static u8 buf[sizeof (struct jffs2_raw_inode) + FRAG_SIZE];
+	struct jffs2_raw_inode *n = (struct jffs2_raw_inode *)buf;
+	struct jffs2_sum_inode_flash *r;
+	u32 off;
+
+	memset (n, 0, sizeof (*n));
+	n->magic = JFFS2_MAGIC_BITMASK;
+	n->nodetype = JFFS2_NODETYPE_INODE;
+	n->totlen = sizeof (*n) + len;
+	n->hdr_crc = crc32_no_comp (0, buf, 8);
+	n->ino = ino;
+	n->version = ++version;
+	n->mode = mode;
+	n->isize = isize;
+	n->offset = offset;
+	n->csize = n->dsize = len;
+	n->compr = JFFS2_COMPR_NONE;
+	memcpy (buf + sizeof (*n), data, len);
+	n->data_crc = crc32_no_comp (0, buf + sizeof (*n), len);
+	n->node_crc = crc32_no_comp (0, buf, sizeof (*n) - 8);
+
+	off = put_node (buf, n->totlen, JFFS2_SUMMARY_INODE_SIZE);
+	r = (struct jffs2_sum_inode_flash *)(sum + sum_len);
+	r->nodetype = JFFS2_NODETYPE_INODE;
+	r->inode = ino;
+	r->version = version;
+	r->offset = off;
+	r->totlen = n->totlen;
+	sum_len += JFFS2_SUMMARY_INODE_SIZE;
+	sum_num++;
+}
+
+static void add_dirent (u32 pino, u32 ino, u8 type, const char *name)
+{
+	static u8 buf[sizeof (struct jffs2_raw_dirent) + 256];
+	struct jffs2_raw_dirent *n = (struct jffs2_raw_dirent *)buf;
+	struct jffs2_sum_dirent_flash *r;
+	u32 nsize = strlen (name);
+	u32 off;
+
+	memset (n, 0, sizeof (*n));
+	n->magic = JFFS2_MAGIC_BITMASK;
+	n->nodetype = JFFS2_NODETYPE_DIRENT;
+	n->totlen = sizeof (*n) + nsize;
+	n->hdr_crc = crc32_no_comp (0, buf, 8);
+	n->pino = pino;
+	n->version = ++version;
+	n->ino = ino;
+	n->nsize = nsize;
+	n->type = type;
+	n->node_crc = crc32_no_comp (0, buf, sizeof (*n) - 8);
+	n->name_crc = crc32_no_comp (0, (uchar *)name, nsize);
+	memcpy (n->name, name, nsize);
+
+	off = put_node (buf, n->totlen, JFFS2_SUMMARY_DIRENT_SIZE (nsize));
+	r = (struct jffs2_sum_dirent_flash *)(sum + sum_len);
+	r->nodetype = JFFS2_NODETYPE_DIRENT;
+	r->totlen = n->totlen;
+	r->offset = off;
+	r->pino = pino;
+	r->version = version;
+	r->ino = ino;
+	r->nsize = nsize;
+	r->type = type;
+	memcpy (r->name, name, nsize);
+	sum_len += JFFS2_SUMMARY_DIRENT_SIZE (nsize);
+	sum_num++;
+}
+
+static void add_file (u32 pino, u32 ino, const char *name,
+		      const u8 *data, u32 size)
+{
+	u32 off, len;
+
+	add_dirent (pino, ino, DT_REG, name);
+	for (off = 0; off == 0 || off < size; off += len) {
+		len = min (size - off, FRAG_SIZE);
+		/* written as appended to, the newest node has the size */
+		add_inode (ino, S_IFREG | 0644, off + len, off, data + off, len);
+	}
+}
+
+static void add_link (u32 pino, u32 ino, const char *name, const char *target)
+{
+	add_dirent (pino, ino, DT_LNK, name);
+	add_inode (ino, S_IFLNK | 0777, strlen (target), 0, target,
+		   strlen (target));
+}
+
+static void add_dir (u32 pino, u32 ino, const char *name)
+{
+	add_dirent (pino, ino, DT_DIR, name);
+	add_inode (ino, S_IFDIR | 0755, 0, 0, NULL, 0);
+}
+
+/* the contents of the generated file system */
+static u8 kernel[KERNEL_SIZE];
+static u8 lib[NLIBS][512];
+static const char motd[] = "Welcome to U-Boot\n";
+
+#define LIB_SIZE(i)	(100 + (i) * 37 % 400)
+
+static void make_image (void)
+{
+	char name[32];
+	int i;
+
+	memset (img, 0xff, sizeof (img));
+	cur = version = sum_len = sum_num = 0;
+
+	add_inode (1, S_IFDIR | 0755, 0, 0, NULL, 0);
+	add_dir (1, 2, "boot");
+	add_dir (1, 3, "etc");
+	add_dir (1, 4, "lib");
+	add_file (3, 10, "motd", "old", 3);
+	for (i = 0; i < NLIBS; i++) {
+		sprintf (name, "lib%02d.so", i);
+		add_file (4, 100 + i, name, lib[i], LIB_SIZE (i));
+	}
+	add_file (2, 11, "uImage", kernel, KERNEL_SIZE);
+	add_link (2, 12, "vmlinux", "uImage");
+	add_link (1, 13, "kernel", "/boot/uImage");
+	add_file (3, 14, "motd", motd, sizeof (motd) - 1);	/* replaces 10 */
+	add_link (3, 15, "issue", "motd");
+	close_block ();
+	blocks = cur / ERASESIZE;
+}
+
+/* write the image to the NAND behind a block of other data */
+static void mount (void)
+{
+	static u8 other[PART_OFFSET];
+
+	if (nand_file)
+		fclose (nand_file);
+	nand_file = tmpfile ();
+	fwrite (other, 1, sizeof (other), nand_file);
+	fwrite (img, 1, sizeof (img), nand_file);
+	nand_size = PART_OFFSET + IMG_SIZE;
+
+	jffs2_free_cache (&part);
+	part.jffs2_priv = NULL;
+	part.offset = PART_OFFSET;
+	part.size = blocks * ERASESIZE;
+	nand_dev_desc[0].erasesize = ERASESIZE;
+	nand_reads = nand_bytes = 0;
+	memset (line_reads, 0, sizeof (line_reads));
+}
+
+/* cache lines read since the last call, and how many more than once */
+static int lines_read (int *twice)
+{
+	int i, n = 0;
+
+	*twice = 0;
+	for (i = 0; i < sizeof (line_reads); i++) {
+		if (line_reads[i])
+			n++;
+		if (line_reads[i] > 1)
+			(*twice)++;
+	}
+	memset (line_reads, 0, sizeof (line_reads));
+	return n;
+}
+
+/* the scan progress and listings go to /dev/null */
+static FILE *devnull;
+static int stdout_fd;
+
+static void quiet (int on)
+{
+	fflush (stdout);
+	if (on) {
+		stdout_fd = dup (1);
+		dup2 (fileno (devnull), 1);
+	} else {
+		dup2 (stdout_fd, 1);
+		close (stdout_fd);
+	}
+}
+
+/* scan the partition, looking up a name which is not there */
+static void scan (void)
+{
+	quiet (1);
+	jffs2_1pass_ls (&part, "/none");
+	quiet (0);
+}
+
+/* lines read ahead by the NAND cache so far, from "jffs2 info" */
+static u32 read_ahead (void)
+{
+	FILE *out = tmpfile ();
+	char line[128];
+	u32 hits, misses, ahead = 0;
+	int fd;
+
+	fflush (stdout);
+	fd = dup (1);
+	dup2 (fileno (out), 1);
+	jffs2_1pass_info (&part);
+	fflush (stdout);
+	dup2 (fd, 1);
+	close (fd);
+
+	rewind (out);
+	while (fgets (line, sizeof (line), out))
+		sscanf (line, "NAND cache: %u hits, %u misses, %u lines read ahead",
+			&hits, &misses, &ahead);
+	fclose (out);
+	return ahead;
+}
+
+static int ls (const char *path)
+{
+	int ret;
+
+	quiet (1);
+	ret = jffs2_1pass_ls (&part, path);
+	quiet (0);
+	return ret;
+}
+
+static long load (const char *path, u8 *buf)
+{
+	long ret;
+
+	quiet (1);
+	ret = jffs2_1pass_load ((char *)buf, &part, path);
+	quiet (0);
+	return ret;
+}
+
+static void check_file (const char *path, const u8 *data, long size)
+{
+	static u8 buf[KERNEL_SIZE + FRAG_SIZE];
+	long got;
+
+	memset (buf, 0, sizeof (buf));
+	got = load (path, buf);
+	if (got != size || memcmp (buf, data, size) != 0)
+		printf ("%s: %ld bytes loaded, %ld expected\n", path, got, size);
+	check (got == size && memcmp (buf, data, size) == 0);
+}
+
+static void check_fs (void)
+{
+	char name[32];
+	int i;
+
+	check (ls ("/") != 0);
+	check (ls ("/lib") != 0);
+	check_file ("/boot/uImage", kernel, KERNEL_SIZE);
+	check_file ("/boot/vmlinux", kernel, KERNEL_SIZE);
+	check_file ("/kernel", kernel, KERNEL_SIZE);
+	check_file ("/etc/motd", motd, sizeof (motd) - 1);
+	check_file ("/etc/issue", motd, sizeof (motd) - 1);
+	for (i = 0; i < NLIBS; i++) {
+		sprintf (name, "/lib/lib%02d.so", i);
+		check_file (name, lib[i], LIB_SIZE (i));
+	}
+}
+
+/* list an image made elsewhere */
+static int scan_file (const char *path, ulong erasesize)
+{
+	nand_file = fopen (path, "rb");
+	if (nand_file == NULL) {
+		perror (path);
+		return 1;
+	}
+	fseek (nand_file, 0, SEEK_END);
+	nand_size = ftell (nand_file);
+	nand_dev_desc[0].erasesize = erasesize;
+	part.offset = 0;
+	part.size = nand_size - nand_size % erasesize;
+	if (!jffs2_1pass_ls (&part, "/") || !jffs2_1pass_info (&part))
+		return 1;
+	printf ("%ld NAND reads, %ld kB\n", nand_reads, nand_bytes / 1024);
+	return 0;
+}
+
+int main (int argc, char *argv[])
+{
+	static const u32 bad[] = {
+		ERASESIZE, ERASESIZE - 8, ERASESIZE + 0x100, 0xfffffff0
+	};
+	ulong plain, summed, reads;
+	u32 b, i, j, ahead;
+	int lines, twice;
+
+	nand_id.type = MTD_DEV_TYPE_NAND;
+	nand_id.num = 0;
+	nand_id.mtd_id = "nand0";
+	nand_mtd.id = &nand_id;
+	nand_mtd.num_parts = 1;
+	part.name = "jffs2";
+	part.dev = &nand_mtd;
+	devnull = fopen ("/dev/null", "w");
+
+	if (argc > 1)
+		return scan_file (argv[1], argc > 2 ?
+			simple_strtoul (argv[2], NULL, 0) : ERASESIZE);
+
+	for (i = 0; i < KERNEL_SIZE; i++)
+		kernel[i] = (u8)(i * 7 + (i >> 8));
+	for (i = 0; i < NLIBS; i++)
+		for (j = 0; j < LIB_SIZE (i); j++)
+			lib[i][j] = (u8)(i + j * 3);
+
+	/* full scan */
+	summaries = 0;
+	bad_block = (u32)-1;
+	make_image ();
+	mount ();
+	check_file ("/etc/motd", motd, sizeof (motd) - 1);
+	plain = nand_bytes;
+	check_fs ();
+
+	/* erase block summaries */
+	summaries = 1;
+	make_image ();
+	mount ();
+	check_file ("/etc/motd", motd, sizeof (motd) - 1);
+	summed = nand_bytes;
+	check_fs ();
+	printf ("%d erase blocks, scan and load of /etc/motd: %ld kB read "
+		"without summaries, %ld kB with\n",
+		blocks, plain / 1024, summed / 1024);
+	check (summed < plain / 4);
+
+	/* the scan reads each line once, most of them ahead */
+	ahead = read_ahead ();
+	summaries = 0;
+	make_image ();
+	mount ();
+	scan ();
+	reads = nand_reads;
+	lines = lines_read (&twice);
+	ahead = read_ahead () - ahead;
+	printf ("full scan: %d lines read, %d of them ahead\n", lines, ahead);
+	check (reads == lines && twice == 0);
+	check (ahead >= reads / 2);
+
+	/* with summaries, only the end of the erase blocks */
+	summaries = 1;
+	make_image ();
+	mount ();
+	scan ();
+	reads = nand_reads;
+	lines = lines_read (&twice);
+	printf ("summary scan: %d lines read\n", lines);
+	check (reads == lines && lines <= 2 * blocks);
+
+	/*
+	 * A load whose lines fit in the cache reads each of them once and
+	 * nothing when repeated.
+	 */
+	check_file ("/etc/motd", motd, sizeof (motd) - 1);
+	lines = lines_read (&twice);
+	reads = nand_reads;
+	check_file ("/etc/motd", motd, sizeof (motd) - 1);
+	reads = nand_reads - reads;
+	printf ("load of /etc/motd: %d lines read, %ld when repeated "
+		"(%d line cache)\n", lines, reads, CACHE_LINES);
+	if (lines <= CACHE_LINES)
+		check (twice == 0 && reads == 0);
+	check (reads <= lines + twice);
+
+	/* a summary with a record outside its block must not be used */
+	for (b = 0; b < blocks; b++) {
+		for (i = 0; i < sizeof (bad) / sizeof (bad[0]); i++) {
+			bad_block = b;
+			bad_offset = bad[i];
+			make_image ();
+			mount ();
+			check_fs ();
+		}
+	}
+	printf ("%d broken summaries skipped\n", b * i);
+
+	jffs2_free_cache (&part);
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
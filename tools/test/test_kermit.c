@@ -0,0 +1,554 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * "loadb" (common/cmd_load.c) against a simulated Kermit sender on the
+ * other end of the console. The sender builds its packets as C-Kermit
+ * does: send-init with or without long packets and sliding windows,
+ * control prefixing, type 1 block checks, a window of packets in
+ * flight, resending from a NAKed packet, and resending what is not
+ * acknowledged after a timeout. It runs whenever the receiver finds
+ * the line empty, and reads the receiver's packets from its output.
+ *
+ * Each transfer must load the data unchanged, also when packets are
+ * lost, damaged or duplicated and when acknowledges are lost. The
+ * send-init answer must offer long packets and windows only as
+ * described in README, and nothing new to a sender which does not
+ * know about them. The packets, waits for an acknowledge and
+ * resulting transfer time are reported.
+ */
+#include <common.h>
+#include <command.h>
+#include <unistd.h>
+
+#define DATA_SIZE	200000
+#define MAX_PACKETS	4096
+#define LINE_SIZE	(1 << 20)
+#define BAUD		115200
+#define TURNAROUND	10		/* ms for the sender to see an ACK */
+
+#define SOH		0x01
+#define ETX		0x03
+#define tochar(x)	((uchar)((x) + 32))
+#define unchar(x)	((int)(x) - 32)
+
+extern int do_load_serial_bin (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[]);
+
+void flush_cache (ulong start, ulong size)
+{
+}
+
+void serial_setbrg (void)
+{
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* a transfer, as the sender is told to do it */
+struct transfer {
+	const char	*name;
+	int		maxl;		/* longest packet to offer */
+	int		window;		/* window size to offer, 0: none */
+	int		capas;		/* send CAPAS and the fields after it */
+	int		drop;		/* packet lost on its first transmission */
+	int		damage;		/* packet damaged on its first transmission */
+	int		twice;		/* packet sent twice the first time */
+	int		lose_ack;	/* packet whose first ACK is lost */
+};
+
+struct packet {
+	int		seq;
+	uchar		type;
+	int		off, len;	/* payload, for 'D' packets */
+	int		sent;
+	int		acked;
+};
+
+static uchar payload[DATA_SIZE];
+
+static struct packet pkt[MAX_PACKETS];
+static const struct transfer *tr;
+static int npkts;		/* packets built so far */
+static int base;		/* first packet not acknowledged */
+static int next;		/* next packet to send for the first time */
+
+static int his_maxl, his_window, his_capas, ack_fields;
+static int maxdata, window;	/* negotiated */
+
+static uchar line[LINE_SIZE];	/* sender -> receiver */
+static int line_head, line_tail;
+
+static FILE *capture;		/* receiver -> sender (and its messages) */
+static uchar rx[LINE_SIZE];
+static long rx_len, rx_pos;
+
+/* what it took */
+static long tx_bytes, resent, timeouts, waits, naks;
+static int lost_ack;
+
+static int kchk (const uchar *p, int len)
+{
+	int s = 0;
+
+	while (len--)
+		s += *p++;
+	return (s + ((s >> 6) & 3)) & 63;
+}
+
+/*
+ * Control prefix 'in' into at most 'max' bytes; returns the length
+ * and the number of input bytes used in '*used'.
+ */
+static int encode (uchar *out, int max, const uchar *in, int len, int *used)
+{
+	int i, n = 0;
+
+	for (i = 0; i < len; i++) {
+		uchar c = in[i], a = c & 0x7f;
+
+		if (a < 0x20 || a == 0x7f) {
+			if (n + 2 > max)
+				break;
+			out[n++] = '#';
+			out[n++] = c ^ 0x40;
+		} else if (a == '#') {
+			if (n + 2 > max)
+				break;
+			out[n++] = '#';
+			out[n++] = c;
+		} else {
+			if (n + 1 > max)
+				break;
+			out[n++] = c;
+		}
+	}
+	*used = i;
+	return n;
+}
+
+/* build a packet, short or long as its length needs */
+static int build (uchar *p, int seq, int type, const uchar *data, int len)
+{
+	int n = 0, start;
+
+	p[n++] = SOH;
+	start = n;
+	if (len + 3 <= 94) {
+		p[n++] = tochar (len + 3);
+		p[n++] = tochar (seq);
+		p[n++] = type;
+	} else {
+		p[n++] = tochar (0);
+		p[n++] = tochar (seq);
+		p[n++] = type;
+		p[n++] = tochar ((len + 1) / 95);
+		p[n++] = tochar ((len + 1) % 95);
+		p[n] = tochar (kchk (p + start, n - start));
+		n++;
+	}
+	memcpy (p + n, data, len);
+	n += len;
+	p[n] = tochar (kchk (p + start, n - start));
+	n++;
+	p[n++] = '\r';
+	return n;
+}
+
+static void send_init_data (uchar *d, int *len)
+{
+	int n = 0;
+
+	d[n++] = tochar (tr->maxl > 94 ? 94 : tr->maxl);	/* MAXL */
+	d[n++] = tochar (5);		/* TIME */
+	d[n++] = tochar (0);		/* NPAD */
+	d[n++] = 0x40;			/* PADC */
+	d[n++] = tochar ('\r');		/* EOL */
+	d[n++] = '#';			/* QCTL */
+	d[n++] = 'Y';			/* QBIN: only if asked to */
+	d[n++] = '1';			/* CHKT */
+	d[n++] = '~';			/* REPT */
+	if (tr->capas) {
+		d[n++] = tochar ((tr->maxl > 94 ? 2 : 0) | (tr->window ? 4 : 0));
+		d[n++] = tochar (tr->window);
+		d[n++] = tochar (tr->maxl / 95);
+		d[n++] = tochar (tr->maxl % 95);
+	}
+	*len = n;
+}
+
+static void add_packet (int type, int off, int len)
+{
+	pkt[npkts].seq = npkts & 63;
+	pkt[npkts].type = type;
+	pkt[npkts].off = off;
+	pkt[npkts].len = len;
+	npkts++;
+}
+
+/* the packets after the send-init, once its answer is in */
+static void add_file (void)
+{
+	uchar buf[9100];
+	int off, used;
+
+	add_packet ('F', 0, 0);
+	for (off = 0; off < DATA_SIZE; off += used) {
+		encode (buf, maxdata, payload + off, DATA_SIZE - off, &used);
+		add_packet ('D', off, used);
+	}
+	add_packet ('Z', 0, 0);
+	add_packet ('B', 0, 0);
+}
+
+static void transmit (int i)
+{
+	struct packet *k = &pkt[i];
+	uchar data[9100], p[9200];
+	int len, used, n;
+
+	switch (k->type) {
+	case 'S':
+		send_init_data (data, &len);
+		break;
+	case 'F':
+		strcpy ((char *)data, "UIMAGE");
+		len = strlen ((char *)data);
+		break;
+	case 'D':
+		len = encode (data, maxdata, payload + k->off, k->len, &used);
+		check (used == k->len);
+		break;
+	default:
+		len = 0;
+	}
+	n = build (p, k->seq, k->type, data, len);
+
+	if (k->sent++) {
+		resent++;
+	} else if (i == tr->drop) {
+		return;
+	} else if (i == tr->damage) {
+		p[n / 2] ^= 0x01;
+	} else if (i == tr->twice) {
+		memcpy (line + line_tail, p, n);
+		line_tail += n;
+		tx_bytes += n;
+	}
+	check (line_tail + n <= LINE_SIZE);
+	memcpy (line + line_tail, p, n);
+	line_tail += n;
+	tx_bytes += n;
+}
+
+/* S, F, Z and B go alone, everything before them acknowledged */
+static int alone (int i)
+{
+	return pkt[i].type != 'D';
+}
+
+/* the packet 'seq' in the window, or -1 */
+static int find (int seq)
+{
+	int i;
+
+	for (i = base; i < next; i++) {
+		if (pkt[i].seq == seq)
+			return i;
+	}
+	return -1;
+}
+
+static void got_send_init (const uchar *d, int len)
+{
+	ack_fields = len;
+	his_maxl = len > 0 ? unchar (d[0]) : 80;
+	his_capas = len > 9 ? unchar (d[9]) : 0;
+	his_window = len > 10 ? unchar (d[10]) : 0;
+	if (tr->maxl > 94 && (his_capas & 2) && len > 12)
+		maxdata = min (tr->maxl, unchar (d[11]) * 95 + unchar (d[12])) - 1;
+	else
+		maxdata = min (tr->maxl, his_maxl) - 3;
+	window = tr->window && (his_capas & 4) ? min (tr->window, his_window) : 1;
+	add_file ();
+}
+
+/* read the receiver's packets; returns the first packet to resend */
+static int receive (void)
+{
+	int len, seq, type, i, from = -1;
+	long n;
+
+	fflush (stdout);
+	n = pread (fileno (capture), rx + rx_len, sizeof (rx) - rx_len, rx_len);
+	if (n > 0)
+		rx_len += n;
+
+	while (rx_pos < rx_len) {
+		if (rx[rx_pos] != SOH) {
+			rx_pos++;
+			continue;
+		}
+		len = unchar (rx[rx_pos + 1]);
+		seq = unchar (rx[rx_pos + 2]);
+		type = rx[rx_pos + 3];
+		check (rx_pos + len + 3 <= rx_len);
+		check (kchk (rx + rx_pos + 1, len) == unchar (rx[rx_pos + len + 1]));
+		check (rx[rx_pos + len + 2] == '\r');
+
+		i = find (seq);
+		if (type == 'Y' && i >= 0) {
+			if (i == tr->lose_ack && !lost_ack) {
+				lost_ack = 1;
+			} else if (!pkt[i].acked) {
+				pkt[i].acked = 1;
+				if (pkt[i].type == 'S')
+					got_send_init (rx + rx_pos + 4, len - 3);
+			}
+		} else if (type == 'N') {
+			naks++;
+			if (i >= 0) {
+				if (from < 0 || i < from)
+					from = i;
+			} else if (next < npkts && pkt[next].seq == seq) {
+				/* NAK for the next one: all before are in */
+				for (i = base; i < next; i++)
+					pkt[i].acked = 1;
+			}
+		} else {
+			check (type == 'Y');
+		}
+		rx_pos += len + 3;
+	}
+	return from;
+}
+
+/* the sender's turn: the receiver has read everything there was */
+static void sender (void)
+{
+	int i, from, sent = 0;
+
+	if (base < next)
+		waits++;
+	from = receive ();
+	while (base < next && pkt[base].acked)
+		base++;
+	if (base == npkts) {
+		line[line_tail++] = ETX;	/* all done, stop asking */
+		return;
+	}
+
+	if (from >= 0) {
+		for (i = from; i < next; i++) {
+			if (!pkt[i].acked) {
+				transmit (i);
+				sent++;
+			}
+		}
+	}
+	while (next < npkts && next - base < window) {
+		if (base < next && (alone (next) || alone (base)))
+			break;
+		transmit (next++);
+		sent++;
+	}
+	if (sent == 0 && base < next) {
+		/* nothing came back: resend what is not acknowledged */
+		if (++timeouts > 100) {
+			line[line_tail++] = ETX;
+			return;
+		}
+		for (i = base; i < next; i++) {
+			if (!pkt[i].acked)
+				transmit (i);
+		}
+	}
+}
+
+int host_getc (void)
+{
+	while (line_head == line_tail) {
+		line_head = line_tail = 0;
+		sender ();
+	}
+	return line[line_head++];
+}
+
+int tstc (void)
+{
+	return line_head != line_tail;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uchar *mem;
+
+static void run (const struct transfer *t)
+{
+	char addr[32], *argv[] = { "loadb", addr, NULL };
+	int fd, rc;
+	long ms;
+
+	tr = t;
+	memset (pkt, 0, sizeof (pkt));
+	memset (mem, 0xe5, DATA_SIZE + 16);
+	npkts = base = next = 0;
+	line_head = line_tail = 0;
+	rx_len = rx_pos = 0;
+	tx_bytes = resent = timeouts = waits = naks = 0;
+	lost_ack = 0;
+	ack_fields = his_maxl = his_window = his_capas = 0;
+	maxdata = 91;
+	window = 1;
+	add_packet ('S', 0, 0);
+
+	capture = tmpfile ();
+	fflush (stdout);
+	fd = dup (1);
+	dup2 (fileno (capture), 1);
+	sprintf (addr, "%lx", (ulong)mem);
+	rc = do_load_serial_bin (NULL, 0, 2, argv);
+	receive ();			/* the ACK of 'B' */
+	while (base < next && pkt[base].acked)
+		base++;
+	fflush (stdout);
+	dup2 (fd, 1);
+	close (fd);
+	fclose (capture);
+
+	ms = tx_bytes * 10 * 1000 / BAUD + waits * TURNAROUND;
+	printf ("%-28s %4d packets, %4ld waits for an ACK, %3ld resent, "
+		"%ld.%ld s\n", t->name, npkts, waits, resent,
+		ms / 1000, ms % 1000 / 100);
+
+	check (rc == 0);
+	check (load_addr == (ulong)mem);
+	check (getenv ("filesize") && strcmp (getenv ("filesize"), "30D40") == 0);
+	check (memcmp (mem, payload, DATA_SIZE) == 0);
+	check (mem[DATA_SIZE] == 0xe5);
+	check (base == npkts);
+	check (timeouts <= 2);
+}
+
+static void no_errors (struct transfer *t)
+{
+	t->drop = t->damage = t->twice = t->lose_ack = -1;
+}
+
+int main (void)
+{
+	struct transfer t;
+	int i;
+
+	srand (1);
+	for (i = 0; i < DATA_SIZE; i++)
+		payload[i] = rand () >> 8;
+	mem = malloc (DATA_SIZE + 16);
+
+	/* a sender which does not know about long packets and windows */
+	memset (&t, 0, sizeof (t));
+	no_errors (&t);
+	t.name = "94 bytes, no capabilities";
+	t.maxl = 94;
+	run (&t);
+	check (ack_fields == 9);
+	check (maxdata == 91 && window == 1);
+
+	/* long packets, stop-and-wait */
+	t.name = "9024 bytes";
+	t.capas = 1;
+	t.maxl = 9024;
+	run (&t);
+	check (ack_fields == 13 && his_capas == 2 && his_window == 0);
+	check (maxdata == 9023 && window == 1);
+	check (waits == npkts - 1);	/* all but the send-init */
+
+	/* long packets and a window of 10 */
+	t.name = "9024 bytes, window 10";
+	t.window = 10;
+	run (&t);
+	check (his_capas == (2 | 4) && his_window == 10);
+	check (maxdata == 9023 && window == 10);
+	check (waits < npkts / 2);
+
+	/* a window larger than CFG_KERMIT_WINDOW is cut down */
+	t.name = "9024 bytes, window 31";
+	t.window = 31;
+	run (&t);
+	check (his_window == 16 && window == 16);
+
+	/* short packets in a window */
+	t.name = "94 bytes, window 31";
+	t.maxl = 94;
+	run (&t);
+	check (his_capas == (2 | 4) && his_window == 16);
+	check (maxdata == 91 && window == 16);
+
+	/* a window of 1 is stop-and-wait */
+	t.name = "9024 bytes, window 1";
+	t.maxl = 9024;
+	t.window = 1;
+	run (&t);
+	check (his_capas == 2 && his_window == 0 && window == 1);
+
+	/* line errors, with and without a window */
+	for (t.window = 10; t.window >= 0; t.window -= 10) {
+		no_errors (&t);
+		t.name = t.window ? "window 10, D lost" : "stop-and-wait, D lost";
+		t.drop = 5;
+		run (&t);
+		check (resent >= 1);
+
+		no_errors (&t);
+		t.name = t.window ? "window 10, D damaged" : "stop-and-wait, D damaged";
+		t.damage = 6;
+		run (&t);
+		check (resent >= 1 && naks >= 1);
+
+		no_errors (&t);
+		t.name = t.window ? "window 10, D twice" : "stop-and-wait, D twice";
+		t.twice = 4;
+		run (&t);
+
+		no_errors (&t);
+		t.name = t.window ? "window 10, ACK of D lost" : "stop-and-wait, ACK of D lost";
+		t.lose_ack = 7;
+		run (&t);
+		check (lost_ack && timeouts == 1);
+
+		no_errors (&t);
+		t.name = t.window ? "window 10, ACK of S lost" : "stop-and-wait, ACK of S lost";
+		t.lose_ack = 0;
+		run (&t);
+		check (lost_ack && timeouts == 1);
+		check (his_window == t.window);
+
+		no_errors (&t);
+		t.name = t.window ? "window 10, S twice" : "stop-and-wait, S twice";
+		t.twice = 0;
+		run (&t);
+		check (resent == 0);
+	}
+
+	free (mem);
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
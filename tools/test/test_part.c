@@ -0,0 +1,176 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * disk/part.c and disk/part_dos.c on generated disk images: a DOS
+ * partition table with primary partitions and a long chain of logical
+ * partitions, and one whose chain of extended boot records loops.
+ * Every lookup is checked against the layout the image was built
+ * with, and the number of sectors read with and without the partition
+ * table cache is reported.
+ */
+#include <common.h>
+#include <part.h>
+
+#define BLKSZ		512
+#define NPRIMARY	2		/* primaries in slots 1, 2; 3 empty */
+#define NLOGICAL	60
+#define PRIMARY_SIZE	1000
+#define EBR_SPACING	100		/* sectors between EBRs */
+#define LOGICAL_SIZE	50
+#define EXT_START	(63 + NPRIMARY * PRIMARY_SIZE)
+#define DISK_BLOCKS	(EXT_START + (NLOGICAL + 1) * EBR_SPACING)
+
+static uchar disk[DISK_BLOCKS * BLKSZ];
+static ulong sectors_read;
+
+static ulong disk_read (int dev, ulong start, lbaint_t blkcnt, ulong *buffer)
+{
+	if (start >= DISK_BLOCKS)
+		return 0;
+	if (start + blkcnt > DISK_BLOCKS)
+		blkcnt = DISK_BLOCKS - start;
+	memcpy (buffer, disk + start * BLKSZ, blkcnt * BLKSZ);
+	sectors_read += blkcnt;
+	return blkcnt;
+}
+
+static void put_entry (uchar *sector, int slot, int type, ulong start, ulong size)
+{
+	uchar *e = sector + 0x1be + 16 * slot;
+	int i;
+
+	memset (e, 0, 16);
+	e[4] = type;
+	for (i = 0; i < 4; i++) {
+		e[8 + i]  = start >> (8 * i);
+		e[12 + i] = size >> (8 * i);
+	}
+	sector[0x1fe] = 0x55;
+	sector[0x1ff] = 0xaa;
+}
+
+/*
+ * MBR: primaries 1 and 2, slot 3 empty, extended partition in slot 4;
+ * logical partitions 5.. each in its own EBR, 1 sector after it.
+ * With "loop" the last EBR links back to the first one.
+ */
+static void make_disk (int loop)
+{
+	int i;
+
+	memset (disk, 0, sizeof (disk));
+	for (i = 0; i < NPRIMARY; i++)
+		put_entry (disk, i, 0x83, 63 + i * PRIMARY_SIZE, PRIMARY_SIZE);
+	put_entry (disk, 3, 0x05, EXT_START, (NLOGICAL + 1) * EBR_SPACING);
+
+	for (i = 0; i < NLOGICAL; i++) {
+		uchar *ebr = disk + (EXT_START + i * EBR_SPACING) * BLKSZ;
+
+		put_entry (ebr, 0, 0x83, 1, LOGICAL_SIZE);
+		if (i < NLOGICAL - 1)
+			put_entry (ebr, 1, 0x05, (i + 1) * EBR_SPACING, EBR_SPACING);
+		else if (loop)
+			put_entry (ebr, 1, 0x05, 0, EBR_SPACING);
+	}
+}
+
+/* partition numbers as fdisk assigns them */
+static int expect (int part, ulong *start, ulong *size)
+{
+	if (part >= 1 && part <= NPRIMARY) {
+		*start = 63 + (part - 1) * PRIMARY_SIZE;
+		*size = PRIMARY_SIZE;
+		return 0;
+	}
+	if (part >= 5 && part < 5 + NLOGICAL) {
+		*start = EXT_START + (part - 5) * EBR_SPACING + 1;
+		*size = LOGICAL_SIZE;
+		return 0;
+	}
+	return -1;
+}
+
+static block_dev_desc_t dev;
+
+static ulong lookup_all (int rounds)
+{
+	disk_partition_t info;
+	ulong start = 0, size = 0, before = sectors_read;
+	int r, part, rc;
+
+	for (r = 0; r < rounds; r++) {
+		for (part = 0; part <= 5 + NLOGICAL + 5; part++) {
+			rc = get_partition_info (&dev, part, &info);
+			check (rc == expect (part, &start, &size));
+			if (rc == 0) {
+				check (info.start == start);
+				check (info.size == size);
+				check (info.blksz == BLKSZ);
+			}
+		}
+	}
+	return sectors_read - before;
+}
+
+int main (void)
+{
+	disk_partition_t info;
+	ulong uncached, cached;
+	int part;
+
+	dev.if_type = IF_TYPE_IDE;
+	dev.type = DEV_TYPE_HARDDISK;
+	dev.lba = DISK_BLOCKS;
+	dev.blksz = BLKSZ;
+	dev.block_read = disk_read;
+
+	make_disk (0);
+	init_part (&dev);
+	check (dev.part_type == PART_TYPE_DOS);
+
+	/* the uncached parser, once per lookup */
+	uncached = sectors_read;
+	for (part = 0; part <= 5 + NLOGICAL + 5; part++)
+		get_partition_info_dos (&dev, part, &info);
+	uncached = 3 * (sectors_read - uncached);
+
+	cached = lookup_all (3);
+	printf ("%d logical partitions, 3 rounds of lookups: "
+		"%ld sectors read uncached, %ld cached\n",
+		NLOGICAL, uncached, cached);
+	check (cached == NLOGICAL + 1);		/* MBR + EBRs, once */
+
+	/* re-initialising the device drops the cached table */
+	init_part (&dev);
+	check (lookup_all (1) == NLOGICAL + 1);
+	part_cache_list ();
+
+	/* a looping chain of EBRs ends with an error, not a crash */
+	make_disk (1);
+	init_part (&dev);
+	check (get_partition_info (&dev, 1, &info) == 0);
+	check (get_partition_info (&dev, 400, &info) != 0);
+
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}
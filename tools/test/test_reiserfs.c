@@ -0,0 +1,584 @@
+/*
+ * (C) Copyright 2006
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * fs/reiserfs/reiserfs.c on a generated ReiserFS 3.6 image with a
+ * populated journal (there is no mkreiserfs on the build host). The
+ * image has a two level tree: directories, files in direct and
+ * indirect items, relative and absolute symlinks. The root node, the
+ * super block pointing to it and every third leaf are only correct in
+ * the journal, in transactions which override older copies of the
+ * same blocks; the log wraps around, has a transaction longer than a
+ * descriptor block can describe, more transactions than the journal
+ * cache holds, and an invalid transaction behind the valid ones.
+ * Every file is loaded and compared, with the journal map and with
+ * the transaction walk it falls back to when the map can't be
+ * allocated.
+ */
+#include <common.h>
+#include <unistd.h>
+#include <reiserfs.h>
+#include "../../fs/reiserfs/reiserfs_private.h"
+
+#define BLKSZ		4096
+#define SUPER_BLOCK	(REISERFS_DISK_OFFSET_IN_BYTES / BLKSZ)
+#define J_BLOCK		(SUPER_BLOCK + 2)	/* behind one bitmap block */
+#define J_SIZE		4096			/* blocks, a power of two */
+#define J_FIRST		(J_SIZE - 1000)		/* first unflushed transaction */
+#define MOUNT_ID	7
+#define FIRST_TRANS	100
+#define OLD_ROOT	(J_BLOCK + J_SIZE + 1)	/* behind the journal header */
+#define ROOT_BLOCK	(OLD_ROOT + 1)
+#define MAX_LEAVES	64
+#define LEAF_BLOCK	(ROOT_BLOCK + 1)
+#define DATA_BLOCK	(LEAF_BLOCK + MAX_LEAVES)
+#define NBLOCKS		(DATA_BLOCK + 256)
+#define FILLER_BLOCK	100000		/* journaled, but never read */
+
+#define KERNEL_SIZE	(150 * BLKSZ + 123)
+#define NLIBS		120
+#define LIB_MAX		(2 * BLKSZ)
+#define DIRECT_MAX	2048		/* larger files get indirect items */
+
+/* reiserfs_private.h only has the S_ISxxx() tests */
+#define S_IFDIR		0040000
+#define S_IFREG		0100000
+#define S_IFLNK		0120000
+
+/* the block device */
+static u8 img[NBLOCKS * BLKSZ];
+static ulong dev_reads;
+static ulong desc_reads;		/* of descriptor and commit blocks */
+static u8 desc_block[J_SIZE];
+static block_dev_desc_t dev;
+
+static ulong img_read (int n, ulong start, lbaint_t blkcnt, ulong *buffer)
+{
+	ulong block = start * SECTOR_SIZE / BLKSZ;
+
+	dev_reads++;
+	if (block >= J_BLOCK && block < J_BLOCK + J_SIZE &&
+	    desc_block[block - J_BLOCK])
+		desc_reads++;
+	if ((start + blkcnt) * SECTOR_SIZE > sizeof (img))
+		return 0;
+	memcpy (buffer, img + start * SECTOR_SIZE, blkcnt * SECTOR_SIZE);
+	return blkcnt;
+}
+
+/* the file system is on the whole device, partition 0 */
+int get_partition_info (block_dev_desc_t *dev_desc, int part,
+			disk_partition_t *info)
+{
+	return -1;
+}
+
+/* allocations of reiserfs.c of at least malloc_limit bytes fail */
+static size_t malloc_limit = (size_t)-1;
+
+void *host_malloc (size_t size)
+{
+	if (size >= malloc_limit)
+		return NULL;
+	return malloc (size);
+}
+
+/* the contents of the generated file system */
+struct object {
+	const char	*name;
+	int		parent;		/* index of the directory */
+	__u32		oid;
+	int		mode;
+	const u8	*data;
+	int		size;
+};
+
+static struct object obj[8 + NLIBS];
+static int nobjs;
+static u8 kernel[KERNEL_SIZE];
+static u8 lib[NLIBS][LIB_MAX];
+static const char motd[] = "Welcome to U-Boot\n";
+
+#define LIB_SIZE(i)	((i) % 10 == 9 ? BLKSZ + (i) * 37 : 100 + (i) * 37 % 1500)
+
+static int add_obj (int parent, __u32 oid, const char *name, int mode,
+		    const void *data, int size)
+{
+	obj[nobjs].name = name;
+	obj[nobjs].parent = parent;
+	obj[nobjs].oid = oid;
+	obj[nobjs].mode = mode;
+	obj[nobjs].data = data;
+	obj[nobjs].size = size;
+	return nobjs++;
+}
+
+static __u32 dir_id (int i)
+{
+	return i == 0 ? REISERFS_ROOT_PARENT_OBJECTID : obj[obj[i].parent].oid;
+}
+
+static void make_objects (void)
+{
+	static char names[NLIBS][16];
+	int root, boot, etc, libdir, i;
+
+	nobjs = 0;
+	root = add_obj (0, REISERFS_ROOT_OBJECTID, "", S_IFDIR | 0755, NULL, 0);
+	boot = add_obj (root, 3, "boot", S_IFDIR | 0755, NULL, 0);
+	etc = add_obj (root, 4, "etc", S_IFDIR | 0755, NULL, 0);
+	libdir = add_obj (root, 5, "lib", S_IFDIR | 0755, NULL, 0);
+	add_obj (root, 6, "kernel", S_IFLNK | 0777, "/boot/uImage", 12);
+	add_obj (boot, 7, "uImage", S_IFREG | 0644, kernel, KERNEL_SIZE);
+	add_obj (boot, 8, "vmlinux", S_IFLNK | 0777, "uImage", 6);
+	add_obj (etc, 9, "motd", S_IFREG | 0644, motd, sizeof (motd) - 1);
+	for (i = 0; i < NLIBS; i++) {
+		sprintf (names[i], "lib%03d.so", i);
+		add_obj (libdir, 100 + i, names[i], S_IFREG | 0755,
+			 lib[i], LIB_SIZE (i));
+	}
+}
+
+/* the tree, built in key order */
+static u8 leaf[MAX_LEAVES][BLKSZ];
+static int nleaves;
+static struct key first_key[MAX_LEAVES];
+static u8 root_node[BLKSZ];
+static __u32 data_next;			/* next free data block */
+
+static void set_key (struct key *key, __u32 dir, __u32 oid, __u64 offset,
+		     int type)
+{
+	memset (key, 0, sizeof (*key));
+	key->k_dir_id = dir;
+	key->k_objectid = oid;
+	key->u.v2.k_offset = offset;
+	key->u.v2.k_type = type;
+}
+
+static void put_item (struct key *key, __u16 count, const void *body, int len)
+{
+	struct block_head *bh;
+	struct item_head *ih;
+	int used;
+
+	bh = nleaves ? (struct block_head *)leaf[nleaves - 1] : NULL;
+	if (bh == NULL || bh->blk_free_space < IH_SIZE + len) {
+		check (nleaves < MAX_LEAVES);
+		bh = (struct block_head *)leaf[nleaves++];
+		memset (bh, 0, BLKSZ);
+		bh->blk_level = DISK_LEAF_NODE_LEVEL;
+		bh->blk_free_space = BLKSZ - BLKH_SIZE;
+		first_key[nleaves - 1] = *key;
+	}
+	used = BLKSZ - BLKH_SIZE - bh->blk_nr_item * IH_SIZE - bh->blk_free_space;
+	ih = (struct item_head *)((u8 *)bh + BLKH_SIZE) + bh->blk_nr_item;
+	ih->ih_key = *key;
+	ih->u.ih_free_space = count;
+	ih->ih_item_len = len;
+	ih->ih_item_location = BLKSZ - used - len;
+	ih->ih_version = ITEM_VERSION_2;
+	memcpy ((u8 *)bh + ih->ih_item_location, body, len);
+	bh->blk_nr_item++;
+	bh->blk_free_space -= IH_SIZE + len;
+}
+
+static void put_dir (int d)
+{
+	static u8 body[BLKSZ];
+	struct reiserfs_de_head *deh = (struct reiserfs_de_head *)body;
+	const char *name[2 + NLIBS];
+	__u32 ent_dir[2 + NLIBS], ent_oid[2 + NLIBS];
+	struct key key;
+	int n, i, len, loc;
+
+	name[0] = ".";
+	ent_dir[0] = dir_id (d);
+	ent_oid[0] = obj[d].oid;
+	name[1] = "..";
+	ent_dir[1] = d == 0 ? 0 : dir_id (obj[d].parent);
+	ent_oid[1] = d == 0 ? REISERFS_ROOT_PARENT_OBJECTID : obj[obj[d].parent].oid;
+	n = 2;
+	for (i = 1; i < nobjs; i++) {
+		if (obj[i].parent != d)
+			continue;
+		name[n] = obj[i].name;
+		ent_dir[n] = obj[d].oid;
+		ent_oid[n++] = obj[i].oid;
+	}
+
+	/* the names are stored backwards from the end of the item */
+	len = n * DEH_SIZE;
+	for (i = 0; i < n; i++)
+		len += strlen (name[i]);
+	check (len <= BLKSZ - BLKH_SIZE - IH_SIZE);
+	memset (body, 0, sizeof (body));
+	loc = len;
+	for (i = 0; i < n; i++) {
+		loc -= strlen (name[i]);
+		memcpy (body + loc, name[i], strlen (name[i]));
+		deh[i].deh_offset = i < 2 ? DOT_OFFSET + i : (i + 1) << 7;
+		deh[i].deh_dir_id = ent_dir[i];
+		deh[i].deh_objectid = ent_oid[i];
+		deh[i].deh_location = loc;
+		deh[i].deh_state = DEH_Visible;
+	}
+	set_key (&key, dir_id (d), obj[d].oid, DOT_OFFSET, V2_TYPE_DIRENTRY);
+	put_item (&key, n, body, len);
+}
+
+static void put_file (int f)
+{
+	__u32 ptr[LIB_MAX / BLKSZ + KERNEL_SIZE / BLKSZ + 1];
+	struct key key;
+	int i, n;
+
+	if (obj[f].size <= DIRECT_MAX) {
+		set_key (&key, dir_id (f), obj[f].oid, 1, V2_TYPE_DIRECT);
+		put_item (&key, 0xffff, obj[f].data, obj[f].size);
+		return;
+	}
+	n = (obj[f].size + BLKSZ - 1) / BLKSZ;
+	for (i = 0; i < n; i++) {
+		check (data_next < NBLOCKS);
+		ptr[i] = data_next++;
+		memcpy (img + ptr[i] * BLKSZ, obj[f].data + i * BLKSZ,
+			min (obj[f].size - i * BLKSZ, BLKSZ));
+	}
+	set_key (&key, dir_id (f), obj[f].oid, 1, V2_TYPE_INDIRECT);
+	put_item (&key, 0, ptr, n * sizeof (ptr[0]));
+}
+
+static int key_cmp (const void *a, const void *b)
+{
+	const struct object *x = &obj[*(const int *)a];
+	const struct object *y = &obj[*(const int *)b];
+	__u32 xd = dir_id (x - obj), yd = dir_id (y - obj);
+
+	if (xd != yd)
+		return xd < yd ? -1 : 1;
+	return x->oid < y->oid ? -1 : x->oid > y->oid;
+}
+
+static void make_tree (void)
+{
+	struct block_head *bh = (struct block_head *)root_node;
+	struct key key;
+	struct disk_child *dc;
+	struct stat_data sd;
+	int order[8 + NLIBS];
+	int i, o;
+
+	nleaves = 0;
+	data_next = DATA_BLOCK;
+	for (i = 0; i < nobjs; i++)
+		order[i] = i;
+	qsort (order, nobjs, sizeof (order[0]), key_cmp);
+
+	for (i = 0; i < nobjs; i++) {
+		o = order[i];
+		memset (&sd, 0, sizeof (sd));
+		sd.sd_mode = obj[o].mode;
+		sd.sd_nlink = S_ISDIR (obj[o].mode) ? 2 : 1;
+		sd.sd_size = obj[o].size;
+		set_key (&key, dir_id (o), obj[o].oid, SD_OFFSET, V2_TYPE_STAT_DATA);
+		put_item (&key, 0xffff, &sd, sizeof (sd));
+		if (S_ISDIR (obj[o].mode))
+			put_dir (o);
+		else
+			put_file (o);
+	}
+
+	/* the leaves know their right neighbour's first key */
+	for (i = 0; i < nleaves; i++) {
+		bh = (struct block_head *)leaf[i];
+		if (i + 1 < nleaves)
+			bh->blk_right_delim_key = first_key[i + 1];
+		else
+			memset (&bh->blk_right_delim_key, 0xff, KEY_SIZE);
+	}
+
+	/* and the root node has them as keys between its children */
+	memset (root_node, 0, sizeof (root_node));
+	bh = (struct block_head *)root_node;
+	bh->blk_level = DISK_LEAF_NODE_LEVEL + 1;
+	bh->blk_nr_item = nleaves - 1;
+	memcpy (root_node + BLKH_SIZE, first_key + 1, (nleaves - 1) * KEY_SIZE);
+	dc = (struct disk_child *)(root_node + BLKH_SIZE + (nleaves - 1) * KEY_SIZE);
+	for (i = 0; i < nleaves; i++) {
+		dc[i].dc_block_number = LEAF_BLOCK + i;
+		dc[i].dc_size = BLKSZ - BLKH_SIZE -
+			((struct block_head *)leaf[i])->blk_free_space;
+	}
+	bh->blk_free_space = BLKSZ - BLKH_SIZE - (nleaves - 1) * KEY_SIZE -
+		nleaves * DC_SIZE;
+}
+
+/* a copy of leaf i whose direct items are garbled with x */
+static u8 *garbled (int i, u8 x)
+{
+	static u8 copy[2][MAX_LEAVES][BLKSZ];
+	u8 *b = copy[x == 0xff][i];
+	struct block_head *bh = (struct block_head *)b;
+	struct item_head *ih = (struct item_head *)(b + BLKH_SIZE);
+	int n, j;
+
+	memcpy (b, leaf[i], BLKSZ);
+	for (n = 0; n < bh->blk_nr_item; n++, ih++)
+		if (ih->ih_key.u.v2.k_type == V2_TYPE_DIRECT)
+			for (j = 0; j < ih->ih_item_len; j++)
+				b[ih->ih_item_location + j] ^= x;
+	return b;
+}
+
+/* the journal */
+static __u32 jpos;			/* next free journal block */
+static __u32 trans_id;
+static __u32 tr_block[J_SIZE];
+static const u8 *tr_data[J_SIZE];
+static int tr_len;
+static int journaled;			/* leaves only correct in the journal */
+
+#define JOURNAL(n)	(img + (J_BLOCK + ((n) & (J_SIZE - 1))) * BLKSZ)
+
+static void tr_add (__u32 block, const void *data)
+{
+	tr_block[tr_len] = block;
+	tr_data[tr_len++] = data;
+}
+
+static void tr_fillers (int n)
+{
+	static u8 filler[BLKSZ];
+
+	while (n-- > 0)
+		tr_add (FILLER_BLOCK + tr_len, filler);
+}
+
+/* write the transaction collected with tr_add() */
+static void tr_commit (__u32 mount_id)
+{
+	struct reiserfs_journal_desc *desc = (void *)JOURNAL (jpos);
+	struct reiserfs_journal_commit *commit = (void *)JOURNAL (jpos + tr_len + 1);
+	int i;
+
+	memset (desc, 0, BLKSZ);
+	desc->j_trans_id = trans_id;
+	desc->j_len = tr_len;
+	desc->j_mount_id = mount_id;
+	memcpy (desc->j_magic, JOURNAL_DESC_MAGIC, 8);
+	for (i = 0; i < tr_len; i++) {
+		if (i < JOURNAL_TRANS_HALF)
+			desc->j_realblock[i] = tr_block[i];
+		memcpy (JOURNAL (jpos + 1 + i), tr_data[i], BLKSZ);
+	}
+	memset (commit, 0, BLKSZ);
+	commit->j_trans_id = trans_id;
+	commit->j_len = tr_len;
+	for (i = JOURNAL_TRANS_HALF; i < tr_len; i++)
+		commit->j_realblock[i - JOURNAL_TRANS_HALF] = tr_block[i];
+
+	desc_block[jpos] = 1;
+	desc_block[(jpos + tr_len + 1) & (J_SIZE - 1)] = 1;
+	jpos = (jpos + tr_len + 2) & (J_SIZE - 1);
+	trans_id++;
+	tr_len = 0;
+}
+
+static void make_super (struct reiserfs_super_block *sb, __u32 root)
+{
+	memset (sb, 0, sizeof (*sb));
+	sb->s_block_count = NBLOCKS;
+	sb->s_root_block = root;
+	sb->s_journal_block = J_BLOCK;
+	sb->s_journal_size = J_SIZE;
+	sb->s_blocksize = BLKSZ;
+	strcpy (sb->s_magic, REISER2FS_SUPER_MAGIC_STRING);
+	sb->s_tree_height = 2;
+	sb->s_version = 2;
+}
+
+/*
+ * On disk, the super block points to an empty old root, the root node
+ * is empty and every third leaf has garbled direct items. The journal
+ * has
+ *
+ *	FIRST_TRANS	older garbled copies of these leaves
+ *	+ 1		fillers, the root, the odd ones of these leaves and
+ *			older copies of the even ones, more fillers; more
+ *			blocks than a descriptor can describe, more than
+ *			the journal cache holds, and wrapping around
+ *	+ 2		the super block and the even ones of these leaves
+ *	+ 3		garbled copies of all, with the wrong mount id
+ */
+static void make_image (void)
+{
+	static u8 sb_old[BLKSZ], sb_new[BLKSZ];
+	struct reiserfs_journal_header *hdr;
+	int i;
+
+	memset (img, 0, sizeof (img));
+	make_tree ();
+	make_super ((struct reiserfs_super_block *)sb_old, OLD_ROOT);
+	make_super ((struct reiserfs_super_block *)sb_new, ROOT_BLOCK);
+	memcpy (img + SUPER_BLOCK * BLKSZ, sb_old, BLKSZ);
+	journaled = 0;
+	for (i = 0; i < nleaves; i++) {
+		if (i % 3 == 0) {
+			memcpy (img + (LEAF_BLOCK + i) * BLKSZ, garbled (i, 0xff), BLKSZ);
+			journaled++;
+		} else
+			memcpy (img + (LEAF_BLOCK + i) * BLKSZ, leaf[i], BLKSZ);
+	}
+
+	hdr = (struct reiserfs_journal_header *)(img + (J_BLOCK + J_SIZE) * BLKSZ);
+	hdr->j_last_flush_trans_id = FIRST_TRANS - 1;
+	hdr->j_first_unflushed_offset = J_FIRST;
+	hdr->j_mount_id = MOUNT_ID;
+	jpos = J_FIRST;
+	trans_id = FIRST_TRANS;
+	tr_len = 0;
+
+	for (i = 0; i < nleaves; i += 3)
+		tr_add (LEAF_BLOCK + i, garbled (i, 0x55));
+	tr_commit (MOUNT_ID);
+
+	tr_fillers (JOURNAL_TRANS_HALF - 4);
+	tr_add (ROOT_BLOCK, root_node);
+	for (i = 0; i < nleaves; i += 3)
+		tr_add (LEAF_BLOCK + i, i % 2 ? leaf[i] : garbled (i, 0x55));
+	tr_fillers (1950 - tr_len);
+	tr_commit (MOUNT_ID);
+
+	tr_fillers (100);
+	tr_add (SUPER_BLOCK, sb_new);
+	for (i = 0; i < nleaves; i += 3)
+		if (i % 2 == 0)
+			tr_add (LEAF_BLOCK + i, leaf[i]);
+	tr_commit (MOUNT_ID);
+
+	tr_add (SUPER_BLOCK, sb_old);
+	for (i = 0; i < nleaves; i += 3)
+		tr_add (LEAF_BLOCK + i, garbled (i, 0xff));
+	tr_commit (MOUNT_ID + 1);
+}
+
+static FILE *devnull;
+static int stdout_fd;
+
+static void quiet (int on)
+{
+	fflush (stdout);
+	if (on) {
+		stdout_fd = dup (1);
+		dup2 (fileno (devnull), 1);
+	} else {
+		dup2 (stdout_fd, 1);
+		close (stdout_fd);
+	}
+}
+
+static int mount (void)
+{
+	memset (&dev, 0, sizeof (dev));
+	dev.if_type = IF_TYPE_IDE;
+	dev.type = DEV_TYPE_HARDDISK;
+	dev.blksz = SECTOR_SIZE;
+	dev.lba = sizeof (img) / SECTOR_SIZE;
+	dev.block_read = img_read;
+	return reiserfs_mount (reiserfs_set_blk_dev (&dev, 0));
+}
+
+static void check_file (const char *path, const u8 *data, int size)
+{
+	static u8 buf[KERNEL_SIZE + BLKSZ];
+	char name[64];
+	int got = -1;
+
+	strcpy (name, path);		/* reiserfs_open() writes to it */
+	memset (buf, 0, sizeof (buf));
+	quiet (1);
+	if (reiserfs_open (name) == size)
+		got = reiserfs_read ((char *)buf, size);
+	quiet (0);
+	if (got != size || memcmp (buf, data, size) != 0)
+		printf ("%s: %d bytes loaded, %d expected\n", path, got, size);
+	check (got == size && memcmp (buf, data, size) == 0);
+}
+
+static void check_fs (void)
+{
+	char name[32];
+	int i;
+
+	check (mount ());
+	dev_reads = desc_reads = 0;
+	check_file ("/boot/uImage", kernel, KERNEL_SIZE);
+	check_file ("/boot/vmlinux", kernel, KERNEL_SIZE);
+	check_file ("/kernel", kernel, KERNEL_SIZE);
+	check_file ("/etc/motd", motd, sizeof (motd) - 1);
+	for (i = 0; i < NLIBS; i++) {
+		sprintf (name, "/lib/lib%03d.so", i);
+		check_file (name, lib[i], LIB_SIZE (i));
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	ulong reads[3], descs[3];
+	int i, j;
+
+	devnull = fopen ("/dev/null", "w");
+	for (i = 0; i < KERNEL_SIZE; i++)
+		kernel[i] = (u8)(i * 7 + (i >> 8));
+	for (i = 0; i < NLIBS; i++)
+		for (j = 0; j < LIB_SIZE (i); j++)
+			lib[i][j] = (u8)(i + j * 3);
+
+	make_objects ();
+	make_image ();
+	printf ("%d leaves, %d of them journaled; %d transactions, the last invalid, "
+		"%d journal blocks\n", nleaves, journaled, trans_id - FIRST_TRANS,
+		(jpos - J_FIRST) & (J_SIZE - 1));
+	check (nleaves > 20);
+	check (((jpos - J_FIRST) & (J_SIZE - 1)) < J_FIRST);	/* wrapped */
+
+	/* with the journal map, then with one which can't grow beyond
+	   its first size, and without one */
+	for (i = 0; i < 3; i++) {
+		malloc_limit = i == 0 ? (size_t)-1 : i == 1 ? 4096 : 1024;
+		check_fs ();
+		reads[i] = dev_reads;
+		descs[i] = desc_reads;
+	}
+	malloc_limit = (size_t)-1;
+
+	printf ("loading every file: %ld device reads, %ld of descriptor or "
+		"commit blocks with the journal map; %ld, %ld walking the "
+		"transactions\n", reads[0], descs[0], reads[2], descs[2]);
+	check (descs[0] == 0);
+	check (descs[2] > 0 && reads[2] == reads[0] + descs[2]);
+	check (reads[1] == reads[2] && descs[1] == descs[2]);
+
+	printf ("%s\n", host_fails ? "FAILED" : "OK");
+	return host_fails != 0;
+}